@@ -0,0 +1,239 @@
+// Allocation latency and fragmentation under a churn workload.
+//
+// Runs the TLSF block allocator on its own first, then compares one vkAllocateMemory per buffer with
+// the sub-allocating VulkanMemoryAllocator on a real device (lavapipe if installed).
+
+#include "Backend/TlsfAllocator.h"
+#include "Backend/VulkanMemoryAllocator.h"
+#include "BenchmarkDevice.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const uint32_t CHURN_ITERATIONS = 200000;
+    const uint32_t DEVICE_CHURN_ITERATIONS = 20000;
+    const uint32_t LIVE_RESOURCES = 2000;
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    /** @brief Mostly small buffers with the occasional large one, roughly what a scene load looks like */
+    uint64_t randomResourceSize(std::mt19937 &rng)
+    {
+        std::uniform_int_distribution<uint32_t> bucket(0, 99);
+        uint32_t b = bucket(rng);
+        if (b < 70)
+            return std::uniform_int_distribution<uint64_t>(256, 64 * 1024)(rng);
+        if (b < 95)
+            return std::uniform_int_distribution<uint64_t>(64 * 1024, 1024 * 1024)(rng);
+        return std::uniform_int_distribution<uint64_t>(1024 * 1024, 16 * 1024 * 1024)(rng);
+    }
+
+    double fragmentation(uint64_t freeBytes, uint64_t largestFreeRegion)
+    {
+        return freeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(largestFreeRegion) / static_cast<double>(freeBytes);
+    }
+
+    void benchmarkTlsf()
+    {
+        const uint64_t blockSize = 1024ull * 1024 * 1024;
+        TlsfAllocator allocator(blockSize);
+        std::mt19937 rng(42);
+
+        struct Live
+        {
+            uint32_t handle;
+        };
+        std::vector<Live> live;
+        live.reserve(LIVE_RESOURCES);
+
+        double allocateNs = 0.0, freeNs = 0.0;
+        uint32_t allocations = 0, frees = 0, failures = 0;
+
+        for (uint32_t i = 0; i < CHURN_ITERATIONS; i++)
+        {
+            if (live.size() >= LIVE_RESOURCES || (!live.empty() && (rng() & 1)))
+            {
+                size_t index = rng() % live.size();
+                auto start = Clock::now();
+                allocator.free(live[index].handle);
+                freeNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                live[index] = live.back();
+                live.pop_back();
+                frees++;
+            }
+            else
+            {
+                uint64_t size = randomResourceSize(rng);
+                uint64_t alignment = 1ull << std::uniform_int_distribution<uint32_t>(4, 16)(rng);
+                uint64_t offset;
+                auto start = Clock::now();
+                uint32_t handle = allocator.allocate(size, alignment, offset);
+                allocateNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                if (handle == TlsfAllocator::INVALID_HANDLE)
+                {
+                    failures++;
+                    continue;
+                }
+                live.push_back({handle});
+                allocations++;
+            }
+        }
+
+        TlsfAllocator::Statistics stats = allocator.getStatistics();
+        std::printf("TLSF block (1 GiB, %u ops)\n", CHURN_ITERATIONS);
+        std::printf("  allocate: %8.1f ns avg (%u, %u failed)\n", allocateNs / allocations, allocations, failures);
+        std::printf("  free:     %8.1f ns avg (%u)\n", freeNs / frees, frees);
+        std::printf("  live %u, used %.1f MiB, %u free regions, fragmentation %.3f\n", stats.allocationCount, stats.used / (1024.0 * 1024.0),
+                    stats.freeRegionCount, fragmentation(stats.size - stats.used, stats.largestFreeRegion));
+    }
+
+    uint32_t findDeviceLocalType(VkPhysicalDevice physicalDevice, uint32_t typeBits)
+    {
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        {
+            if ((typeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+                return i;
+        }
+        return 0;
+    }
+
+    void benchmarkDevice(BenchmarkDevice &bench)
+    {
+        const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        // One vkAllocateMemory per buffer, what createBuffer used to do
+        {
+            std::mt19937 rng(42);
+            struct Live
+            {
+                VkBuffer buffer;
+                VkDeviceMemory memory;
+            };
+            std::vector<Live> live;
+            double allocateNs = 0.0, freeNs = 0.0;
+            uint32_t allocations = 0, frees = 0;
+
+            for (uint32_t i = 0; i < DEVICE_CHURN_ITERATIONS; i++)
+            {
+                if (live.size() >= LIVE_RESOURCES || (!live.empty() && (rng() & 1)))
+                {
+                    size_t index = rng() % live.size();
+                    auto start = Clock::now();
+                    vkDestroyBuffer(bench.device, live[index].buffer, nullptr);
+                    vkFreeMemory(bench.device, live[index].memory, nullptr);
+                    freeNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                    live[index] = live.back();
+                    live.pop_back();
+                    frees++;
+                    continue;
+                }
+
+                VkBufferCreateInfo bufferInfo{};
+                bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+                bufferInfo.size = randomResourceSize(rng);
+                bufferInfo.usage = usage;
+                bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+                auto start = Clock::now();
+                Live resource{};
+                vkCreateBuffer(bench.device, &bufferInfo, nullptr, &resource.buffer);
+                VkMemoryRequirements memRequirements;
+                vkGetBufferMemoryRequirements(bench.device, resource.buffer, &memRequirements);
+                VkMemoryAllocateInfo allocInfo{};
+                allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                allocInfo.allocationSize = memRequirements.size;
+                allocInfo.memoryTypeIndex = findDeviceLocalType(bench.physicalDevice, memRequirements.memoryTypeBits);
+                if (vkAllocateMemory(bench.device, &allocInfo, nullptr, &resource.memory) != VK_SUCCESS)
+                {
+                    vkDestroyBuffer(bench.device, resource.buffer, nullptr);
+                    continue;
+                }
+                vkBindBufferMemory(bench.device, resource.buffer, resource.memory, 0);
+                allocateNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                live.push_back(resource);
+                allocations++;
+            }
+
+            std::printf("vkAllocateMemory per buffer (%u ops)\n", DEVICE_CHURN_ITERATIONS);
+            std::printf("  allocate: %8.1f ns avg\n", allocateNs / allocations);
+            std::printf("  free:     %8.1f ns avg\n", freeNs / frees);
+            std::printf("  live device allocations: %zu of maxMemoryAllocationCount %u\n", live.size(), bench.properties.limits.maxMemoryAllocationCount);
+
+            for (Live &resource : live)
+            {
+                vkDestroyBuffer(bench.device, resource.buffer, nullptr);
+                vkFreeMemory(bench.device, resource.memory, nullptr);
+            }
+        }
+
+        // Same workload through the sub-allocator
+        {
+            VulkanMemoryAllocator allocator;
+            allocator.init(bench.physicalDevice, bench.device);
+
+            std::mt19937 rng(42);
+            struct Live
+            {
+                VkBuffer buffer;
+                VulkanAllocation allocation;
+            };
+            std::vector<Live> live;
+            double allocateNs = 0.0, freeNs = 0.0;
+            uint32_t allocations = 0, frees = 0;
+
+            for (uint32_t i = 0; i < DEVICE_CHURN_ITERATIONS; i++)
+            {
+                if (live.size() >= LIVE_RESOURCES || (!live.empty() && (rng() & 1)))
+                {
+                    size_t index = rng() % live.size();
+                    auto start = Clock::now();
+                    allocator.destroyBuffer(live[index].buffer, live[index].allocation);
+                    freeNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                    live[index] = live.back();
+                    live.pop_back();
+                    frees++;
+                    continue;
+                }
+
+                VkDeviceSize size = randomResourceSize(rng);
+                auto start = Clock::now();
+                Live resource{};
+                allocator.createBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, resource.buffer, resource.allocation);
+                allocateNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                live.push_back(resource);
+                allocations++;
+            }
+
+            VulkanMemoryAllocator::Statistics stats = allocator.getStatistics();
+            std::printf("VulkanMemoryAllocator (%u ops)\n", DEVICE_CHURN_ITERATIONS);
+            std::printf("  allocate: %8.1f ns avg\n", allocateNs / allocations);
+            std::printf("  free:     %8.1f ns avg\n", freeNs / frees);
+            std::printf("  live device allocations: %u (%u blocks, %u dedicated) for %u resources\n", stats.blockCount + stats.dedicatedAllocationCount,
+                        stats.blockCount, stats.dedicatedAllocationCount, stats.allocationCount);
+            std::printf("  reserved %.1f MiB, used %.1f MiB, fragmentation %.3f\n", stats.bytesReserved / (1024.0 * 1024.0), stats.bytesUsed / (1024.0 * 1024.0),
+                        fragmentation(stats.bytesReserved - stats.bytesUsed, stats.largestFreeRegion));
+
+            for (Live &resource : live)
+                allocator.destroyBuffer(resource.buffer, resource.allocation);
+            allocator.destroy();
+        }
+    }
+}
+
+int main()
+{
+    benchmarkTlsf();
+
+    BenchmarkDevice bench;
+    if (bench.init())
+        benchmarkDevice(bench);
+    bench.cleanup();
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Headless Vulkan instance and device for the benchmarks
+ *
+ * No surface or swapchain is created. A software implementation (lavapipe) is preferred when
+ * present so numbers are comparable between machines, otherwise the first device is used.
+ */
+struct BenchmarkDevice
+{
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queueFamily = 0;
+    VkPhysicalDeviceProperties properties{};
+
+    /** @brief Returns false instead of throwing so CPU only parts of a benchmark can still run */
+    bool init(uint32_t apiVersion = VK_API_VERSION_1_0, const std::vector<const char *> &deviceExtensions = {}, const void *deviceFeatures = nullptr)
+    {
+        VkApplicationInfo appInfo{};
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName = "Engine Benchmark";
+        appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.pEngineName = "No Engine";
+        appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.apiVersion = apiVersion;
+
+        VkInstanceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        createInfo.pApplicationInfo = &appInfo;
+
+        if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS)
+        {
+            std::cerr << "no Vulkan instance available, skipping device benchmarks" << std::endl;
+            return false;
+        }
+
+        uint32_t deviceCount = 0;
+        vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+        if (deviceCount == 0)
+        {
+            std::cerr << "no Vulkan device available, skipping device benchmarks" << std::endl;
+            return false;
+        }
+
+        std::vector<VkPhysicalDevice> devices(deviceCount);
+        vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+        physicalDevice = devices[0];
+        for (VkPhysicalDevice candidate : devices)
+        {
+            VkPhysicalDeviceProperties candidateProperties;
+            vkGetPhysicalDeviceProperties(candidate, &candidateProperties);
+            if (candidateProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU || std::strstr(candidateProperties.deviceName, "llvmpipe"))
+            {
+                physicalDevice = candidate;
+                break;
+            }
+        }
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+        for (uint32_t i = 0; i < queueFamilyCount; i++)
+        {
+            if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+            {
+                queueFamily = i;
+                break;
+            }
+        }
+
+        float queuePriority = 1.0f;
+        VkDeviceQueueCreateInfo queueCreateInfo{};
+        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = queueFamily;
+        queueCreateInfo.queueCount = 1;
+        queueCreateInfo.pQueuePriorities = &queuePriority;
+
+        VkDeviceCreateInfo deviceCreateInfo{};
+        deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceCreateInfo.pNext = deviceFeatures;
+        deviceCreateInfo.queueCreateInfoCount = 1;
+        deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+        deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+        deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+        if (vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device) != VK_SUCCESS)
+        {
+            std::cerr << "failed to create benchmark device, skipping device benchmarks" << std::endl;
+            return false;
+        }
+
+        vkGetDeviceQueue(device, queueFamily, 0, &queue);
+        std::cout << "device: " << properties.deviceName << std::endl;
+        return true;
+    }
+
+    void cleanup()
+    {
+        if (device != VK_NULL_HANDLE)
+            vkDestroyDevice(device, nullptr);
+        if (instance != VK_NULL_HANDLE)
+            vkDestroyInstance(instance, nullptr);
+        device = VK_NULL_HANDLE;
+        instance = VK_NULL_HANDLE;
+    }
+};
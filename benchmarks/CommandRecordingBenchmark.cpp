@@ -0,0 +1,156 @@
+// CPU cost of recording a frame's draws, inline into one primary versus in parallel into secondaries.
+//
+// For every draw count the inline recording is the baseline, then the VulkanCommandRecorder runs with
+// 1 to N threads. A frame is the pool reset, the secondaries and the primary that executes them.
+// Nothing is submitted, only recording is measured (lavapipe if installed).
+
+#include "Backend/VulkanCommandRecorder.h"
+#include "Backend/VulkanMemoryAllocator.h"
+#include "BenchmarkDevice.h"
+#include "BenchmarkScene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#ifndef BENCHMARK_SHADER_DIR
+#define BENCHMARK_SHADER_DIR "res/shaders"
+#endif
+
+namespace
+{
+    const uint32_t DRAW_COUNTS[] = {1000, 10000, 50000};
+    const uint32_t FRAMES = 40;
+    const uint32_t FRAMES_IN_FLIGHT = 2;
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct Timing
+    {
+        double averageMs = 0.0;
+        double bestMs = 0.0;
+    };
+
+    template <typename RecordFrame>
+    Timing timeFrames(RecordFrame &&recordFrame)
+    {
+        recordFrame(0u);
+
+        Timing timing;
+        timing.bestMs = 1e30;
+        double totalMs = 0.0;
+        for (uint32_t frame = 0; frame < FRAMES; frame++)
+        {
+            auto start = Clock::now();
+            recordFrame(frame % FRAMES_IN_FLIGHT);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            totalMs += ms;
+            timing.bestMs = std::min(timing.bestMs, ms);
+        }
+        timing.averageMs = totalMs / FRAMES;
+        return timing;
+    }
+
+    void beginPrimary(VkCommandBuffer commandBuffer)
+    {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    }
+
+    void benchmarkRecording(const BenchmarkDevice &bench, VulkanMemoryAllocator &allocator, uint32_t maxThreads)
+    {
+        uint32_t maxDraws = *std::max_element(std::begin(DRAW_COUNTS), std::end(DRAW_COUNTS));
+        BenchmarkScene scene;
+        scene.init(bench, allocator, BENCHMARK_SHADER_DIR, maxDraws);
+        VkCommandBufferInheritanceInfo inheritance = scene.getInheritance();
+
+        // Primaries come from per frame pools as well, reset the same way the recorder resets its own
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = bench.queueFamily;
+
+        VkCommandPool primaryPools[FRAMES_IN_FLIGHT];
+        VkCommandBuffer primaries[FRAMES_IN_FLIGHT];
+        for (uint32_t frame = 0; frame < FRAMES_IN_FLIGHT; frame++)
+        {
+            vkCreateCommandPool(bench.device, &poolInfo, nullptr, &primaryPools[frame]);
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = primaryPools[frame];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            vkAllocateCommandBuffers(bench.device, &allocInfo, &primaries[frame]);
+        }
+
+        for (uint32_t drawCount : DRAW_COUNTS)
+        {
+            std::printf("%u draws\n", drawCount);
+
+            Timing inlineTiming = timeFrames([&](uint32_t frame)
+                                             {
+                vkResetCommandPool(bench.device, primaryPools[frame], 0);
+                beginPrimary(primaries[frame]);
+                scene.beginRenderPass(primaries[frame], VK_SUBPASS_CONTENTS_INLINE);
+                scene.recordObjects(primaries[frame], 0, drawCount);
+                vkCmdEndRenderPass(primaries[frame]);
+                vkEndCommandBuffer(primaries[frame]); });
+            std::printf("  inline primary:  %8.3f ms avg, %8.3f ms best\n", inlineTiming.averageMs, inlineTiming.bestMs);
+
+            double singleThreadMs = 0.0;
+            for (uint32_t threads = 1; threads <= maxThreads; threads++)
+            {
+                JobSystem jobs;
+                jobs.create(threads);
+                VulkanCommandRecorder recorder;
+                recorder.create(bench.device, bench.queueFamily, FRAMES_IN_FLIGHT, jobs);
+
+                Timing timing = timeFrames([&](uint32_t frame)
+                                           {
+                    vkResetCommandPool(bench.device, primaryPools[frame], 0);
+                    recorder.beginFrame(frame);
+                    beginPrimary(primaries[frame]);
+                    scene.beginRenderPass(primaries[frame], VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                    const std::vector<VkCommandBuffer> &secondaries = recorder.record(inheritance, drawCount, [&scene](VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t count)
+                                                                                      { scene.recordObjects(commandBuffer, firstDraw, count); });
+                    vkCmdExecuteCommands(primaries[frame], static_cast<uint32_t>(secondaries.size()), secondaries.data());
+                    vkCmdEndRenderPass(primaries[frame]);
+                    vkEndCommandBuffer(primaries[frame]); });
+
+                recorder.destroy();
+                jobs.destroy();
+
+                if (threads == 1)
+                    singleThreadMs = timing.averageMs;
+                std::printf("  %2u thread%s:      %8.3f ms avg, %8.3f ms best, %5.2fx vs 1 thread, %5.2fx vs inline\n", threads, threads == 1 ? " " : "s",
+                            timing.averageMs, timing.bestMs, singleThreadMs / timing.averageMs, inlineTiming.averageMs / timing.averageMs);
+            }
+        }
+
+        for (uint32_t frame = 0; frame < FRAMES_IN_FLIGHT; frame++)
+            vkDestroyCommandPool(bench.device, primaryPools[frame], nullptr);
+        scene.cleanup();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t maxThreads = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : std::max(1u, std::thread::hardware_concurrency());
+
+    BenchmarkDevice bench;
+    if (bench.init())
+    {
+        VulkanMemoryAllocator allocator;
+        allocator.init(bench.physicalDevice, bench.device);
+        benchmarkRecording(bench, allocator, std::max(1u, maxThreads));
+        allocator.destroy();
+    }
+    bench.cleanup();
+    return 0;
+}
@@ -0,0 +1,307 @@
+// Render pass and framebuffers versus VK_KHR_dynamic_rendering.
+//
+// Resize: what recreateSwapChain rebuilds besides the swapchain itself. Both paths recreate the depth
+// image and its view, the render pass path also creates a framebuffer per swapchain image. The
+// swapchain images are stood in for by colour images created once at the largest size.
+//
+// Recording: a frame of draws in one pass, and the same draws split over many small passes so the cost
+// of beginning and ending a pass shows. Nothing is submitted (lavapipe if installed).
+
+#include "Backend/VulkanMemoryAllocator.h"
+#include "BenchmarkDevice.h"
+#include "BenchmarkScene.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#ifndef BENCHMARK_SHADER_DIR
+#define BENCHMARK_SHADER_DIR "res/shaders"
+#endif
+
+namespace
+{
+    const uint32_t SWAPCHAIN_IMAGES = 3;
+    const VkExtent2D RESIZE_EXTENTS[] = {{1280, 720}, {1600, 900}, {1920, 1080}, {1024, 768}, {2560, 1440}};
+    const uint32_t RESIZES = 200;
+    const VkFormat COLOR_FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
+    const VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+
+    const uint32_t DRAW_COUNT = 10000;
+    const uint32_t PASS_COUNTS[] = {1, 10, 100, 1000};
+    const uint32_t FRAMES = 40;
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct Timing
+    {
+        double averageMs = 0.0;
+        double bestMs = 0.0;
+    };
+
+    template <typename Run>
+    Timing time(uint32_t iterations, Run &&run)
+    {
+        run(0u);
+
+        Timing timing;
+        timing.bestMs = 1e30;
+        double totalMs = 0.0;
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            auto start = Clock::now();
+            run(i);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            totalMs += ms;
+            timing.bestMs = std::min(timing.bestMs, ms);
+        }
+        timing.averageMs = totalMs / iterations;
+        return timing;
+    }
+
+    VkImageView createView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = {aspect, 0, 1, 0, 1};
+
+        VkImageView view;
+        if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create benchmark image view!");
+        }
+        return view;
+    }
+
+    VkImageCreateInfo getImageInfo(VkFormat format, VkExtent2D extent, VkImageUsageFlags usage)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = {extent.width, extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        return imageInfo;
+    }
+
+    VkRenderPass createRenderPass(VkDevice device)
+    {
+        std::array<VkAttachmentDescription, 2> attachments{};
+        attachments[0].format = COLOR_FORMAT;
+        attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        attachments[1] = attachments[0];
+        attachments[1].format = DEPTH_FORMAT;
+        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference colorAttachmentRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkAttachmentReference depthAttachmentRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+
+        VkRenderPass renderPass;
+        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create benchmark render pass!");
+        }
+        return renderPass;
+    }
+
+    void benchmarkResize(const BenchmarkDevice &bench, VulkanMemoryAllocator &allocator)
+    {
+        VkExtent2D largest{0, 0};
+        for (VkExtent2D extent : RESIZE_EXTENTS)
+        {
+            largest.width = std::max(largest.width, extent.width);
+            largest.height = std::max(largest.height, extent.height);
+        }
+
+        std::array<VkImage, SWAPCHAIN_IMAGES> colorImages;
+        std::array<VulkanAllocation, SWAPCHAIN_IMAGES> colorAllocations;
+        std::array<VkImageView, SWAPCHAIN_IMAGES> colorViews;
+        for (uint32_t i = 0; i < SWAPCHAIN_IMAGES; i++)
+        {
+            allocator.createImage(getImageInfo(COLOR_FORMAT, largest, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImages[i],
+                                  colorAllocations[i]);
+            colorViews[i] = createView(bench.device, colorImages[i], COLOR_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
+        }
+        VkRenderPass renderPass = createRenderPass(bench.device);
+
+        VkImage depthImage = VK_NULL_HANDLE;
+        VulkanAllocation depthAllocation;
+        VkImageView depthView = VK_NULL_HANDLE;
+        std::array<VkFramebuffer, SWAPCHAIN_IMAGES> framebuffers{};
+
+        auto destroyTargets = [&]()
+        {
+            for (VkFramebuffer &framebuffer : framebuffers)
+            {
+                vkDestroyFramebuffer(bench.device, framebuffer, nullptr);
+                framebuffer = VK_NULL_HANDLE;
+            }
+            if (depthView != VK_NULL_HANDLE)
+            {
+                vkDestroyImageView(bench.device, depthView, nullptr);
+                allocator.destroyImage(depthImage, depthAllocation);
+                depthView = VK_NULL_HANDLE;
+            }
+        };
+
+        auto resize = [&](uint32_t iteration, bool createFramebuffers)
+        {
+            VkExtent2D extent = RESIZE_EXTENTS[iteration % (sizeof(RESIZE_EXTENTS) / sizeof(RESIZE_EXTENTS[0]))];
+            destroyTargets();
+
+            allocator.createImage(getImageInfo(DEPTH_FORMAT, extent, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage,
+                                  depthAllocation);
+            depthView = createView(bench.device, depthImage, DEPTH_FORMAT, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+            if (!createFramebuffers)
+                return;
+
+            for (uint32_t i = 0; i < SWAPCHAIN_IMAGES; i++)
+            {
+                std::array<VkImageView, 2> attachments = {colorViews[i], depthView};
+                VkFramebufferCreateInfo framebufferInfo{};
+                framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+                framebufferInfo.renderPass = renderPass;
+                framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+                framebufferInfo.pAttachments = attachments.data();
+                framebufferInfo.width = extent.width;
+                framebufferInfo.height = extent.height;
+                framebufferInfo.layers = 1;
+                if (vkCreateFramebuffer(bench.device, &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to create benchmark framebuffer!");
+                }
+            }
+        };
+
+        std::printf("resize, %u swapchain images\n", SWAPCHAIN_IMAGES);
+        Timing renderPassTiming = time(RESIZES, [&](uint32_t iteration)
+                                       { resize(iteration, true); });
+        std::printf("  render pass:       %8.4f ms avg, %8.4f ms best\n", renderPassTiming.averageMs, renderPassTiming.bestMs);
+
+        Timing dynamicTiming = time(RESIZES, [&](uint32_t iteration)
+                                    { resize(iteration, false); });
+        std::printf("  dynamic rendering: %8.4f ms avg, %8.4f ms best, %5.2fx\n", dynamicTiming.averageMs, dynamicTiming.bestMs,
+                    renderPassTiming.averageMs / dynamicTiming.averageMs);
+
+        destroyTargets();
+        vkDestroyRenderPass(bench.device, renderPass, nullptr);
+        for (uint32_t i = 0; i < SWAPCHAIN_IMAGES; i++)
+        {
+            vkDestroyImageView(bench.device, colorViews[i], nullptr);
+            allocator.destroyImage(colorImages[i], colorAllocations[i]);
+        }
+    }
+
+    void benchmarkRecording(const BenchmarkDevice &bench, VulkanMemoryAllocator &allocator)
+    {
+        BenchmarkScene scene;
+        scene.init(bench, allocator, BENCHMARK_SHADER_DIR, DRAW_COUNT, true);
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = bench.queueFamily;
+        VkCommandPool pool;
+        vkCreateCommandPool(bench.device, &poolInfo, nullptr, &pool);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        vkAllocateCommandBuffers(bench.device, &allocInfo, &commandBuffer);
+
+        auto recordFrame = [&](uint32_t passCount, bool dynamicRendering)
+        {
+            vkResetCommandPool(bench.device, pool, 0);
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+            uint32_t drawsPerPass = DRAW_COUNT / passCount;
+            for (uint32_t pass = 0; pass < passCount; pass++)
+            {
+                if (dynamicRendering)
+                    scene.beginRendering(commandBuffer);
+                else
+                    scene.beginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+                scene.recordObjects(commandBuffer, pass * drawsPerPass, drawsPerPass, dynamicRendering);
+
+                if (dynamicRendering)
+                    scene.cmdEndRendering(commandBuffer);
+                else
+                    vkCmdEndRenderPass(commandBuffer);
+            }
+            vkEndCommandBuffer(commandBuffer);
+        };
+
+        std::printf("recording, %u draws\n", DRAW_COUNT);
+        for (uint32_t passCount : PASS_COUNTS)
+        {
+            Timing renderPassTiming = time(FRAMES, [&](uint32_t)
+                                           { recordFrame(passCount, false); });
+            Timing dynamicTiming = time(FRAMES, [&](uint32_t)
+                                        { recordFrame(passCount, true); });
+            std::printf("  %4u pass%s: render pass %8.3f ms avg, dynamic rendering %8.3f ms avg, %5.2fx\n", passCount, passCount == 1 ? "  " : "es",
+                        renderPassTiming.averageMs, dynamicTiming.averageMs, renderPassTiming.averageMs / dynamicTiming.averageMs);
+        }
+
+        vkDestroyCommandPool(bench.device, pool, nullptr);
+        scene.cleanup();
+    }
+}
+
+int main()
+{
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+    BenchmarkDevice bench;
+    if (bench.init(VK_API_VERSION_1_2, {VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME}, &dynamicRenderingFeatures))
+    {
+        VulkanMemoryAllocator allocator;
+        allocator.init(bench.physicalDevice, bench.device);
+        benchmarkResize(bench, allocator);
+        benchmarkRecording(bench, allocator);
+        allocator.destroy();
+    }
+    bench.cleanup();
+    return 0;
+}
@@ -0,0 +1,228 @@
+// Scaling of the JobSystem with the number of threads, on the kind of work the engine gives it each frame.
+//
+// Two workloads over a scene of objects that all move every frame:
+//   - parallelFor over the objects: animate the transform, premultiply the matrix and cull the bounding
+//     sphere against the frustum, the same as the engine's render queue build
+//   - a graph of per chunk jobs: every chunk is animated by one job and culled by a second one that
+//     depends on it, the frame waits for the culls only
+// For the parallelFor the ThreadPool, one shared FIFO, runs the same pieces as a baseline. Each row is
+// the average of FRAMES frames with 1 to N threads including the main thread. No device is needed.
+
+#include "Backend/JobSystem.h"
+#include "Backend/ThreadPool.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const uint32_t OBJECT_COUNTS[] = {10000, 100000, 500000};
+    const uint32_t OBJECTS_PER_JOB = 256;
+    const uint32_t OBJECTS_PER_CHUNK = 1024;
+    const uint32_t FRAMES = 40;
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct Scene
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::mat4> models;
+        std::vector<glm::mat4> modelViewProjections;
+        std::vector<uint8_t> visible;
+        glm::mat4 viewProjection;
+        std::array<glm::vec4, 6> frustum;
+        float time = 0.0f;
+
+        void init(uint32_t objectCount)
+        {
+            positions.resize(objectCount);
+            models.resize(objectCount);
+            modelViewProjections.resize(objectCount);
+            visible.resize(objectCount);
+
+            // A square grid around the camera target, part of it outside the frustum
+            uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(objectCount))));
+            for (uint32_t object = 0; object < objectCount; object++)
+            {
+                float x = static_cast<float>(object % side) - side * 0.5f;
+                float y = static_cast<float>(object / side) - side * 0.5f;
+                positions[object] = glm::vec3(x, y, 0.0f);
+            }
+
+            glm::mat4 view = glm::lookAt(glm::vec3(0.0f, -side * 0.25f, side * 0.25f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+            glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, static_cast<float>(side));
+            viewProjection = proj * view;
+
+            glm::mat4 rows = glm::transpose(viewProjection);
+            frustum = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2]};
+            for (glm::vec4 &plane : frustum)
+                plane /= glm::length(glm::vec3(plane));
+        }
+
+        void animate(uint32_t begin, uint32_t end)
+        {
+            for (uint32_t object = begin; object < end; object++)
+            {
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[object]);
+                models[object] = glm::rotate(model, time + object * 0.01f, glm::vec3(0.0f, 0.0f, 1.0f));
+            }
+        }
+
+        void cull(uint32_t begin, uint32_t end)
+        {
+            for (uint32_t object = begin; object < end; object++)
+            {
+                modelViewProjections[object] = viewProjection * models[object];
+
+                glm::vec3 center = glm::vec3(models[object][3]);
+                bool inside = true;
+                for (const glm::vec4 &plane : frustum)
+                    inside = inside && glm::dot(glm::vec3(plane), center) + plane.w >= -0.75f;
+                visible[object] = inside;
+            }
+        }
+
+        uint32_t getObjectCount() const { return static_cast<uint32_t>(positions.size()); }
+    };
+
+    template <typename RunFrame>
+    double timeFrames(Scene &scene, RunFrame &&runFrame)
+    {
+        runFrame();
+
+        auto start = Clock::now();
+        for (uint32_t frame = 0; frame < FRAMES; frame++)
+        {
+            scene.time += 0.016f;
+            runFrame();
+        }
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / FRAMES;
+    }
+
+    double runParallelFor(Scene &scene, uint32_t threads)
+    {
+        JobSystem jobs;
+        jobs.create(threads);
+        double ms = timeFrames(scene, [&]()
+                               { jobs.parallelFor(scene.getObjectCount(), OBJECTS_PER_JOB, [&scene](uint32_t begin, uint32_t end)
+                                                  {
+                                     scene.animate(begin, end);
+                                     scene.cull(begin, end); }); });
+        jobs.destroy();
+        return ms;
+    }
+
+    /** @brief The same pieces as JobSystem::parallelFor, submitted to the shared queue of a ThreadPool */
+    double runThreadPool(Scene &scene, uint32_t threads)
+    {
+        ThreadPool pool;
+        if (threads > 1)
+            pool.create(threads - 1);
+
+        uint32_t count = scene.getObjectCount();
+        uint32_t pieces = threads * 4;
+        uint32_t pieceSize = std::max(OBJECTS_PER_JOB, (count + pieces - 1) / pieces);
+
+        std::vector<std::future<void>> tasks;
+        double ms = timeFrames(scene, [&]()
+                               {
+            tasks.clear();
+            for (uint32_t begin = pieceSize; threads > 1 && begin < count; begin += pieceSize)
+            {
+                uint32_t end = std::min(count, begin + pieceSize);
+                tasks.push_back(pool.submit([&scene, begin, end]()
+                                            {
+                    scene.animate(begin, end);
+                    scene.cull(begin, end); }));
+            }
+
+            // Without workers the caller runs everything, like the job system does
+            uint32_t callerEnd = threads > 1 ? std::min(count, pieceSize) : count;
+            scene.animate(0, callerEnd);
+            scene.cull(0, callerEnd);
+            for (std::future<void> &task : tasks)
+                task.get(); });
+
+        pool.destroy();
+        return ms;
+    }
+
+    double runGraph(Scene &scene, uint32_t threads)
+    {
+        JobSystem jobs;
+        jobs.create(threads);
+
+        uint32_t count = scene.getObjectCount();
+        uint32_t chunkCount = (count + OBJECTS_PER_CHUNK - 1) / OBJECTS_PER_CHUNK;
+        std::unique_ptr<JobCounter[]> animated(new JobCounter[chunkCount]);
+
+        double ms = timeFrames(scene, [&]()
+                               {
+            JobCounter culled;
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+            {
+                uint32_t begin = chunk * OBJECTS_PER_CHUNK;
+                uint32_t end = std::min(count, begin + OBJECTS_PER_CHUNK);
+                jobs.run([&scene, begin, end]()
+                         { scene.animate(begin, end); },
+                         &animated[chunk]);
+                jobs.run([&scene, begin, end]()
+                         { scene.cull(begin, end); },
+                         &culled, &animated[chunk]);
+            }
+            jobs.wait(culled); });
+
+        jobs.destroy();
+        return ms;
+    }
+
+    void printRow(const char *name, uint32_t threads, double ms, double singleThreadMs)
+    {
+        std::printf("  %-12s %2u thread%s: %8.3f ms, %5.2fx vs 1 thread\n", name, threads, threads == 1 ? " " : "s", ms, singleThreadMs / ms);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t maxThreads = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : std::max(1u, std::thread::hardware_concurrency());
+    maxThreads = std::max(1u, maxThreads);
+
+    for (uint32_t objectCount : OBJECT_COUNTS)
+    {
+        Scene scene;
+        scene.init(objectCount);
+        std::printf("%u objects\n", objectCount);
+
+        double parallelForBase = 0.0;
+        double threadPoolBase = 0.0;
+        double graphBase = 0.0;
+        for (uint32_t threads = 1; threads <= maxThreads; threads++)
+        {
+            double parallelForMs = runParallelFor(scene, threads);
+            double threadPoolMs = runThreadPool(scene, threads);
+            double graphMs = runGraph(scene, threads);
+            if (threads == 1)
+            {
+                parallelForBase = parallelForMs;
+                threadPoolBase = threadPoolMs;
+                graphBase = graphMs;
+            }
+
+            printRow("parallelFor", threads, parallelForMs, parallelForBase);
+            printRow("ThreadPool", threads, threadPoolMs, threadPoolBase);
+            printRow("graph", threads, graphMs, graphBase);
+        }
+    }
+    return 0;
+}
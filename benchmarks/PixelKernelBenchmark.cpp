@@ -0,0 +1,215 @@
+// Pixel format conversion throughput of every kernel version the CPU supports.
+//
+//   PixelKernelBenchmark [image]
+//
+// Runs each kernel on the decoded image, by default the shipped res/textures/textures.jpg, and
+// compares the vector versions with the scalar one. Outputs are checked to be identical.
+
+#include "Backend/PixelKernels.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef PIXEL_BENCHMARK_IMAGE
+#define PIXEL_BENCHMARK_IMAGE "res/textures/textures.jpg"
+#endif
+
+namespace
+{
+    const uint32_t REPEATS = 7;
+    const double MIN_SECONDS_PER_REPEAT = 0.05;
+
+    using Clock = std::chrono::high_resolution_clock;
+    using PixelKernels::Isa;
+
+    /** @brief Best time of one call over several repeats, each repeat long enough to ignore timer resolution */
+    double measureNs(const std::function<void()> &kernel)
+    {
+        double best = 1e30;
+        for (uint32_t repeat = 0; repeat < REPEATS; repeat++)
+        {
+            uint32_t calls = 0;
+            auto start = Clock::now();
+            double elapsed = 0.0;
+            do
+            {
+                kernel();
+                calls++;
+                elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            } while (elapsed < MIN_SECONDS_PER_REPEAT);
+            best = std::min(best, elapsed * 1e9 / calls);
+        }
+        return best;
+    }
+
+    struct Image
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> rgb;
+        std::vector<uint8_t> rgba;
+        std::vector<float> linear;
+
+        size_t getPixelCount() const { return static_cast<size_t>(width) * height; }
+    };
+
+    struct Kernel
+    {
+        const char *name;
+        size_t outputSize;
+        std::function<void(const PixelKernels::KernelTable &, uint8_t *)> run;
+    };
+
+    std::vector<Kernel> buildKernels(const Image &image)
+    {
+        size_t count = image.getPixelCount();
+        size_t halfSize = static_cast<size_t>(std::max(1u, image.width / 2)) * std::max(1u, image.height / 2) * 4;
+        std::vector<Kernel> kernels;
+
+        kernels.push_back({"rgb to rgba", count * 4, [&image, count](const PixelKernels::KernelTable &table, uint8_t *out)
+                           { table.rgbToRgba(image.rgb.data(), out, count); }});
+        kernels.push_back({"bgra swizzle", count * 4, [&image, count](const PixelKernels::KernelTable &table, uint8_t *out)
+                           { table.swizzleRedBlue(image.rgba.data(), out, count); }});
+        kernels.push_back({"premultiply", count * 4, [&image, count](const PixelKernels::KernelTable &table, uint8_t *out)
+                           { table.premultiplyAlpha(image.rgba.data(), out, count); }});
+        kernels.push_back({"srgb to linear", count * 4 * sizeof(float), [&image, count](const PixelKernels::KernelTable &table, uint8_t *out)
+                           { table.srgbToLinear(image.rgba.data(), reinterpret_cast<float *>(out), count); }});
+        kernels.push_back({"linear to srgb", count * 4, [&image, count](const PixelKernels::KernelTable &table, uint8_t *out)
+                           { table.linearToSrgb(image.linear.data(), out, count); }});
+        kernels.push_back({"downsample", halfSize, [&image](const PixelKernels::KernelTable &table, uint8_t *out)
+                           { table.downsample2x(image.rgba.data(), image.width, image.height, out, false); }});
+        kernels.push_back({"downsample srgb", halfSize, [&image](const PixelKernels::KernelTable &table, uint8_t *out)
+                           { table.downsample2x(image.rgba.data(), image.width, image.height, out, true); }});
+        return kernels;
+    }
+
+    void benchmarkKernels(const Image &image)
+    {
+        std::vector<Isa> isas = {Isa::Scalar};
+        if (PixelKernels::getSupportedIsa() >= Isa::SSE2)
+            isas.push_back(Isa::SSE2);
+        if (PixelKernels::getSupportedIsa() >= Isa::AVX2)
+            isas.push_back(Isa::AVX2);
+
+        double megapixels = image.getPixelCount() / 1e6;
+        std::printf("%ux%u, %s selected at runtime\n", image.width, image.height, PixelKernels::getIsaName(PixelKernels::getSupportedIsa()));
+        std::printf("  %-16s %-7s %10s %10s %8s\n", "kernel", "isa", "us", "MPix/s", "speedup");
+
+        for (const Kernel &kernel : buildKernels(image))
+        {
+            // Floats are compared bitwise, every version must match exactly
+            std::vector<uint8_t> reference(kernel.outputSize);
+            std::vector<uint8_t> output(kernel.outputSize);
+            kernel.run(PixelKernels::getKernels(Isa::Scalar), reference.data());
+            double scalarNs = 0.0;
+
+            for (Isa isa : isas)
+            {
+                const PixelKernels::KernelTable &table = PixelKernels::getKernels(isa);
+                kernel.run(table, output.data());
+                bool identical = output == reference;
+
+                double ns = measureNs([&]()
+                                      { kernel.run(table, output.data()); });
+                if (isa == Isa::Scalar)
+                    scalarNs = ns;
+
+                std::printf("  %-16s %-7s %10.1f %10.1f %7.2fx%s\n", kernel.name, PixelKernels::getIsaName(isa), ns / 1e3,
+                            megapixels / (ns / 1e9), scalarNs / ns, identical ? "" : "  OUTPUT DIFFERS");
+            }
+        }
+    }
+
+    /** @brief Uncompressed 24 bit TGA, a format stb expands to RGBA with its scalar channel conversion */
+    std::vector<uint8_t> encodeTga(const Image &image)
+    {
+        std::vector<uint8_t> file(18 + image.rgb.size());
+        file[2] = 2;
+        file[12] = static_cast<uint8_t>(image.width);
+        file[13] = static_cast<uint8_t>(image.width >> 8);
+        file[14] = static_cast<uint8_t>(image.height);
+        file[15] = static_cast<uint8_t>(image.height >> 8);
+        file[16] = 24;
+        file[17] = 0x20; // top-left origin
+        for (size_t i = 0; i < image.getPixelCount(); i++)
+        {
+            file[18 + i * 3] = image.rgb[i * 3 + 2];
+            file[18 + i * 3 + 1] = image.rgb[i * 3 + 1];
+            file[18 + i * 3 + 2] = image.rgb[i * 3];
+        }
+        return file;
+    }
+
+    /** @brief stb's own RGB to RGBA expansion against decoding RGB and expanding with the kernels */
+    void benchmarkDecode(const char *name, const std::vector<uint8_t> &file)
+    {
+        int width, height, channels;
+        double stbNs = measureNs([&]()
+                                 { stbi_image_free(stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, STBI_rgb_alpha)); });
+
+        std::vector<uint8_t> rgba;
+        double kernelNs = measureNs([&]()
+                                    {
+                                        stbi_uc *rgb = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, STBI_rgb);
+                                        size_t count = static_cast<size_t>(width) * height;
+                                        rgba.resize(count * 4);
+                                        PixelKernels::getKernels().rgbToRgba(rgb, rgba.data(), count);
+                                        stbi_image_free(rgb); });
+
+        std::printf("Decode %s to RGBA8\n", name);
+        std::printf("  stb_image rgb_alpha:        %10.1f us\n", stbNs / 1e3);
+        std::printf("  stb_image rgb + rgbToRgba:  %10.1f us (%.2fx)\n", kernelNs / 1e3, stbNs / kernelNs);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string path = argc > 1 ? argv[1] : PIXEL_BENCHMARK_IMAGE;
+
+    std::ifstream input(path, std::ios::ate | std::ios::binary);
+    if (!input.is_open())
+    {
+        std::fprintf(stderr, "failed to open %s\n", path.c_str());
+        return 1;
+    }
+    std::vector<uint8_t> file(static_cast<size_t>(input.tellg()));
+    input.seekg(0);
+    input.read(reinterpret_cast<char *>(file.data()), static_cast<std::streamsize>(file.size()));
+
+    int width, height, channels;
+    stbi_uc *rgb = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, STBI_rgb);
+    if (!rgb)
+    {
+        std::fprintf(stderr, "failed to decode %s\n", path.c_str());
+        return 1;
+    }
+
+    Image image;
+    image.width = static_cast<uint32_t>(width);
+    image.height = static_cast<uint32_t>(height);
+    image.rgb.assign(rgb, rgb + image.getPixelCount() * 3);
+    stbi_image_free(rgb);
+
+    // Vary alpha so premultiplication has work to do
+    image.rgba.resize(image.getPixelCount() * 4);
+    PixelKernels::getKernels(Isa::Scalar).rgbToRgba(image.rgb.data(), image.rgba.data(), image.getPixelCount());
+    for (size_t i = 0; i < image.getPixelCount(); i++)
+        image.rgba[i * 4 + 3] = static_cast<uint8_t>(i * 7);
+
+    image.linear.resize(image.getPixelCount() * 4);
+    PixelKernels::getKernels(Isa::Scalar).srgbToLinear(image.rgba.data(), image.linear.data(), image.getPixelCount());
+
+    benchmarkKernels(image);
+    // JPEG colour conversion writes RGBA directly, other formats go through stb's per pixel expansion
+    benchmarkDecode("jpeg", file);
+    benchmarkDecode("tga", encodeTga(image));
+    return 0;
+}
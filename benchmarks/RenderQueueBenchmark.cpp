@@ -0,0 +1,199 @@
+// Binds and CPU cost of recording a scene in insertion order versus through the sorted RenderQueue.
+//
+// Every draw gets a random pipeline, material (descriptor set) and mesh, the worst case for a scene
+// that is drawn in the order it was loaded. Three ways of recording it are compared:
+//   - insertion order, binding everything for every draw (encoder filtering off)
+//   - insertion order, with the VulkanCommandEncoder dropping binds of what is already bound
+//   - RenderQueue sorted by key first, then filtered, the sort is included in the frame time
+// The benchmark scene has one pipeline and descriptor set, so ids map to the same handles. Recording a
+// bind costs the same whichever handle it names. Nothing is submitted (lavapipe if installed).
+
+#include "Backend/RenderQueue.h"
+#include "Backend/VulkanCommandEncoder.h"
+#include "Backend/VulkanMemoryAllocator.h"
+#include "BenchmarkDevice.h"
+#include "BenchmarkScene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#ifndef BENCHMARK_SHADER_DIR
+#define BENCHMARK_SHADER_DIR "res/shaders"
+#endif
+
+namespace
+{
+    const uint32_t DRAW_COUNTS[] = {1000, 10000, 50000};
+    const uint32_t PIPELINES = 8;
+    const uint32_t MATERIALS = 64;
+    const uint32_t MESHES = 32;
+    const uint32_t FRAMES = 40;
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct Draw
+    {
+        uint32_t pipeline;
+        uint32_t material;
+        uint32_t mesh;
+        float depth;
+    };
+
+    struct Result
+    {
+        double averageMs = 0.0;
+        VulkanCommandEncoder::Statistics statistics;
+    };
+
+    template <typename RecordFrame>
+    Result timeFrames(VkDevice device, VkCommandPool pool, VkCommandBuffer commandBuffer, const BenchmarkScene &scene, bool filtering, RecordFrame &&recordFrame)
+    {
+        Result result;
+        double totalMs = 0.0;
+        for (uint32_t frame = 0; frame <= FRAMES; frame++)
+        {
+            VulkanCommandEncoder encoder(commandBuffer);
+            encoder.setFiltering(filtering);
+            auto start = Clock::now();
+
+            vkResetCommandPool(device, pool, 0);
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(commandBuffer, &beginInfo);
+            scene.beginRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+            VkViewport viewport{0.0f, 0.0f, static_cast<float>(BenchmarkScene::TARGET_SIZE), static_cast<float>(BenchmarkScene::TARGET_SIZE), 0.0f, 1.0f};
+            encoder.setViewport(viewport);
+            VkRect2D scissor{{0, 0}, {BenchmarkScene::TARGET_SIZE, BenchmarkScene::TARGET_SIZE}};
+            encoder.setScissor(scissor);
+
+            recordFrame(encoder);
+
+            vkCmdEndRenderPass(commandBuffer);
+            vkEndCommandBuffer(commandBuffer);
+
+            // The first frame warms up the pool and the queue's storage
+            if (frame == 0)
+                continue;
+            totalMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            result.statistics = encoder.getStatistics();
+        }
+        result.averageMs = totalMs / FRAMES;
+        return result;
+    }
+
+    void printResult(const char *name, const Result &result)
+    {
+        using Command = VulkanCommandEncoder::Command;
+        const VulkanCommandEncoder::Statistics &statistics = result.statistics;
+        unsigned long long pipelines = statistics.getIssued(Command::BindPipeline);
+        unsigned long long sets = statistics.getIssued(Command::BindDescriptorSets);
+        unsigned long long vertexBuffers = statistics.getIssued(Command::BindVertexBuffers);
+        unsigned long long indexBuffers = statistics.getIssued(Command::BindIndexBuffer);
+        std::printf("  %-26s %8.3f ms, %7llu binds (%llu pipeline, %llu set, %llu vertex, %llu index), %llu elided\n", name, result.averageMs,
+                    pipelines + sets + vertexBuffers + indexBuffers, pipelines, sets, vertexBuffers, indexBuffers,
+                    static_cast<unsigned long long>(statistics.getElidedTotal()));
+    }
+
+    void benchmarkRenderQueue(const BenchmarkDevice &bench, VulkanMemoryAllocator &allocator)
+    {
+        BenchmarkScene scene;
+        scene.init(bench, allocator, BENCHMARK_SHADER_DIR, MESHES);
+
+        RenderQueueBindings bindings;
+        bindings.pipelines.assign(PIPELINES, RenderQueuePipeline{scene.pipeline, scene.pipelineLayout});
+        bindings.descriptorSets.assign(MATERIALS, scene.descriptorSet);
+        for (uint32_t mesh = 0; mesh < MESHES; mesh++)
+        {
+            RenderQueueMesh queueMesh{};
+            queueMesh.vertexBuffer = scene.vertexBuffer;
+            queueMesh.vertexOffset = static_cast<VkDeviceSize>(mesh) * 4 * BenchmarkScene::VERTEX_STRIDE;
+            queueMesh.indexBuffer = scene.indexBuffer;
+            queueMesh.indexType = VK_INDEX_TYPE_UINT16;
+            queueMesh.indexCount = 6;
+            bindings.meshes.push_back(queueMesh);
+        }
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = bench.queueFamily;
+        VkCommandPool pool;
+        vkCreateCommandPool(bench.device, &poolInfo, nullptr, &pool);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        vkAllocateCommandBuffers(bench.device, &allocInfo, &commandBuffer);
+
+        std::mt19937 rng(42);
+        RenderQueue queue;
+        for (uint32_t drawCount : DRAW_COUNTS)
+        {
+            std::vector<Draw> draws(drawCount);
+            for (Draw &draw : draws)
+            {
+                draw.pipeline = rng() % PIPELINES;
+                draw.material = rng() % MATERIALS;
+                draw.mesh = rng() % MESHES;
+                draw.depth = std::uniform_real_distribution<float>(0.1f, 100.0f)(rng);
+            }
+
+            std::printf("%u draws, %u pipelines, %u materials, %u meshes\n", drawCount, PIPELINES, MATERIALS, MESHES);
+
+            auto fillQueue = [&]()
+            {
+                queue.clear();
+                for (uint32_t i = 0; i < drawCount; i++)
+                    queue.push(0, draws[i].pipeline, draws[i].material, draws[i].mesh, draws[i].depth, i);
+            };
+
+            Result everyBind = timeFrames(bench.device, pool, commandBuffer, scene, false, [&](VulkanCommandEncoder &encoder)
+                                          {
+                fillQueue();
+                queue.record(encoder, bindings, 0, queue.size()); });
+            printResult("insertion, every bind:", everyBind);
+
+            Result filtered = timeFrames(bench.device, pool, commandBuffer, scene, true, [&](VulkanCommandEncoder &encoder)
+                                         {
+                fillQueue();
+                queue.record(encoder, bindings, 0, queue.size()); });
+            printResult("insertion, filtered:", filtered);
+
+            double sortMs = 0.0;
+            Result sorted = timeFrames(bench.device, pool, commandBuffer, scene, true, [&](VulkanCommandEncoder &encoder)
+                                       {
+                fillQueue();
+                auto sortStart = Clock::now();
+                queue.sort();
+                sortMs = std::chrono::duration<double, std::milli>(Clock::now() - sortStart).count();
+                queue.record(encoder, bindings, 0, queue.size()); });
+            printResult("sorted, filtered:", sorted);
+            std::printf("  %-26s %8.3f ms of the sorted frame, which is %5.2fx faster than every bind\n", "radix sort:", sortMs, everyBind.averageMs / sorted.averageMs);
+        }
+
+        vkDestroyCommandPool(bench.device, pool, nullptr);
+        scene.cleanup();
+    }
+}
+
+int main()
+{
+    BenchmarkDevice bench;
+    if (bench.init())
+    {
+        VulkanMemoryAllocator allocator;
+        allocator.init(bench.physicalDevice, bench.device);
+        benchmarkRenderQueue(bench, allocator);
+        allocator.destroy();
+    }
+    bench.cleanup();
+    return 0;
+}
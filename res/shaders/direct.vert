@@ -0,0 +1,20 @@
+#version 450
+
+// Per draw data of draws issued one by one, DrawConstants in Engine.cpp
+layout(push_constant) uniform DrawConstants {
+    mat4 modelViewProjection;
+    uint objectIndex;
+} draw;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main() {
+    gl_Position = draw.modelViewProjection * vec4(inPosition, 1.0);
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+}
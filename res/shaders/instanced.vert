@@ -0,0 +1,24 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProjection;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+// Per instance stream, InstanceData in Engine.cpp
+layout(location = 3) in mat4 inInstanceModel;
+layout(location = 7) in vec4 inInstanceTint;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main() {
+    gl_Position = ubo.viewProjection * (inInstanceModel * vec4(inPosition, 1.0));
+    fragColor = inColor * inInstanceTint.rgb;
+    fragTexCoord = inTexCoord;
+}
@@ -0,0 +1,29 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProjection;
+} ubo;
+
+struct ObjectData {
+    mat4 model;
+};
+
+// One entry per object, draws select theirs through firstInstance
+layout(std430, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main() {
+    gl_Position = ubo.viewProjection * (objects[gl_InstanceIndex].model * vec4(inPosition, 1.0));
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+}
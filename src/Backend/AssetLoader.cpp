@@ -0,0 +1,226 @@
+#include "AssetLoader.h"
+#include "Ktx2.h"
+#include "PixelKernels.h"
+#include "TextureCompression.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    std::shared_ptr<const unsigned char> ownMalloced(unsigned char *data)
+    {
+        return std::shared_ptr<const unsigned char>(data, [](const unsigned char *p)
+                                                    { free(const_cast<unsigned char *>(p)); });
+    }
+}
+
+void AssetLoader::create(std::function<bool(VkFormat)> isFormatSupported, JobSystem &jobs, const AssetPack *pack)
+{
+    this->isFormatSupported = std::move(isFormatSupported);
+    this->jobs = &jobs;
+    this->pack = pack;
+}
+
+void AssetLoader::destroy()
+{
+    if (jobs)
+        jobs->wait(decodes);
+    jobs = nullptr;
+
+    completed.clear();
+    pendingCount = 0;
+    pack = nullptr;
+}
+
+AssetHandle AssetLoader::loadImage(const std::string &path)
+{
+    AssetHandle handle = nextHandle++;
+    pendingCount++;
+
+    jobs->runBackground([this, handle, path]()
+                        { decodeImage(handle, path); },
+                        &decodes);
+
+    return handle;
+}
+
+void AssetLoader::decodeImage(AssetHandle handle, const std::string &path)
+{
+    LoadedImage image{};
+    image.handle = handle;
+    image.path = path;
+
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+    std::shared_ptr<const unsigned char> storage;
+
+    // Anything that cannot be read or decoded is returned without pixels, the caller reports it
+    bool found = readAsset(path, data, size, storage);
+    if (found && path.size() >= 5 && path.compare(path.size() - 5, 5, ".ktx2") == 0)
+    {
+        loadKtx2(image, data, size, std::move(storage));
+    }
+    else if (found)
+    {
+        decodeWithStb(image, data, size);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    completed.push_back(std::move(image));
+}
+
+bool AssetLoader::readAsset(const std::string &path, const unsigned char *&data, size_t &size, std::shared_ptr<const unsigned char> &storage)
+{
+    uint32_t entry = pack ? pack->find(path) : AssetPack::INVALID_ENTRY;
+    if (entry != AssetPack::INVALID_ENTRY)
+    {
+        size = static_cast<size_t>(pack->getSize(entry));
+
+        // Stored entries are used where they are mapped
+        data = pack->getData(entry);
+        if (data)
+            return true;
+
+        unsigned char *expanded = static_cast<unsigned char *>(malloc(size));
+        if (!expanded || !pack->read(entry, expanded))
+        {
+            free(expanded);
+            return false;
+        }
+        storage = ownMalloced(expanded);
+        data = expanded;
+        return true;
+    }
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char *contents = fileSize > 0 ? static_cast<unsigned char *>(malloc(static_cast<size_t>(fileSize))) : nullptr;
+    bool complete = contents && fread(contents, 1, static_cast<size_t>(fileSize), file) == static_cast<size_t>(fileSize);
+    fclose(file);
+
+    if (!complete)
+    {
+        free(contents);
+        return false;
+    }
+
+    storage = ownMalloced(contents);
+    data = contents;
+    size = static_cast<size_t>(fileSize);
+    return true;
+}
+
+void AssetLoader::decodeWithStb(LoadedImage &image, const unsigned char *data, size_t size)
+{
+    int texWidth, texHeight, texChannels;
+    if (!stbi_info_from_memory(data, static_cast<int>(size), &texWidth, &texHeight, &texChannels))
+        return;
+
+    // stb's JPEG colour conversion writes RGBA directly, other RGB formats are expanded one pixel at a time by
+    // stb, so those are decoded as RGB and expanded here
+    bool isJpeg = size >= 2 && data[0] == 0xff && data[1] == 0xd8;
+    int requestedChannels = texChannels == 3 && !isJpeg ? STBI_rgb : STBI_rgb_alpha;
+    stbi_uc *decoded = stbi_load_from_memory(data, static_cast<int>(size), &texWidth, &texHeight, &texChannels, requestedChannels);
+    if (!decoded)
+        return;
+
+    size_t pixelCount = static_cast<size_t>(texWidth) * texHeight;
+    unsigned char *pixels = decoded;
+    if (requestedChannels == STBI_rgb)
+    {
+        pixels = static_cast<unsigned char *>(malloc(pixelCount * 4));
+        if (pixels)
+            PixelKernels::getKernels().rgbToRgba(decoded, pixels, pixelCount);
+        stbi_image_free(decoded);
+        if (!pixels)
+            return;
+    }
+
+    image.pixels = pixels;
+    if (pixels == decoded)
+        image.storage = std::shared_ptr<const unsigned char>(decoded, [](const unsigned char *p)
+                                                             { stbi_image_free(const_cast<unsigned char *>(p)); });
+    else
+        image.storage = ownMalloced(pixels);
+    image.format = VK_FORMAT_R8G8B8A8_SRGB;
+    image.width = static_cast<uint32_t>(texWidth);
+    image.height = static_cast<uint32_t>(texHeight);
+    image.levels.push_back({image.width, image.height, 0, pixelCount * 4});
+}
+
+void AssetLoader::loadKtx2(LoadedImage &image, const unsigned char *data, size_t size, std::shared_ptr<const unsigned char> storage)
+{
+    Ktx2Texture texture;
+    if (!Ktx2::read(data, size, texture))
+        return;
+
+    image.format = texture.format;
+    image.width = texture.width;
+    image.height = texture.height;
+    for (const Ktx2Level &level : texture.levels)
+        image.levels.push_back({level.width, level.height, static_cast<size_t>(level.offset), static_cast<size_t>(level.size)});
+
+    if (!isFormatSupported || isFormatSupported(image.format))
+    {
+        image.pixels = data;
+        image.storage = std::move(storage);
+        return;
+    }
+
+    // Software fallback for block formats the device cannot sample
+    if (!TextureCompression::canDecode(image.format))
+    {
+        image.levels.clear();
+        return;
+    }
+
+    size_t decodedSize = 0;
+    for (const LoadedImageLevel &level : image.levels)
+        decodedSize += static_cast<size_t>(level.width) * level.height * 4;
+
+    unsigned char *decoded = static_cast<unsigned char *>(malloc(decodedSize));
+    size_t offset = 0;
+    bool decodedAll = decoded != nullptr;
+    for (LoadedImageLevel &level : image.levels)
+    {
+        if (!decodedAll)
+            break;
+
+        decodedAll = TextureCompression::decodeImage(image.format, data + level.offset, level.width, level.height, decoded + offset);
+        level.offset = offset;
+        level.size = static_cast<size_t>(level.width) * level.height * 4;
+        offset += level.size;
+    }
+
+    if (!decodedAll)
+    {
+        free(decoded);
+        image.levels.clear();
+        return;
+    }
+
+    image.format = TextureCompression::getDecodedFormat(image.format);
+    image.pixels = decoded;
+    image.storage = ownMalloced(decoded);
+}
+
+void AssetLoader::collectLoaded(std::vector<LoadedImage> &loaded)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    pendingCount -= static_cast<uint32_t>(completed.size());
+    for (LoadedImage &image : completed)
+        loaded.push_back(std::move(image));
+    completed.clear();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AssetPack.h"
+#include "JobSystem.h"
+
+typedef uint32_t AssetHandle;
+
+struct LoadedImageLevel
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+/** @brief A loaded image in a format the device can sample, level 0 first */
+struct LoadedImage
+{
+    AssetHandle handle = 0;
+    std::string path;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    /** @brief Level data at the offsets given in levels, null if loading failed */
+    const unsigned char *pixels = nullptr;
+    /** @brief Owns pixels when they were read or decoded, empty when they point straight into a mapped asset pack */
+    std::shared_ptr<const unsigned char> storage;
+    std::vector<LoadedImageLevel> levels;
+};
+
+/**
+ * @brief Decodes assets as background jobs of a JobSystem, so they only take threads the frame leaves idle
+ *
+ * Requests return a handle right away. Finished results are queued until the render thread picks
+ * them up with collectLoaded() and uploads them, so nothing here touches the device.
+ */
+class AssetLoader
+{
+public:
+    /**
+     * @param isFormatSupported Called from the workers; KTX2 textures in formats it rejects are decompressed to RGBA8
+     * @param pack Searched before the file system, must stay open until destroy()
+     * @param jobs Runs the decodes, must outlive the loader
+     */
+    void create(std::function<bool(VkFormat)> isFormatSupported, JobSystem &jobs, const AssetPack *pack = nullptr);
+    /** @brief Waits for decodes that are still running and frees results nobody collected */
+    void destroy();
+
+    /**
+     * @brief Loads a .ktx2 texture as stored, anything else is decoded by stb_image to a single RGBA8 level
+     *
+     * path is looked up as an entry name in the pack first and opened as a file if the pack lacks it.
+     * Usable KTX2 data in a stored pack entry is returned in place without being copied.
+     */
+    AssetHandle loadImage(const std::string &path);
+    /** @brief Appends every result finished since the last call to loaded, never blocks */
+    void collectLoaded(std::vector<LoadedImage> &loaded);
+
+    /** @brief Requests not collected yet, whether still decoding or waiting in the queue */
+    uint32_t getPendingCount() const { return pendingCount.load(); }
+
+private:
+    JobSystem *jobs = nullptr;
+    JobCounter decodes;
+    std::function<bool(VkFormat)> isFormatSupported;
+    const AssetPack *pack = nullptr;
+    std::mutex mutex;
+    std::vector<LoadedImage> completed;
+    AssetHandle nextHandle = 1;
+    std::atomic<uint32_t> pendingCount{0};
+
+    /** @brief Runs as a background job */
+    void decodeImage(AssetHandle handle, const std::string &path);
+    /** @brief Points data at the asset's bytes, storage is left empty when they live in the pack mapping */
+    bool readAsset(const std::string &path, const unsigned char *&data, size_t &size, std::shared_ptr<const unsigned char> &storage);
+    void decodeWithStb(LoadedImage &image, const unsigned char *data, size_t size);
+    void loadKtx2(LoadedImage &image, const unsigned char *data, size_t size, std::shared_ptr<const unsigned char> storage);
+};
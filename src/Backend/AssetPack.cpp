@@ -0,0 +1,244 @@
+#include "AssetPack.h"
+#include "Lz4.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace AssetPackFormat;
+
+uint64_t AssetPackFormat::hashName(const std::string &name)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool AssetPack::open(const std::string &path)
+{
+    close();
+
+    if (!mapFile(path))
+        return false;
+
+    if (!validate())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void AssetPack::close()
+{
+    unmapFile();
+    entries = nullptr;
+    chunks = nullptr;
+    names = nullptr;
+    entryCount = 0;
+}
+
+#ifdef _WIN32
+bool AssetPack::mapFile(const std::string &path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *view = fileMapping ? MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        if (fileMapping)
+            CloseHandle(fileMapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = fileMapping;
+    mapping = static_cast<const uint8_t *>(view);
+    mappingSize = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void AssetPack::unmapFile()
+{
+    if (mapping)
+        UnmapViewOfFile(mapping);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+    mapping = nullptr;
+    mappingSize = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+#else
+bool AssetPack::mapFile(const std::string &path)
+{
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    // The mapping keeps the file referenced, the descriptor is not needed after mmap
+    void *view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED)
+        return false;
+
+    mapping = static_cast<const uint8_t *>(view);
+    mappingSize = static_cast<size_t>(status.st_size);
+    return true;
+}
+
+void AssetPack::unmapFile()
+{
+    if (mapping)
+        munmap(const_cast<uint8_t *>(mapping), mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+}
+#endif
+
+bool AssetPack::validate()
+{
+    if (mappingSize < sizeof(PackHeader))
+        return false;
+
+    PackHeader header;
+    memcpy(&header, mapping, sizeof(PackHeader));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+        return false;
+
+    uint64_t tableSize = static_cast<uint64_t>(header.entryCount) * sizeof(PackEntry) +
+                         static_cast<uint64_t>(header.chunkCount) * sizeof(PackChunk) + header.namesSize;
+    if (header.tocOffset % alignof(PackEntry) != 0 || header.tocOffset > mappingSize || tableSize > mappingSize - header.tocOffset)
+        return false;
+
+    entries = reinterpret_cast<const PackEntry *>(mapping + header.tocOffset);
+    chunks = reinterpret_cast<const PackChunk *>(entries + header.entryCount);
+    names = reinterpret_cast<const char *>(chunks + header.chunkCount);
+    entryCount = header.entryCount;
+
+    // Check every range once here so lookups and reads can trust the tables
+    for (uint32_t i = 0; i < entryCount; i++)
+    {
+        const PackEntry &entry = entries[i];
+        if (static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > header.namesSize)
+            return false;
+        if (i > 0 && entries[i - 1].nameHash > entry.nameHash)
+            return false;
+
+        if ((entry.flags & ENTRY_COMPRESSED) == 0)
+        {
+            if (entry.offset % BLOB_ALIGNMENT != 0 || entry.offset > mappingSize || entry.size > mappingSize - entry.offset)
+                return false;
+            continue;
+        }
+
+        if (static_cast<uint64_t>(entry.firstChunk) + entry.chunkCount > header.chunkCount)
+            return false;
+
+        uint64_t size = 0;
+        for (uint32_t c = 0; c < entry.chunkCount; c++)
+        {
+            const PackChunk &chunk = chunks[entry.firstChunk + c];
+            if (chunk.offset > mappingSize || chunk.storedSize > mappingSize - chunk.offset || chunk.storedSize > chunk.size)
+                return false;
+            size += chunk.size;
+        }
+        if (size != entry.size)
+            return false;
+    }
+    return true;
+}
+
+uint32_t AssetPack::find(const std::string &name) const
+{
+    uint64_t hash = hashName(name);
+
+    uint32_t first = 0;
+    uint32_t count = entryCount;
+    while (count > 0)
+    {
+        uint32_t step = count / 2;
+        if (entries[first + step].nameHash < hash)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+
+    for (uint32_t i = first; i < entryCount && entries[i].nameHash == hash; i++)
+    {
+        const PackEntry &entry = entries[i];
+        if (entry.nameLength == name.size() && memcmp(names + entry.nameOffset, name.data(), name.size()) == 0)
+            return i;
+    }
+    return INVALID_ENTRY;
+}
+
+const uint8_t *AssetPack::getData(uint32_t entry) const
+{
+    if (isCompressed(entry))
+        return nullptr;
+    return mapping + entries[entry].offset;
+}
+
+bool AssetPack::read(uint32_t entry, void *dst) const
+{
+    const PackEntry &packEntry = entries[entry];
+    uint8_t *out = static_cast<uint8_t *>(dst);
+
+    if (!isCompressed(entry))
+    {
+        memcpy(out, mapping + packEntry.offset, static_cast<size_t>(packEntry.size));
+        return true;
+    }
+
+    for (uint32_t c = 0; c < packEntry.chunkCount; c++)
+    {
+        const PackChunk &chunk = chunks[packEntry.firstChunk + c];
+        const uint8_t *stored = mapping + chunk.offset;
+
+        if (chunk.storedSize == chunk.size)
+            memcpy(out, stored, chunk.size);
+        else if (!Lz4::decompress(stored, chunk.storedSize, out, chunk.size))
+            return false;
+        out += chunk.size;
+    }
+    return true;
+}
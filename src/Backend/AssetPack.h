@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief On-disk layout of an asset pack
+ *
+ * [PackHeader][blobs, each aligned to PACK_BLOB_ALIGNMENT][PackEntry x entryCount][PackChunk x chunkCount][names]
+ *
+ * Entries are sorted by name hash. A stored entry is one contiguous blob that is used in place. A
+ * compressed entry is split into chunks of PACK_CHUNK_SIZE bytes that are LZ4 compressed one by one,
+ * chunks that did not shrink are kept raw (storedSize == size).
+ */
+namespace AssetPackFormat
+{
+    const char MAGIC[8] = {'E', 'N', 'G', 'P', 'A', 'C', 'K', 0};
+    const uint32_t VERSION = 1;
+    const uint64_t BLOB_ALIGNMENT = 64;
+    const uint32_t CHUNK_SIZE = 256 * 1024;
+    const uint32_t ENTRY_COMPRESSED = 0x1;
+
+    struct PackHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t chunkCount;
+        uint32_t namesSize;
+        uint64_t tocOffset;
+    };
+    static_assert(sizeof(PackHeader) == 32, "pack header must be tightly packed");
+
+    struct PackEntry
+    {
+        uint64_t nameHash;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t firstChunk;
+        uint32_t chunkCount;
+        uint32_t flags;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(PackEntry) == 48, "pack entry must be tightly packed");
+
+    struct PackChunk
+    {
+        uint64_t offset;
+        uint32_t storedSize;
+        uint32_t size;
+    };
+    static_assert(sizeof(PackChunk) == 16, "pack chunk must be tightly packed");
+
+    /** @brief FNV-1a of the entry name, names are relative to res/ with forward slashes */
+    uint64_t hashName(const std::string &name);
+}
+
+/**
+ * @brief Read-only view of a memory mapped asset pack
+ *
+ * Stored entries are returned as pointers into the mapping so they can be copied straight into
+ * staging memory. Everything is immutable after open(), lookups and reads are safe from any thread.
+ */
+class AssetPack
+{
+public:
+    static const uint32_t INVALID_ENTRY = UINT32_MAX;
+
+    /** @return false if the file is missing or is not a valid pack */
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return mapping != nullptr; }
+
+    /** @return Index of the entry called name, INVALID_ENTRY if there is none */
+    uint32_t find(const std::string &name) const;
+
+    /** @brief Uncompressed size of an entry */
+    uint64_t getSize(uint32_t entry) const { return entries[entry].size; }
+    bool isCompressed(uint32_t entry) const { return (entries[entry].flags & AssetPackFormat::ENTRY_COMPRESSED) != 0; }
+    /** @brief Entry data inside the mapping, aligned to BLOB_ALIGNMENT. Null for compressed entries */
+    const uint8_t *getData(uint32_t entry) const;
+
+    /** @brief Copies or decompresses an entry into dst, which must hold getSize() bytes */
+    bool read(uint32_t entry, void *dst) const;
+
+private:
+    const uint8_t *mapping = nullptr;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+
+    const AssetPackFormat::PackEntry *entries = nullptr;
+    const AssetPackFormat::PackChunk *chunks = nullptr;
+    const char *names = nullptr;
+    uint32_t entryCount = 0;
+
+    bool mapFile(const std::string &path);
+    void unmapFile();
+    bool validate();
+};
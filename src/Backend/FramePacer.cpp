@@ -0,0 +1,130 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+void FramePacer::create(double frameRateLimit)
+{
+    this->frameRateLimit = frameRateLimit > 0.0 ? frameRateLimit : 0.0;
+    period = Duration(this->frameRateLimit > 0.0 ? 1.0 / this->frameRateLimit : 0.0);
+    started = false;
+
+    intervalFrameMs.clear();
+    intervalWaitMs = 0.0;
+    totalFrames = 0;
+    totalMs = 0.0;
+    totalWaitMs = 0.0;
+    totalMinMs = 0.0;
+    totalMaxMs = 0.0;
+}
+
+double FramePacer::waitUntil(Clock::time_point deadline)
+{
+    Clock::time_point waitStart = Clock::now();
+    Clock::time_point now = waitStart;
+
+    while (deadline - now > sleepMargin)
+    {
+        Duration request = deadline - now - sleepMargin;
+        std::this_thread::sleep_for(request);
+        Clock::time_point woken = Clock::now();
+
+        // Jump up to a late wake up right away, drift back down slowly so one lucky wake up does not cause a miss
+        Duration overshoot = std::max(Duration(woken - now) - request, Duration(0.0));
+        if (overshoot > sleepMargin)
+            sleepMargin = std::min(overshoot, Duration(MAX_SLEEP_MARGIN_SECONDS));
+        else
+            sleepMargin -= (sleepMargin - overshoot) / 16.0;
+        now = woken;
+    }
+
+    while (now < deadline)
+    {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+
+    return std::chrono::duration<double, std::milli>(now - waitStart).count();
+}
+
+void FramePacer::beginFrame()
+{
+    double waitMs = 0.0;
+    if (period.count() > 0.0)
+    {
+        Clock::time_point now = Clock::now();
+        if (!started || now > nextFrame + std::chrono::duration_cast<Clock::duration>(period))
+        {
+            nextFrame = now;
+        }
+        else
+        {
+            waitMs = waitUntil(nextFrame);
+        }
+        nextFrame += std::chrono::duration_cast<Clock::duration>(period);
+    }
+
+    Clock::time_point now = Clock::now();
+    if (!started)
+    {
+        started = true;
+        frameStart = now;
+        intervalStart = now;
+        return;
+    }
+
+    double frameMs = std::chrono::duration<double, std::milli>(now - frameStart).count();
+    frameStart = now;
+
+    intervalFrameMs.push_back(static_cast<float>(frameMs));
+    intervalWaitMs += waitMs;
+
+    totalMinMs = totalFrames == 0 ? frameMs : std::min(totalMinMs, frameMs);
+    totalMaxMs = totalFrames == 0 ? frameMs : std::max(totalMaxMs, frameMs);
+    totalFrames++;
+    totalMs += frameMs;
+    totalWaitMs += waitMs;
+}
+
+bool FramePacer::collect(double intervalSeconds, FrameTimeStatistics &statistics)
+{
+    if (!started || intervalFrameMs.empty() || Duration(frameStart - intervalStart).count() < intervalSeconds)
+        return false;
+
+    statistics = FrameTimeStatistics{};
+    statistics.frameCount = static_cast<uint32_t>(intervalFrameMs.size());
+
+    double sum = 0.0;
+    for (float frameMs : intervalFrameMs)
+        sum += frameMs;
+    statistics.averageMs = sum / statistics.frameCount;
+    statistics.limiterWaitMs = intervalWaitMs / statistics.frameCount;
+
+    auto [minFrame, maxFrame] = std::minmax_element(intervalFrameMs.begin(), intervalFrameMs.end());
+    statistics.minMs = *minFrame;
+    statistics.maxMs = *maxFrame;
+
+    // The frame that 99% of frames are at least as fast as, the order of the others does not matter
+    size_t percentileIndex = (intervalFrameMs.size() * 99) / 100;
+    std::nth_element(intervalFrameMs.begin(), intervalFrameMs.begin() + percentileIndex, intervalFrameMs.end());
+    statistics.percentile99Ms = intervalFrameMs[percentileIndex];
+
+    intervalFrameMs.clear();
+    intervalWaitMs = 0.0;
+    intervalStart = frameStart;
+    return true;
+}
+
+FrameTimeStatistics FramePacer::getTotal() const
+{
+    FrameTimeStatistics statistics;
+    if (totalFrames == 0)
+        return statistics;
+
+    statistics.frameCount = static_cast<uint32_t>(totalFrames);
+    statistics.averageMs = totalMs / totalFrames;
+    statistics.minMs = totalMinMs;
+    statistics.maxMs = totalMaxMs;
+    statistics.limiterWaitMs = totalWaitMs / totalFrames;
+    return statistics;
+}
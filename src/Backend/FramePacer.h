@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+
+/** @brief Frame times of a run of frames, measured from the start of one frame to the start of the next */
+struct FrameTimeStatistics
+{
+    uint32_t frameCount = 0;
+    double averageMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    /** @brief Only filled in by collect(), the totals keep no per frame times */
+    double percentile99Ms = 0.0;
+    /** @brief Average time per frame spent waiting in the limiter */
+    double limiterWaitMs = 0.0;
+
+    double getFrameRate() const { return averageMs > 0.0 ? 1000.0 / averageMs : 0.0; }
+};
+
+/**
+ * @brief Limits the frame rate of the main loop and keeps frame time statistics
+ *
+ * beginFrame() holds the frame back until one period after the previous one was due. Waiting sleeps
+ * for most of the remaining time and spins on the clock for the rest. How short of the deadline
+ * the sleep ends is adapted to how late the scheduler actually wakes up, so the spin stays short
+ * while the wake up still lands on time. A frame that runs more than a period late restarts the
+ * schedule instead of being followed by a burst of catch-up frames.
+ */
+class FramePacer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** @param frameRateLimit Frames per second, 0 only measures and leaves pacing to the present mode */
+    void create(double frameRateLimit);
+
+    /** @brief Waits until the next frame is due and starts it */
+    void beginFrame();
+
+    /** @brief Statistics of the frames since the last collect(), returns false until intervalSeconds have passed */
+    bool collect(double intervalSeconds, FrameTimeStatistics &statistics);
+    /** @brief Statistics of every frame since create() */
+    FrameTimeStatistics getTotal() const;
+
+    double getFrameRateLimit() const { return frameRateLimit; }
+
+private:
+    using Duration = std::chrono::duration<double>;
+
+    // Beyond this the scheduler is not keeping up anyway and sleeping less would mostly spin
+    static constexpr double MAX_SLEEP_MARGIN_SECONDS = 0.004;
+
+    double frameRateLimit = 0.0;
+    Duration period{0.0};
+    Duration sleepMargin{0.001};
+
+    bool started = false;
+    Clock::time_point frameStart;
+    Clock::time_point nextFrame;
+    Clock::time_point intervalStart;
+
+    std::vector<float> intervalFrameMs;
+    double intervalWaitMs = 0.0;
+
+    uint64_t totalFrames = 0;
+    double totalMs = 0.0;
+    double totalWaitMs = 0.0;
+    double totalMinMs = 0.0;
+    double totalMaxMs = 0.0;
+
+    /** @returns Milliseconds spent waiting */
+    double waitUntil(Clock::time_point deadline);
+};
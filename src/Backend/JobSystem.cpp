@@ -0,0 +1,264 @@
+#include "JobSystem.h"
+
+namespace
+{
+    // Lets run() find the deque of the calling thread without looking it up
+    thread_local const JobSystem *currentSystem = nullptr;
+    thread_local uint32_t currentIndex = 0;
+}
+
+void JobSystem::create(uint32_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    stopping = false;
+    queues.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+        queues.push_back(std::make_unique<Queue>());
+
+    currentSystem = this;
+    currentIndex = 0;
+
+    workers.reserve(std::max(1u, threadCount - 1));
+    for (uint32_t i = 1; i < threadCount; i++)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+
+    // Thread 0 alone would only run background jobs inside wait(), which a frame may never call
+    if (workers.empty())
+        workers.emplace_back(&JobSystem::backgroundLoop, this);
+}
+
+void JobSystem::destroy()
+{
+    if (queues.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread &worker : workers)
+        worker.join();
+    workers.clear();
+
+    // Without workers nothing else would run what is left
+    while (tryRunJob(0, true))
+    {
+    }
+
+    queues.clear();
+    if (currentSystem == this)
+        currentSystem = nullptr;
+}
+
+void JobSystem::run(std::function<void()> function, JobCounter *counter, JobCounter *dependency)
+{
+    if (counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    if (dependency)
+    {
+        // finish() takes the continuations under the same lock, so either it sees this one or the dependency is done here
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->isDone())
+        {
+            dependency->continuations.push_back({std::move(function), counter});
+            return;
+        }
+    }
+
+    push(getThreadIndex(), {std::move(function), counter});
+}
+
+void JobSystem::runBackground(std::function<void()> function, JobCounter *counter)
+{
+    if (counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    queuedJobs.fetch_add(1);
+    queuedBackgroundJobs.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(background.mutex);
+        background.jobs.push_back({std::move(function), counter});
+    }
+    wakeWorker();
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    uint32_t index = getThreadIndex();
+
+    while (!counter.isDone())
+    {
+        if (!tryRunJob(index, false))
+            std::this_thread::yield();
+    }
+
+    // The last job may still be inside finish(), taking the lock makes sure it is out before counter is reused or destroyed
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(counter.mutex);
+        std::swap(error, counter.error);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+uint32_t JobSystem::getThreadIndex() const
+{
+    return currentSystem == this ? currentIndex : 0;
+}
+
+void JobSystem::workerLoop(uint32_t index)
+{
+    currentSystem = this;
+    currentIndex = index;
+
+    for (;;)
+    {
+        if (tryRunJob(index, true))
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingWorkers.fetch_add(1);
+        wake.wait(lock, [this]()
+                  { return stopping || queuedJobs.load() > 0; });
+        sleepingWorkers.fetch_sub(1);
+
+        if (stopping && queuedJobs.load() == 0)
+            return;
+    }
+}
+
+void JobSystem::backgroundLoop()
+{
+    for (;;)
+    {
+        Job job;
+        if (popBackground(job))
+        {
+            queuedJobs.fetch_sub(1);
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingWorkers.fetch_add(1);
+        wake.wait(lock, [this]()
+                  { return stopping || queuedBackgroundJobs.load() > 0; });
+        sleepingWorkers.fetch_sub(1);
+
+        if (stopping && queuedBackgroundJobs.load() == 0)
+            return;
+    }
+}
+
+void JobSystem::push(uint32_t queue, Job job)
+{
+    // Counted before it is visible, a worker that wakes early only finds the deque empty and looks again
+    queuedJobs.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+        queues[queue]->jobs.push_back(std::move(job));
+    }
+    wakeWorker();
+}
+
+void JobSystem::wakeWorker()
+{
+    // A worker counts itself as sleeping before it checks queuedJobs, so one of the two sides always sees the other
+    if (sleepingWorkers.load() == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool JobSystem::tryRunJob(uint32_t index, bool takeBackground)
+{
+    Job job;
+    bool found = false;
+
+    {
+        Queue &own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty())
+        {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            found = true;
+        }
+    }
+
+    uint32_t queueCount = static_cast<uint32_t>(queues.size());
+    for (uint32_t offset = 1; !found && offset < queueCount; offset++)
+    {
+        Queue &victim = *queues[(index + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found && takeBackground)
+        found = popBackground(job);
+
+    if (!found)
+        return false;
+
+    queuedJobs.fetch_sub(1);
+    execute(job);
+    return true;
+}
+
+bool JobSystem::popBackground(Job &job)
+{
+    std::lock_guard<std::mutex> lock(background.mutex);
+    if (background.jobs.empty())
+        return false;
+
+    job = std::move(background.jobs.front());
+    background.jobs.pop_front();
+    queuedBackgroundJobs.fetch_sub(1);
+    return true;
+}
+
+void JobSystem::execute(Job &job)
+{
+    std::exception_ptr error;
+    try
+    {
+        job.function();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    if (job.counter)
+        finish(*job.counter, error);
+}
+
+void JobSystem::finish(JobCounter &counter, std::exception_ptr error)
+{
+    std::vector<JobCounter::Continuation> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter.mutex);
+        if (error && !counter.error)
+            counter.error = error;
+        if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ready.swap(counter.continuations);
+    }
+
+    // counter may be gone from here on, its waiter only had to get past the lock
+    for (JobCounter::Continuation &continuation : ready)
+        push(getThreadIndex(), {std::move(continuation.function), continuation.counter});
+}
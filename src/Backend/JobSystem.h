@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+/**
+ * @brief Number of jobs still pending in a group, a job system waits on it and can hold jobs back until it drops to zero
+ *
+ * The first exception thrown by a job of the group is kept and rethrown by JobSystem::wait(). A counter
+ * can be reused once it has been waited for, and must outlive every job that counts against it.
+ */
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter &) = delete;
+    JobCounter &operator=(const JobCounter &) = delete;
+
+    bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    struct Continuation
+    {
+        std::function<void()> function;
+        JobCounter *counter = nullptr;
+    };
+
+    std::atomic<uint32_t> pending{0};
+    /** @brief Guards continuations and error, also held while the last job of the group finishes */
+    std::mutex mutex;
+    /** @brief Jobs started by run() with this counter as their dependency, queued once it drops to zero */
+    std::vector<Continuation> continuations;
+    std::exception_ptr error;
+};
+
+/**
+ * @brief Work stealing scheduler for the short jobs of a frame, such as culling, transform updates and recording
+ *
+ * Every thread owns a deque. A thread pushes and pops its own jobs at the back, so it keeps working on
+ * what it has just split off while the data is still in its cache. Idle threads steal from the front of
+ * the others' deques, which holds the oldest and usually largest pieces of work. The thread that calls
+ * create() is thread 0. It has a deque too but no loop of its own, it runs jobs only while it is in
+ * wait(). Background jobs such as asset decodes go to a shared FIFO that only the workers take from,
+ * and only when there is nothing else to do, so a frame never waits behind one. With a single thread
+ * one extra worker is started that runs nothing but background jobs.
+ */
+class JobSystem
+{
+public:
+    JobSystem() = default;
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+    ~JobSystem() { destroy(); }
+
+    /** @param threadCount Threads including the caller, 0 picks one per hardware thread */
+    void create(uint32_t threadCount = 0);
+    /** @brief Runs whatever is still queued, background jobs included, then joins the workers */
+    void destroy();
+
+    /**
+     * @brief Queues function on the calling thread's deque
+     * @param counter Incremented now and decremented once function has returned, may be null
+     * @param dependency function is held back until this counter reaches zero, may be null
+     */
+    void run(std::function<void()> function, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+    /** @brief Queues function behind every frame job, it never runs on thread 0 */
+    void runBackground(std::function<void()> function, JobCounter *counter = nullptr);
+
+    /** @brief Runs queued jobs on the calling thread until counter reaches zero, then rethrows the first error of its jobs */
+    void wait(JobCounter &counter);
+
+    /**
+     * @brief Calls function(begin, end) over [0, count) in ranges of at least grainSize and returns once all have finished
+     *
+     * The range is split into about four pieces per thread so that stealing can even out uneven work.
+     * Ranges that fit into one piece run on the caller without being queued.
+     */
+    template <typename Function>
+    void parallelFor(uint32_t count, uint32_t grainSize, Function &&function)
+    {
+        uint32_t pieces = std::max(1u, getThreadCount()) * 4;
+        uint32_t pieceSize = std::max(std::max(grainSize, 1u), (count + pieces - 1) / pieces);
+        if (count <= pieceSize)
+        {
+            if (count > 0)
+                function(0u, count);
+            return;
+        }
+
+        JobCounter counter;
+        for (uint32_t begin = pieceSize; begin < count; begin += pieceSize)
+        {
+            uint32_t end = std::min(count, begin + pieceSize);
+            run([&function, begin, end]()
+                { function(begin, end); },
+                &counter);
+        }
+
+        // The caller takes the first piece, the rest are in its own deque for it to pop or others to steal
+        std::exception_ptr error;
+        try
+        {
+            function(0u, pieceSize);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        // Every piece references function, so all of them have to finish even after a failure
+        try
+        {
+            wait(counter);
+        }
+        catch (...)
+        {
+            if (!error)
+                error = std::current_exception();
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    /** @brief Threads that run jobs, including the one that called create() */
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(queues.size()); }
+    /** @brief Index of the calling thread, 0 for the creating thread and for threads that are not part of this system */
+    uint32_t getThreadIndex() const;
+
+private:
+    struct Job
+    {
+        std::function<void()> function;
+        JobCounter *counter = nullptr;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    Queue background;
+
+    /** @brief Jobs in every deque and the background FIFO, lets sleeping workers tell whether there is anything to do */
+    std::atomic<uint32_t> queuedJobs{0};
+    /** @brief Jobs in the background FIFO alone, all the background only worker waits for */
+    std::atomic<uint32_t> queuedBackgroundJobs{0};
+    std::atomic<uint32_t> sleepingWorkers{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping{false};
+
+    void workerLoop(uint32_t index);
+    /** @brief Loop of the worker started when there are no others, it never takes frame jobs */
+    void backgroundLoop();
+    void push(uint32_t queue, Job job);
+    void wakeWorker();
+    /** @brief Own deque from the back, then the others from the front, then the background FIFO if allowed */
+    bool tryRunJob(uint32_t index, bool takeBackground);
+    bool popBackground(Job &job);
+    void execute(Job &job);
+    void finish(JobCounter &counter, std::exception_ptr error);
+};
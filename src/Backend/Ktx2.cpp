@@ -0,0 +1,240 @@
+#include "Ktx2.h"
+
+#include <vulkan/utility/vk_format_utils.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+namespace
+{
+    const uint8_t IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+    struct Header
+    {
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        // 64 bit fields in the file, split so the struct needs no padding after the identifier
+        uint32_t sgdByteOffset[2];
+        uint32_t sgdByteLength[2];
+    };
+    static_assert(sizeof(Header) == 68, "KTX2 header must be tightly packed");
+
+    struct LevelIndex
+    {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    // Khronos data format descriptor values
+    const uint32_t KHR_DF_MODEL_RGBSDA = 1;
+    const uint32_t KHR_DF_MODEL_BC1A = 128;
+    const uint32_t KHR_DF_MODEL_BC3 = 130;
+    const uint32_t KHR_DF_MODEL_BC5 = 132;
+    const uint32_t KHR_DF_MODEL_BC7 = 134;
+    const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+    const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+    const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+    const uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+    struct Sample
+    {
+        uint32_t bitOffset;
+        uint32_t bitLength;
+        uint32_t channelType;
+        uint32_t upper;
+    };
+
+    /** @brief Basic data format descriptor block, preceded by the total DFD size */
+    std::vector<uint32_t> buildDataFormatDescriptor(VkFormat format)
+    {
+        bool srgb = vkuFormatIsSRGB(format);
+        uint32_t colorModel = KHR_DF_MODEL_RGBSDA;
+        std::vector<Sample> samples;
+
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC1A;
+            samples.push_back({0, 64, 0, UINT32_MAX});
+            break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC3;
+            samples.push_back({0, 64, 15 | KHR_DF_SAMPLE_DATATYPE_LINEAR, UINT32_MAX});
+            samples.push_back({64, 64, 0, UINT32_MAX});
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            colorModel = KHR_DF_MODEL_BC5;
+            samples.push_back({0, 64, 0, UINT32_MAX});
+            samples.push_back({64, 64, 1, UINT32_MAX});
+            break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC7;
+            samples.push_back({0, 128, 0, UINT32_MAX});
+            break;
+        default:
+            // R8G8B8A8, alpha is never sRGB encoded
+            samples.push_back({0, 8, 0, 255});
+            samples.push_back({8, 8, 1, 255});
+            samples.push_back({16, 8, 2, 255});
+            samples.push_back({24, 8, 15 | KHR_DF_SAMPLE_DATATYPE_LINEAR, 255});
+            break;
+        }
+
+        VkExtent3D blockExtent = vkuFormatTexelBlockExtent(format);
+        uint32_t blockBytes = vkuFormatElementSize(format);
+        uint32_t descriptorBlockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+
+        std::vector<uint32_t> words;
+        words.push_back(4 + descriptorBlockSize);
+        words.push_back(0); // vendor Khronos, descriptor type basic
+        words.push_back(2 | (descriptorBlockSize << 16)); // version 1.3
+        words.push_back(colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | ((srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+        words.push_back((blockExtent.width - 1) | ((blockExtent.height - 1) << 8));
+        words.push_back(blockBytes);
+        words.push_back(0);
+
+        for (const Sample &sample : samples)
+        {
+            words.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channelType << 24));
+            words.push_back(0);
+            words.push_back(0);
+            words.push_back(sample.upper);
+        }
+        return words;
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    /** @brief Bytes of a tightly packed width x height level, whole texel blocks for block compressed formats */
+    uint64_t getLevelSize(VkFormat format, uint32_t width, uint32_t height)
+    {
+        VkExtent3D blockExtent = vkuFormatTexelBlockExtent(format);
+        uint64_t blocksWide = (static_cast<uint64_t>(width) + blockExtent.width - 1) / blockExtent.width;
+        uint64_t blocksHigh = (static_cast<uint64_t>(height) + blockExtent.height - 1) / blockExtent.height;
+        return blocksWide * blocksHigh * vkuFormatElementSize(format);
+    }
+}
+
+namespace Ktx2
+{
+    bool read(const uint8_t *data, size_t size, Ktx2Texture &texture)
+    {
+        if (size < sizeof(IDENTIFIER) + sizeof(Header) || memcmp(data, IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+            return false;
+
+        Header header;
+        memcpy(&header, data + sizeof(IDENTIFIER), sizeof(Header));
+
+        if (header.vkFormat == VK_FORMAT_UNDEFINED || header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 ||
+            header.layerCount > 1 || header.faceCount != 1 || header.supercompressionScheme != 0)
+            return false;
+
+        // Without a texel size the levels cannot be checked, and nothing downstream could upload them either
+        if (vkuFormatElementSize(static_cast<VkFormat>(header.vkFormat)) == 0)
+            return false;
+
+        // Past 32 levels the level sizes below would shift by the full width of their type
+        uint32_t levelCount = std::max(1u, header.levelCount);
+        if (levelCount > 32)
+            return false;
+        size_t levelIndexOffset = sizeof(IDENTIFIER) + sizeof(Header);
+        if (levelIndexOffset + levelCount * sizeof(LevelIndex) > size)
+            return false;
+
+        texture.format = static_cast<VkFormat>(header.vkFormat);
+        texture.width = header.pixelWidth;
+        texture.height = header.pixelHeight;
+        texture.levels.resize(levelCount);
+
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            LevelIndex index;
+            memcpy(&index, data + levelIndexOffset + i * sizeof(LevelIndex), sizeof(LevelIndex));
+            if (index.byteOffset > size || index.byteLength > size - index.byteOffset)
+                return false;
+
+            Ktx2Level &level = texture.levels[i];
+            level.width = std::max(1u, texture.width >> i);
+            level.height = std::max(1u, texture.height >> i);
+
+            // A short level would be read past its end by the decoder or the upload
+            if (index.byteLength < getLevelSize(texture.format, level.width, level.height))
+                return false;
+
+            level.offset = index.byteOffset;
+            level.size = index.byteLength;
+        }
+
+        return true;
+    }
+
+    bool write(const std::string &path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>> &levels)
+    {
+        std::vector<uint32_t> dfd = buildDataFormatDescriptor(format);
+
+        uint32_t levelCount = static_cast<uint32_t>(levels.size());
+        uint64_t levelIndexOffset = sizeof(IDENTIFIER) + sizeof(Header);
+        uint64_t dfdOffset = levelIndexOffset + levelCount * sizeof(LevelIndex);
+        uint64_t dataOffset = dfdOffset + dfd.size() * sizeof(uint32_t);
+
+        // Level data is stored smallest level first, each aligned to the texel block size
+        uint64_t alignment = std::lcm<uint64_t>(vkuFormatElementSize(format), 4);
+        std::vector<LevelIndex> levelIndex(levelCount);
+        uint64_t offset = dataOffset;
+        for (uint32_t i = levelCount; i-- > 0;)
+        {
+            offset = alignUp(offset, alignment);
+            levelIndex[i].byteOffset = offset;
+            levelIndex[i].byteLength = levels[i].size();
+            levelIndex[i].uncompressedByteLength = levels[i].size();
+            offset += levels[i].size();
+        }
+
+        Header header{};
+        header.vkFormat = format;
+        header.typeSize = 1;
+        header.pixelWidth = width;
+        header.pixelHeight = height;
+        header.pixelDepth = 0;
+        header.layerCount = 0;
+        header.faceCount = 1;
+        header.levelCount = levelCount;
+        header.supercompressionScheme = 0;
+        header.dfdByteOffset = static_cast<uint32_t>(dfdOffset);
+        header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+        std::vector<uint8_t> file(offset, 0);
+        memcpy(file.data(), IDENTIFIER, sizeof(IDENTIFIER));
+        memcpy(file.data() + sizeof(IDENTIFIER), &header, sizeof(Header));
+        memcpy(file.data() + levelIndexOffset, levelIndex.data(), levelIndex.size() * sizeof(LevelIndex));
+        memcpy(file.data() + dfdOffset, dfd.data(), dfd.size() * sizeof(uint32_t));
+        for (uint32_t i = 0; i < levelCount; i++)
+            memcpy(file.data() + levelIndex[i].byteOffset, levels[i].data(), levels[i].size());
+
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open())
+            return false;
+        out.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size()));
+        return out.good();
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** @brief Location of one mip level inside a KTX2 file */
+struct Ktx2Level
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+/** @brief The parts of a 2D KTX2 texture the engine uses, level 0 first */
+struct Ktx2Texture
+{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<Ktx2Level> levels;
+};
+
+/**
+ * @brief Minimal KTX2 container support: single layer, single face 2D textures without supercompression
+ *
+ * The reader only parses the header and level index, level data is addressed in place. The writer
+ * emits a basic data format descriptor for the formats the texture cooker produces.
+ */
+namespace Ktx2
+{
+    bool read(const uint8_t *data, size_t size, Ktx2Texture &texture);
+    /** @param levels Data of each mip level, level 0 first */
+    bool write(const std::string &path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>> &levels);
+}
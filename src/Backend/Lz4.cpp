@@ -0,0 +1,183 @@
+#include "Lz4.h"
+
+#include <cstring>
+
+namespace
+{
+    const size_t MIN_MATCH = 4;
+    // The format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+    const size_t LAST_LITERALS = 5;
+    const size_t MATCH_FIND_LIMIT = 12;
+    const size_t MAX_OFFSET = 65535;
+    const uint32_t HASH_BITS = 12;
+
+    uint32_t read32(const uint8_t *p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    /** @brief Writes the 255 run continuation of a length whose nibble saturated at 15 */
+    bool writeLength(size_t length, uint8_t *&op, const uint8_t *end)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            if (op >= end)
+                return false;
+            *op++ = 255;
+        }
+        if (op >= end)
+            return false;
+        *op++ = static_cast<uint8_t>(length);
+        return true;
+    }
+
+    bool readLength(size_t &length, const uint8_t *&ip, const uint8_t *end)
+    {
+        uint8_t byte;
+        do
+        {
+            if (ip >= end)
+                return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    bool writeSequence(const uint8_t *literals, size_t literalLength, size_t offset, size_t matchLength, uint8_t *&op, const uint8_t *end)
+    {
+        if (op >= end)
+            return false;
+
+        uint8_t *token = op++;
+        *token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+        if (literalLength >= 15 && !writeLength(literalLength - 15, op, end))
+            return false;
+
+        if (static_cast<size_t>(end - op) < literalLength)
+            return false;
+        if (literalLength > 0)
+            memcpy(op, literals, literalLength);
+        op += literalLength;
+
+        // Last literals run without a match
+        if (matchLength == 0)
+            return true;
+
+        if (end - op < 2)
+            return false;
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+
+        size_t extra = matchLength - MIN_MATCH;
+        *token |= static_cast<uint8_t>(extra < 15 ? extra : 15);
+        return extra < 15 || writeLength(extra - 15, op, end);
+    }
+}
+
+namespace Lz4
+{
+    size_t getCompressBound(size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    size_t compress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity)
+    {
+        uint8_t *op = dst;
+        const uint8_t *end = dst + dstCapacity;
+        size_t anchor = 0;
+
+        if (srcSize > MATCH_FIND_LIMIT)
+        {
+            // Positions are stored + 1 so that 0 means empty
+            uint32_t table[1u << HASH_BITS] = {};
+            size_t matchLimit = srcSize - LAST_LITERALS;
+
+            size_t ip = 0;
+            while (ip <= srcSize - MATCH_FIND_LIMIT)
+            {
+                uint32_t sequence = read32(src + ip);
+                uint32_t &slot = table[hash(sequence)];
+                size_t candidate = slot;
+                slot = static_cast<uint32_t>(ip + 1);
+
+                if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET || read32(src + candidate - 1) != sequence)
+                {
+                    ip++;
+                    continue;
+                }
+
+                size_t match = candidate - 1;
+                size_t length = MIN_MATCH;
+                while (ip + length < matchLimit && src[match + length] == src[ip + length])
+                    length++;
+
+                if (!writeSequence(src + anchor, ip - anchor, ip - match, length, op, end))
+                    return 0;
+
+                ip += length;
+                anchor = ip;
+            }
+        }
+
+        if (!writeSequence(src + anchor, srcSize - anchor, 0, 0, op, end))
+            return 0;
+        return static_cast<size_t>(op - dst);
+    }
+
+    bool decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize)
+    {
+        const uint8_t *ip = src;
+        const uint8_t *srcEnd = src + srcSize;
+        uint8_t *op = dst;
+        const uint8_t *dstEnd = dst + dstSize;
+
+        while (ip < srcEnd)
+        {
+            uint8_t token = *ip++;
+
+            size_t literalLength = token >> 4;
+            if (literalLength == 15 && !readLength(literalLength, ip, srcEnd))
+                return false;
+            if (static_cast<size_t>(srcEnd - ip) < literalLength || static_cast<size_t>(dstEnd - op) < literalLength)
+                return false;
+            if (literalLength > 0)
+                memcpy(op, ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+
+            if (ip == srcEnd)
+                break;
+
+            if (srcEnd - ip < 2)
+                return false;
+            size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+            ip += 2;
+            if (offset == 0 || offset > static_cast<size_t>(op - dst))
+                return false;
+
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && !readLength(matchLength, ip, srcEnd))
+                return false;
+            matchLength += MIN_MATCH;
+            if (static_cast<size_t>(dstEnd - op) < matchLength)
+                return false;
+
+            // Matches may overlap their own output, copy forwards byte by byte
+            const uint8_t *match = op - offset;
+            for (size_t i = 0; i < matchLength; i++)
+                op[i] = match[i];
+            op += matchLength;
+        }
+
+        return op == dstEnd;
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Compressor and decompressor for the LZ4 block format
+ *
+ * Blocks carry no header or checksum, the caller stores the compressed and uncompressed sizes. The
+ * compressor is a single pass greedy matcher meant for offline packing, the decompressor validates
+ * every length and offset so corrupt input fails instead of writing out of bounds.
+ */
+namespace Lz4
+{
+    /** @brief Worst case compressed size of size bytes of input */
+    size_t getCompressBound(size_t size);
+
+    /** @return Compressed size, 0 if dstCapacity is too small */
+    size_t compress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity);
+    /** @return false unless src decodes to exactly dstSize bytes */
+    bool decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize);
+}
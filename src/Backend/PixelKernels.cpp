@@ -0,0 +1,435 @@
+#include "PixelKernels.h"
+#include "PixelKernelsSimd.h"
+
+#include <cmath>
+#include <mutex>
+
+#ifdef PIXEL_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+using namespace PixelKernels::Detail;
+
+float PixelKernels::Detail::srgbToLinearTable[256];
+
+namespace
+{
+    uint8_t encodeSrgb(float x)
+    {
+        // Same clamp as max/min against 0 and 1 in the vector versions, NaN becomes 0
+        x = x > 0.0f ? x : 0.0f;
+        x = x < 1.0f ? x : 1.0f;
+
+        float y;
+        if (x <= SRGB_LINEAR_THRESHOLD)
+        {
+            y = x * SRGB_LINEAR_SCALE;
+        }
+        else
+        {
+            float s1 = std::sqrt(x);
+            float s2 = std::sqrt(s1);
+            float s3 = std::sqrt(s2);
+            y = SRGB_C1 * s1;
+            y = y + SRGB_C2 * s2;
+            y = y + SRGB_C3 * s3;
+            y = y + SRGB_C4 * x;
+        }
+        return static_cast<uint8_t>(std::nearbyint(y * 255.0f));
+    }
+
+    uint8_t encodeUnorm(float x)
+    {
+        x = x > 0.0f ? x : 0.0f;
+        x = x < 1.0f ? x : 1.0f;
+        return static_cast<uint8_t>(std::nearbyint(x * 255.0f));
+    }
+
+    uint8_t divide255(uint32_t value)
+    {
+        // Rounded value / 255 for value <= 255 * 255
+        value += 128;
+        return static_cast<uint8_t>((value + (value >> 8)) >> 8);
+    }
+
+    void downsample2xScalar(const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, bool srgb)
+    {
+        uint32_t dstWidth = width > 1 ? width / 2 : 1;
+        uint32_t dstHeight = height > 1 ? height / 2 : 1;
+        for (uint32_t y = 0; y < dstHeight; y++)
+        {
+            const uint8_t *row0 = src + static_cast<size_t>(height > 1 ? y * 2 : 0) * width * 4;
+            const uint8_t *row1 = src + static_cast<size_t>(height > 1 ? y * 2 + 1 : 0) * width * 4;
+            downsampleRowScalar(row0, row1, width, dst + static_cast<size_t>(y) * dstWidth * 4, 0, dstWidth, srgb);
+        }
+    }
+
+#ifdef PIXEL_KERNELS_SSE2
+    __m128i encodeSrgbSse2(__m128 x)
+    {
+        x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+        __m128 linear = _mm_mul_ps(x, _mm_set1_ps(SRGB_LINEAR_SCALE));
+        __m128 s1 = _mm_sqrt_ps(x);
+        __m128 s2 = _mm_sqrt_ps(s1);
+        __m128 s3 = _mm_sqrt_ps(s2);
+        __m128 curve = _mm_mul_ps(_mm_set1_ps(SRGB_C1), s1);
+        curve = _mm_add_ps(curve, _mm_mul_ps(_mm_set1_ps(SRGB_C2), s2));
+        curve = _mm_add_ps(curve, _mm_mul_ps(_mm_set1_ps(SRGB_C3), s3));
+        curve = _mm_add_ps(curve, _mm_mul_ps(_mm_set1_ps(SRGB_C4), x));
+
+        __m128 useLinear = _mm_cmple_ps(x, _mm_set1_ps(SRGB_LINEAR_THRESHOLD));
+        __m128 y = _mm_or_ps(_mm_and_ps(useLinear, linear), _mm_andnot_ps(useLinear, curve));
+        return _mm_cvtps_epi32(_mm_mul_ps(y, _mm_set1_ps(255.0f)));
+    }
+
+    void rgbToRgbaSse2(const uint8_t *rgb, uint8_t *rgba, size_t count)
+    {
+        const __m128i alpha = _mm_set1_epi32(static_cast<int32_t>(0xff000000u));
+
+        // Each 16 byte load covers four pixels plus four bytes of the next, which must exist
+        size_t i = 0;
+        for (; (i + 4) * 3 + 4 <= count * 3; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb + i * 3));
+            __m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+            __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+            // The top byte of each lane holds the next pixel's red until alpha overwrites it
+            __m128i pixels = _mm_or_si128(_mm_unpacklo_epi64(p01, p23), alpha);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(rgba + i * 4), pixels);
+        }
+        rgbToRgbaScalar(rgb + i * 3, rgba + i * 4, count - i);
+    }
+
+    void swizzleRedBlueSse2(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+        const __m128i greenAlpha = _mm_set1_epi32(static_cast<int32_t>(0xff00ff00u));
+        const __m128i low = _mm_set1_epi32(0xff);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+            __m128i red = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+            __m128i blue = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+            v = _mm_or_si128(_mm_and_si128(v, greenAlpha), _mm_or_si128(red, blue));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), v);
+        }
+        swizzleRedBlueScalar(src + i * 4, dst + i * 4, count - i);
+    }
+
+    __m128i premultiplySse2(__m128i pixels16)
+    {
+        // Alpha in every channel, then 255 in the alpha channel so alpha is kept as is
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels16, 0xff), 0xff);
+        const __m128i alphaLanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+        __m128i factor = _mm_or_si128(_mm_andnot_si128(alphaLanes, alpha), _mm_and_si128(alphaLanes, _mm_set1_epi16(255)));
+
+        __m128i value = _mm_add_epi16(_mm_mullo_epi16(pixels16, factor), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+    }
+
+    void premultiplyAlphaSse2(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+            __m128i low = premultiplySse2(_mm_unpacklo_epi8(v, zero));
+            __m128i high = premultiplySse2(_mm_unpackhi_epi8(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_packus_epi16(low, high));
+        }
+        premultiplyAlphaScalar(src + i * 4, dst + i * 4, count - i);
+    }
+
+    void linearToSrgbSse2(const float *src, uint8_t *dst, size_t count)
+    {
+        // Colour lanes take the curve, the alpha lane is only scaled
+        const __m128 alphaLane = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i encoded[4];
+            for (uint32_t p = 0; p < 4; p++)
+            {
+                __m128 x = _mm_loadu_ps(src + (i + p) * 4);
+                __m128 clamped = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+                __m128i alpha = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(255.0f)));
+                __m128i colour = encodeSrgbSse2(x);
+                encoded[p] = _mm_or_si128(_mm_and_si128(_mm_castps_si128(alphaLane), alpha), _mm_andnot_si128(_mm_castps_si128(alphaLane), colour));
+            }
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(encoded[0], encoded[1]), _mm_packs_epi32(encoded[2], encoded[3]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), packed);
+        }
+        linearToSrgbScalar(src + i * 4, dst + i * 4, count - i);
+    }
+
+    __m128 lookupLinearSse2(const uint32_t pixels[4], uint32_t shift)
+    {
+        return _mm_setr_ps(srgbToLinearTable[(pixels[0] >> shift) & 0xff], srgbToLinearTable[(pixels[1] >> shift) & 0xff],
+                           srgbToLinearTable[(pixels[2] >> shift) & 0xff], srgbToLinearTable[(pixels[3] >> shift) & 0xff]);
+    }
+
+    void downsample2xSse2(const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, bool srgb)
+    {
+        if (width < 2)
+        {
+            downsample2xScalar(src, width, height, dst, srgb);
+            return;
+        }
+
+        const __m128i low = _mm_set1_epi32(0xff);
+        const __m128i two = _mm_set1_epi32(2);
+        uint32_t dstWidth = width / 2;
+        uint32_t dstHeight = height > 1 ? height / 2 : 1;
+
+        for (uint32_t y = 0; y < dstHeight; y++)
+        {
+            const uint8_t *row0 = src + static_cast<size_t>(height > 1 ? y * 2 : 0) * width * 4;
+            const uint8_t *row1 = src + static_cast<size_t>(height > 1 ? y * 2 + 1 : 0) * width * 4;
+            uint8_t *out = dst + static_cast<size_t>(y) * dstWidth * 4;
+
+            // Four output pixels from eight source pixels of each row
+            uint32_t x = 0;
+            for (; x + 4 <= dstWidth; x += 4)
+            {
+                __m128i sources[4];
+                const uint8_t *rows[2] = {row0, row1};
+                for (uint32_t r = 0; r < 2; r++)
+                {
+                    __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[r] + x * 8)));
+                    __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[r] + x * 8 + 16)));
+                    sources[r * 2] = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                    sources[r * 2 + 1] = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+                }
+
+                __m128i result = _mm_setzero_si128();
+                uint32_t firstStoredChannel = 0;
+                if (srgb)
+                {
+                    alignas(16) uint32_t pixels[4][4];
+                    for (uint32_t s = 0; s < 4; s++)
+                        _mm_store_si128(reinterpret_cast<__m128i *>(pixels[s]), sources[s]);
+
+                    for (uint32_t c = 0; c < 3; c++)
+                    {
+                        __m128 sum = _mm_add_ps(_mm_add_ps(lookupLinearSse2(pixels[0], c * 8), lookupLinearSse2(pixels[1], c * 8)),
+                                                _mm_add_ps(lookupLinearSse2(pixels[2], c * 8), lookupLinearSse2(pixels[3], c * 8)));
+                        __m128i encoded = encodeSrgbSse2(_mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+                        result = _mm_or_si128(result, _mm_slli_epi32(encoded, static_cast<int>(c * 8)));
+                    }
+                    firstStoredChannel = 3;
+                }
+
+                for (uint32_t c = firstStoredChannel; c < 4; c++)
+                {
+                    __m128i shift = _mm_cvtsi32_si128(static_cast<int>(c * 8));
+                    __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(_mm_srl_epi32(sources[0], shift), low), _mm_and_si128(_mm_srl_epi32(sources[1], shift), low)),
+                                                _mm_add_epi32(_mm_and_si128(_mm_srl_epi32(sources[2], shift), low), _mm_and_si128(_mm_srl_epi32(sources[3], shift), low)));
+                    __m128i average = _mm_srli_epi32(_mm_add_epi32(sum, two), 2);
+                    result = _mm_or_si128(result, _mm_sll_epi32(average, shift));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x * 4), result);
+            }
+            downsampleRowScalar(row0, row1, width, out, x, dstWidth, srgb);
+        }
+    }
+#endif
+
+    PixelKernels::Isa detectIsa()
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#ifdef PIXEL_KERNELS_AVX2
+        // AVX2 needs both the CPU flag and the OS saving the upper register halves
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        if (maxLeaf >= 7 && osSavesAvx)
+        {
+            __cpuidex(info, 7, 0);
+            if (info[1] & (1 << 5))
+                return PixelKernels::Isa::AVX2;
+        }
+#endif
+#ifdef PIXEL_KERNELS_SSE2
+        return PixelKernels::Isa::SSE2;
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+#ifdef PIXEL_KERNELS_AVX2
+        // Also checks that the OS saves the upper register halves
+        if (__builtin_cpu_supports("avx2"))
+            return PixelKernels::Isa::AVX2;
+#endif
+#ifdef PIXEL_KERNELS_SSE2
+        return PixelKernels::Isa::SSE2;
+#endif
+#endif
+        return PixelKernels::Isa::Scalar;
+    }
+
+    void initializeTables()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            float value = i / 255.0f;
+            srgbToLinearTable[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+    }
+}
+
+namespace PixelKernels
+{
+    namespace Detail
+    {
+        void rgbToRgbaScalar(const uint8_t *rgb, uint8_t *rgba, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                rgba[i * 4] = rgb[i * 3];
+                rgba[i * 4 + 1] = rgb[i * 3 + 1];
+                rgba[i * 4 + 2] = rgb[i * 3 + 2];
+                rgba[i * 4 + 3] = 255;
+            }
+        }
+
+        void swizzleRedBlueScalar(const uint8_t *src, uint8_t *dst, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                uint8_t red = src[i * 4];
+                uint8_t blue = src[i * 4 + 2];
+                dst[i * 4] = blue;
+                dst[i * 4 + 1] = src[i * 4 + 1];
+                dst[i * 4 + 2] = red;
+                dst[i * 4 + 3] = src[i * 4 + 3];
+            }
+        }
+
+        void premultiplyAlphaScalar(const uint8_t *src, uint8_t *dst, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                uint32_t alpha = src[i * 4 + 3];
+                dst[i * 4] = divide255(src[i * 4] * alpha);
+                dst[i * 4 + 1] = divide255(src[i * 4 + 1] * alpha);
+                dst[i * 4 + 2] = divide255(src[i * 4 + 2] * alpha);
+                dst[i * 4 + 3] = static_cast<uint8_t>(alpha);
+            }
+        }
+
+        void srgbToLinearScalar(const uint8_t *src, float *dst, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                dst[i * 4] = srgbToLinearTable[src[i * 4]];
+                dst[i * 4 + 1] = srgbToLinearTable[src[i * 4 + 1]];
+                dst[i * 4 + 2] = srgbToLinearTable[src[i * 4 + 2]];
+                dst[i * 4 + 3] = static_cast<float>(src[i * 4 + 3]) / 255.0f;
+            }
+        }
+
+        void linearToSrgbScalar(const float *src, uint8_t *dst, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                dst[i * 4] = encodeSrgb(src[i * 4]);
+                dst[i * 4 + 1] = encodeSrgb(src[i * 4 + 1]);
+                dst[i * 4 + 2] = encodeSrgb(src[i * 4 + 2]);
+                dst[i * 4 + 3] = encodeUnorm(src[i * 4 + 3]);
+            }
+        }
+
+        void downsampleRowScalar(const uint8_t *row0, const uint8_t *row1, uint32_t srcWidth, uint8_t *dst, uint32_t firstX, uint32_t dstWidth, bool srgb)
+        {
+            for (uint32_t x = firstX; x < dstWidth; x++)
+            {
+                uint32_t x0 = srcWidth > 1 ? x * 2 : 0;
+                uint32_t x1 = srcWidth > 1 ? x * 2 + 1 : 0;
+                const uint8_t *a0 = row0 + x0 * 4;
+                const uint8_t *a1 = row0 + x1 * 4;
+                const uint8_t *b0 = row1 + x0 * 4;
+                const uint8_t *b1 = row1 + x1 * 4;
+
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    if (srgb && c < 3)
+                    {
+                        float sum = (srgbToLinearTable[a0[c]] + srgbToLinearTable[a1[c]]) + (srgbToLinearTable[b0[c]] + srgbToLinearTable[b1[c]]);
+                        dst[x * 4 + c] = encodeSrgb(sum * 0.25f);
+                    }
+                    else
+                    {
+                        dst[x * 4 + c] = static_cast<uint8_t>((a0[c] + a1[c] + b0[c] + b1[c] + 2) >> 2);
+                    }
+                }
+            }
+        }
+    }
+
+    Isa getSupportedIsa()
+    {
+        static const Isa isa = detectIsa();
+        return isa;
+    }
+
+    const char *getIsaName(Isa isa)
+    {
+        switch (isa)
+        {
+        case Isa::SSE2:
+            return "SSE2";
+        case Isa::AVX2:
+            return "AVX2";
+        default:
+            return "scalar";
+        }
+    }
+
+    const KernelTable &getKernels(Isa isa)
+    {
+        static std::once_flag tablesInitialized;
+        std::call_once(tablesInitialized, initializeTables);
+
+        static const KernelTable scalar = {rgbToRgbaScalar, swizzleRedBlueScalar, premultiplyAlphaScalar,
+                                           srgbToLinearScalar, linearToSrgbScalar, downsample2xScalar};
+#ifdef PIXEL_KERNELS_SSE2
+        // Decoding is a table lookup per channel that SSE2 cannot gather, so it stays scalar
+        static const KernelTable sse2 = {rgbToRgbaSse2, swizzleRedBlueSse2, premultiplyAlphaSse2,
+                                         srgbToLinearScalar, linearToSrgbSse2, downsample2xSse2};
+#endif
+#ifdef PIXEL_KERNELS_AVX2
+        static const KernelTable avx2 = {rgbToRgbaAvx2, swizzleRedBlueAvx2, premultiplyAlphaAvx2,
+                                         srgbToLinearAvx2, linearToSrgbAvx2, downsample2xAvx2};
+#endif
+
+        switch (isa)
+        {
+#ifdef PIXEL_KERNELS_AVX2
+        case Isa::AVX2:
+            return avx2;
+#endif
+#ifdef PIXEL_KERNELS_SSE2
+        case Isa::SSE2:
+            return sse2;
+#endif
+        default:
+            return scalar;
+        }
+    }
+
+    const KernelTable &getKernels()
+    {
+        return getKernels(getSupportedIsa());
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Pixel format conversion kernels for texture import, with scalar, SSE2 and AVX2 versions
+ *
+ * Images are tightly packed 8 bit RGBA unless stated otherwise and counts are in pixels. All
+ * versions of a kernel produce identical output, so the one picked at runtime never changes what
+ * gets cooked. The sRGB encode uses a square root based approximation of the transfer function that
+ * is within a quarter of a code of the exact curve.
+ */
+namespace PixelKernels
+{
+    enum class Isa
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    struct KernelTable
+    {
+        /** @brief Expands RGB8 to RGBA8 with opaque alpha, rgb and rgba must not overlap */
+        void (*rgbToRgba)(const uint8_t *rgb, uint8_t *rgba, size_t count);
+        /** @brief Swaps the first and third channel, converting BGRA to RGBA and back. Works in place */
+        void (*swizzleRedBlue)(const uint8_t *src, uint8_t *dst, size_t count);
+        /** @brief Multiplies colour by alpha on the stored values, rounded. Works in place */
+        void (*premultiplyAlpha)(const uint8_t *src, uint8_t *dst, size_t count);
+        /** @brief Decodes sRGB colour to linear floats, alpha is scaled to [0, 1] */
+        void (*srgbToLinear)(const uint8_t *src, float *dst, size_t count);
+        /** @brief Encodes linear floats to sRGB colour, values are clamped to [0, 1] */
+        void (*linearToSrgb)(const float *src, uint8_t *dst, size_t count);
+        /**
+         * @brief 2x2 box filter to max(1, width / 2) x max(1, height / 2)
+         *
+         * With srgb set colour is averaged in linear space, alpha is always averaged as stored. A
+         * dimension of 1 reuses its single row or column.
+         */
+        void (*downsample2x)(const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, bool srgb);
+    };
+
+    /** @brief Best instruction set of the running CPU that kernels were built for, detected once */
+    Isa getSupportedIsa();
+    const char *getIsaName(Isa isa);
+
+    /** @brief Kernels for a specific instruction set, which must not be above getSupportedIsa() */
+    const KernelTable &getKernels(Isa isa);
+    /** @brief Kernels for getSupportedIsa() */
+    const KernelTable &getKernels();
+}
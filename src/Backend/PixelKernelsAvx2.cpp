@@ -0,0 +1,201 @@
+// Built with AVX2 code generation enabled and only reached after runtime detection. Nothing here may
+// use inline functions from other headers: the linker could keep this file's AVX2 copy for the whole
+// program.
+
+#include "PixelKernelsSimd.h"
+
+#ifdef PIXEL_KERNELS_AVX2
+
+#include <immintrin.h>
+
+using namespace PixelKernels::Detail;
+
+namespace
+{
+    __m256i encodeSrgbAvx2(__m256 x)
+    {
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+
+        __m256 linear = _mm256_mul_ps(x, _mm256_set1_ps(SRGB_LINEAR_SCALE));
+        __m256 s1 = _mm256_sqrt_ps(x);
+        __m256 s2 = _mm256_sqrt_ps(s1);
+        __m256 s3 = _mm256_sqrt_ps(s2);
+        __m256 curve = _mm256_mul_ps(_mm256_set1_ps(SRGB_C1), s1);
+        curve = _mm256_add_ps(curve, _mm256_mul_ps(_mm256_set1_ps(SRGB_C2), s2));
+        curve = _mm256_add_ps(curve, _mm256_mul_ps(_mm256_set1_ps(SRGB_C3), s3));
+        curve = _mm256_add_ps(curve, _mm256_mul_ps(_mm256_set1_ps(SRGB_C4), x));
+
+        __m256 useLinear = _mm256_cmp_ps(x, _mm256_set1_ps(SRGB_LINEAR_THRESHOLD), _CMP_LE_OQ);
+        __m256 y = _mm256_blendv_ps(curve, linear, useLinear);
+        return _mm256_cvtps_epi32(_mm256_mul_ps(y, _mm256_set1_ps(255.0f)));
+    }
+
+    __m256i premultiplyAvx2(__m256i pixels16)
+    {
+        __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels16, 0xff), 0xff);
+        __m256i factor = _mm256_blend_epi16(alpha, _mm256_set1_epi16(255), 0x88);
+
+        __m256i value = _mm256_add_epi16(_mm256_mullo_epi16(pixels16, factor), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(value, _mm256_srli_epi16(value, 8)), 8);
+    }
+
+    __m256 lookupLinearAvx2(__m256i pixels, int shift)
+    {
+        __m256i index = _mm256_and_si256(_mm256_srl_epi32(pixels, _mm_cvtsi32_si128(shift)), _mm256_set1_epi32(0xff));
+        return _mm256_i32gather_ps(srgbToLinearTable, index, 4);
+    }
+}
+
+namespace PixelKernels
+{
+    namespace Detail
+    {
+        void rgbToRgbaAvx2(const uint8_t *rgb, uint8_t *rgba, size_t count)
+        {
+            // Three dwords of pixel data per 128 bit lane, then a byte shuffle spreads them to four pixels
+            const __m256i spread = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+            const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                    0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int32_t>(0xff000000u));
+
+            // A 32 byte load covers eight pixels plus eight bytes that must exist
+            size_t i = 0;
+            for (; (i + 8) * 3 + 8 <= count * 3; i += 8)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rgb + i * 3));
+                v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, spread), expand);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + i * 4), _mm256_or_si256(v, alpha));
+            }
+            rgbToRgbaScalar(rgb + i * 3, rgba + i * 4, count - i);
+        }
+
+        void swizzleRedBlueAvx2(const uint8_t *src, uint8_t *dst, size_t count)
+        {
+            const __m256i swap = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                                  2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_shuffle_epi8(v, swap));
+            }
+            swizzleRedBlueScalar(src + i * 4, dst + i * 4, count - i);
+        }
+
+        void premultiplyAlphaAvx2(const uint8_t *src, uint8_t *dst, size_t count)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+                __m256i low = premultiplyAvx2(_mm256_unpacklo_epi8(v, zero));
+                __m256i high = premultiplyAvx2(_mm256_unpackhi_epi8(v, zero));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_packus_epi16(low, high));
+            }
+            premultiplyAlphaScalar(src + i * 4, dst + i * 4, count - i);
+        }
+
+        void srgbToLinearAvx2(const uint8_t *src, float *dst, size_t count)
+        {
+            const __m256 alphaLanes = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+
+            // Two pixels per vector, one channel per float
+            size_t i = 0;
+            for (; i + 2 <= count; i += 2)
+            {
+                __m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i * 4)));
+                __m256 colour = _mm256_i32gather_ps(srgbToLinearTable, bytes, 4);
+                __m256 alpha = _mm256_div_ps(_mm256_cvtepi32_ps(bytes), _mm256_set1_ps(255.0f));
+                _mm256_storeu_ps(dst + i * 4, _mm256_blendv_ps(colour, alpha, alphaLanes));
+            }
+            srgbToLinearScalar(src + i * 4, dst + i * 4, count - i);
+        }
+
+        void linearToSrgbAvx2(const float *src, uint8_t *dst, size_t count)
+        {
+            const __m256 alphaLanes = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m256i encoded[4];
+                for (uint32_t p = 0; p < 4; p++)
+                {
+                    __m256 x = _mm256_loadu_ps(src + (i + p * 2) * 4);
+                    __m256 clamped = _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+                    __m256i alpha = _mm256_cvtps_epi32(_mm256_mul_ps(clamped, _mm256_set1_ps(255.0f)));
+                    encoded[p] = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(encodeSrgbAvx2(x)), _mm256_castsi256_ps(alpha), alphaLanes));
+                }
+
+                // Packs work per lane and leave pixels 0 2 4 6 | 1 3 5 7, a dword permute restores the order
+                __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(encoded[0], encoded[1]), _mm256_packs_epi32(encoded[2], encoded[3]));
+                packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), packed);
+            }
+            linearToSrgbScalar(src + i * 4, dst + i * 4, count - i);
+        }
+
+        void downsample2xAvx2(const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, bool srgb)
+        {
+            const __m256i low = _mm256_set1_epi32(0xff);
+            const __m256i two = _mm256_set1_epi32(2);
+            uint32_t dstWidth = width > 1 ? width / 2 : 1;
+            uint32_t dstHeight = height > 1 ? height / 2 : 1;
+
+            for (uint32_t y = 0; y < dstHeight; y++)
+            {
+                const uint8_t *row0 = src + static_cast<size_t>(height > 1 ? y * 2 : 0) * width * 4;
+                const uint8_t *row1 = src + static_cast<size_t>(height > 1 ? y * 2 + 1 : 0) * width * 4;
+                uint8_t *out = dst + static_cast<size_t>(y) * dstWidth * 4;
+
+                // Eight output pixels from sixteen source pixels of each row, single column sources stay scalar
+                uint32_t x = 0;
+                for (; width > 1 && x + 8 <= dstWidth; x += 8)
+                {
+                    __m256i sources[4];
+                    const uint8_t *rows[2] = {row0, row1};
+                    for (uint32_t r = 0; r < 2; r++)
+                    {
+                        __m256 a = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[r] + x * 8)));
+                        __m256 b = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[r] + x * 8 + 32)));
+                        // Per lane shuffles give pixel order 0 2 8 10 | 4 6 12 14, swapping the middle quadwords sorts them
+                        __m256 even = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                        __m256 odd = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                        sources[r * 2] = _mm256_permute4x64_epi64(_mm256_castps_si256(even), _MM_SHUFFLE(3, 1, 2, 0));
+                        sources[r * 2 + 1] = _mm256_permute4x64_epi64(_mm256_castps_si256(odd), _MM_SHUFFLE(3, 1, 2, 0));
+                    }
+
+                    __m256i result = _mm256_setzero_si256();
+                    uint32_t firstStoredChannel = 0;
+                    if (srgb)
+                    {
+                        for (int c = 0; c < 3; c++)
+                        {
+                            __m256 sum = _mm256_add_ps(_mm256_add_ps(lookupLinearAvx2(sources[0], c * 8), lookupLinearAvx2(sources[1], c * 8)),
+                                                       _mm256_add_ps(lookupLinearAvx2(sources[2], c * 8), lookupLinearAvx2(sources[3], c * 8)));
+                            __m256i encoded = encodeSrgbAvx2(_mm256_mul_ps(sum, _mm256_set1_ps(0.25f)));
+                            result = _mm256_or_si256(result, _mm256_sll_epi32(encoded, _mm_cvtsi32_si128(c * 8)));
+                        }
+                        firstStoredChannel = 3;
+                    }
+
+                    for (uint32_t c = firstStoredChannel; c < 4; c++)
+                    {
+                        __m128i shift = _mm_cvtsi32_si128(static_cast<int>(c * 8));
+                        __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(_mm256_srl_epi32(sources[0], shift), low), _mm256_and_si256(_mm256_srl_epi32(sources[1], shift), low)),
+                                                       _mm256_add_epi32(_mm256_and_si256(_mm256_srl_epi32(sources[2], shift), low), _mm256_and_si256(_mm256_srl_epi32(sources[3], shift), low)));
+                        __m256i average = _mm256_srli_epi32(_mm256_add_epi32(sum, two), 2);
+                        result = _mm256_or_si256(result, _mm256_sll_epi32(average, shift));
+                    }
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x * 4), result);
+                }
+                downsampleRowScalar(row0, row1, width, out, x, dstWidth, srgb);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+// Shared between the kernel translation units so that every version computes the same values
+
+#include "PixelKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_KERNELS_SSE2
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PIXEL_KERNELS_AVX2
+#endif
+
+namespace PixelKernels
+{
+    namespace Detail
+    {
+        // Linear to sRGB as a blend of x^(1/2), x^(1/4) and x^(1/8) above the linear segment. Evaluated in
+        // exactly this order by every version, then rounded to nearest even
+        const float SRGB_LINEAR_THRESHOLD = 0.0031308f;
+        const float SRGB_LINEAR_SCALE = 12.92f;
+        const float SRGB_C1 = 0.662002687f;
+        const float SRGB_C2 = 0.684122060f;
+        const float SRGB_C3 = -0.323583601f;
+        const float SRGB_C4 = -0.0225411470f;
+
+        /** @brief sRGB code to linear value, filled in before any kernel table is handed out */
+        extern float srgbToLinearTable[256];
+
+        // Scalar versions, also used by the vector ones for what is left over after the last full vector
+        void rgbToRgbaScalar(const uint8_t *rgb, uint8_t *rgba, size_t count);
+        void swizzleRedBlueScalar(const uint8_t *src, uint8_t *dst, size_t count);
+        void premultiplyAlphaScalar(const uint8_t *src, uint8_t *dst, size_t count);
+        void srgbToLinearScalar(const uint8_t *src, float *dst, size_t count);
+        void linearToSrgbScalar(const float *src, uint8_t *dst, size_t count);
+        /** @brief Output pixels [firstX, dstWidth) of one row, row1 is row0 again for single row sources */
+        void downsampleRowScalar(const uint8_t *row0, const uint8_t *row1, uint32_t srcWidth, uint8_t *dst, uint32_t firstX, uint32_t dstWidth, bool srgb);
+
+#ifdef PIXEL_KERNELS_AVX2
+        void rgbToRgbaAvx2(const uint8_t *rgb, uint8_t *rgba, size_t count);
+        void swizzleRedBlueAvx2(const uint8_t *src, uint8_t *dst, size_t count);
+        void premultiplyAlphaAvx2(const uint8_t *src, uint8_t *dst, size_t count);
+        void srgbToLinearAvx2(const uint8_t *src, float *dst, size_t count);
+        void linearToSrgbAvx2(const float *src, uint8_t *dst, size_t count);
+        void downsample2xAvx2(const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst, bool srgb);
+#endif
+    }
+}
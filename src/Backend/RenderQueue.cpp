@@ -0,0 +1,102 @@
+#include "RenderQueue.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    const uint32_t RADIX_BITS = 8;
+    const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+    const uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+
+    uint64_t field(uint64_t id, uint32_t bits, uint32_t shift)
+    {
+        if (id >= (1ull << bits))
+        {
+            throw std::runtime_error("render queue id out of range!");
+        }
+        return id << shift;
+    }
+}
+
+uint64_t RenderQueue::makeKey(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, float depth)
+{
+    // The bits of a non-negative float order the same way as its value, the top ones keep the exponent and leading mantissa
+    uint32_t depthBits = 0;
+    if (depth > 0.0f)
+    {
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        depthBits >>= 31 - DEPTH_BITS;
+    }
+
+    return field(pass, PASS_BITS, PASS_SHIFT) | field(pipeline, PIPELINE_BITS, PIPELINE_SHIFT) | field(descriptorSet, DESCRIPTOR_SET_BITS, DESCRIPTOR_SET_SHIFT) |
+           field(mesh, MESH_BITS, MESH_SHIFT) | (static_cast<uint64_t>(depthBits) << DEPTH_SHIFT);
+}
+
+void RenderQueue::push(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, float depth, uint32_t instance)
+{
+    items.push_back({makeKey(pass, pipeline, descriptorSet, mesh, depth), instance});
+}
+
+void RenderQueue::sort()
+{
+    size_t count = items.size();
+    if (count < 2)
+        return;
+
+    // One pass over the keys builds the histograms of every digit
+    uint32_t histograms[RADIX_PASSES][RADIX_SIZE] = {};
+    for (const Item &item : items)
+    {
+        for (uint32_t digit = 0; digit < RADIX_PASSES; digit++)
+            histograms[digit][(item.key >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+    }
+
+    scratch.resize(count);
+    for (uint32_t digit = 0; digit < RADIX_PASSES; digit++)
+    {
+        uint32_t *histogram = histograms[digit];
+        uint32_t shift = digit * RADIX_BITS;
+
+        // Every key has the same digit, the pass would only copy
+        if (histogram[(items[0].key >> shift) & (RADIX_SIZE - 1)] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < RADIX_SIZE; bucket++)
+        {
+            uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (const Item &item : items)
+            scratch[histogram[(item.key >> shift) & (RADIX_SIZE - 1)]++] = item;
+        items.swap(scratch);
+    }
+}
+
+void RenderQueue::record(VulkanCommandEncoder &encoder, const RenderQueueBindings &bindings, uint32_t first, uint32_t count) const
+{
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        const Item &item = items[i];
+        const RenderQueuePipeline &pipeline = bindings.pipelines[(item.key >> PIPELINE_SHIFT) & ((1ull << PIPELINE_BITS) - 1)];
+        VkDescriptorSet descriptorSet = bindings.descriptorSets[(item.key >> DESCRIPTOR_SET_SHIFT) & ((1ull << DESCRIPTOR_SET_BITS) - 1)];
+        const RenderQueueMesh &mesh = bindings.meshes[(item.key >> MESH_SHIFT) & ((1ull << MESH_BITS) - 1)];
+
+        // Sorted keys make consecutive draws repeat these, the encoder keeps only the changes
+        encoder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+        encoder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &descriptorSet);
+        encoder.bindVertexBuffers(0, 1, &mesh.vertexBuffer, &mesh.vertexOffset);
+        encoder.bindIndexBuffer(mesh.indexBuffer, mesh.indexOffset, mesh.indexType);
+
+        if (bindings.pushConstants)
+        {
+            const uint8_t *constants = static_cast<const uint8_t *>(bindings.pushConstants) + static_cast<size_t>(item.instance) * bindings.pushConstantSize;
+            encoder.pushConstants(pipeline.layout, bindings.pushConstantStages, 0, bindings.pushConstantSize, constants);
+        }
+
+        encoder.drawIndexed(mesh.indexCount, 1, 0, 0, item.instance);
+    }
+}
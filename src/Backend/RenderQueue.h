@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+#include <vector>
+
+#include "VulkanCommandEncoder.h"
+
+/** @brief Vertex and index ranges of a mesh, drawn with one vkCmdDrawIndexed */
+struct RenderQueueMesh
+{
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize vertexOffset = 0;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize indexOffset = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+    uint32_t indexCount = 0;
+};
+
+struct RenderQueuePipeline
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    /** @brief Descriptor sets are bound to set 0 through this layout */
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+};
+
+/** @brief Handles the ids pushed into a RenderQueue refer to */
+struct RenderQueueBindings
+{
+    std::vector<RenderQueuePipeline> pipelines;
+    std::vector<VkDescriptorSet> descriptorSets;
+    std::vector<RenderQueueMesh> meshes;
+
+    /** @brief Optional per draw push constants, pushConstantSize bytes per instance indexed by the draw's instance */
+    const void *pushConstants = nullptr;
+    uint32_t pushConstantSize = 0;
+    VkShaderStageFlags pushConstantStages = 0;
+};
+
+/**
+ * @brief Draws of a render pass ordered by a 64 bit sort key, so that consecutive draws share as much state as possible
+ *
+ * From the most significant bits down, the key holds the pass, pipeline, descriptor set and mesh ids
+ * and the view depth. Sorting it therefore groups draws by their most expensive state change first.
+ * Within one state they go front to back, which lets early depth testing reject more fragments. A pass
+ * orders layers within the render pass, for example opaque before transparent. A layer that needs back
+ * to front order pushes a reversed depth. sort() is an LSD radix sort over the key bytes. It is linear
+ * in the draw count and skips bytes that are the same in every key.
+ */
+class RenderQueue
+{
+public:
+    static const uint32_t PASS_BITS = 4;
+    static const uint32_t PIPELINE_BITS = 12;
+    static const uint32_t DESCRIPTOR_SET_BITS = 12;
+    static const uint32_t MESH_BITS = 12;
+    static const uint32_t DEPTH_BITS = 24;
+
+    void clear() { items.clear(); }
+    void reserve(uint32_t count) { items.reserve(count); }
+
+    /**
+     * @param depth Distance along the view direction. Anything that is not positive sorts first.
+     * @param instance Passed as firstInstance, selects the object's per instance data
+     */
+    void push(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, float depth, uint32_t instance);
+    void sort();
+
+    uint32_t size() const { return static_cast<uint32_t>(items.size()); }
+
+    /**
+     * @brief Records draws [first, first + count) in queue order through encoder, which drops the binds that repeat
+     *
+     * Ranges can go to separate secondaries on separate threads, each with its own encoder. Dynamic state
+     * such as viewport and scissor is left to the caller.
+     */
+    void record(VulkanCommandEncoder &encoder, const RenderQueueBindings &bindings, uint32_t first, uint32_t count) const;
+
+    static uint64_t makeKey(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, float depth);
+
+private:
+    struct Item
+    {
+        uint64_t key;
+        uint32_t instance;
+    };
+
+    static const uint32_t DEPTH_SHIFT = 0;
+    static const uint32_t MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+    static const uint32_t DESCRIPTOR_SET_SHIFT = MESH_SHIFT + MESH_BITS;
+    static const uint32_t PIPELINE_SHIFT = DESCRIPTOR_SET_SHIFT + DESCRIPTOR_SET_BITS;
+    static const uint32_t PASS_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+
+    std::vector<Item> items;
+    /** @brief Ping-pong buffer of sort(), kept to avoid reallocating every frame */
+    std::vector<Item> scratch;
+};
@@ -0,0 +1,861 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const uint32_t BC7_WEIGHTS2[4] = {0, 21, 43, 64};
+    const uint32_t BC7_WEIGHTS3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+    const uint32_t BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    /** @brief Candidate colours in structure of arrays layout, count is a multiple of 4 */
+    struct Palette
+    {
+        alignas(16) float r[16];
+        alignas(16) float g[16];
+        alignas(16) float b[16];
+        alignas(16) float a[16];
+        uint32_t count;
+
+        void set(uint32_t index, float red, float green, float blue, float alpha)
+        {
+            r[index] = red;
+            g[index] = green;
+            b[index] = blue;
+            a[index] = alpha;
+        }
+    };
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(uint8_t *data) : data(data) {}
+
+        void write(uint32_t value, uint32_t count)
+        {
+            for (uint32_t i = 0; i < count; i++, position++)
+            {
+                if (value & (1u << i))
+                    data[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+            }
+        }
+
+    private:
+        uint8_t *data;
+        uint32_t position = 0;
+    };
+
+    class BitReader
+    {
+    public:
+        explicit BitReader(const uint8_t *data) : data(data) {}
+
+        uint32_t read(uint32_t count)
+        {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; i++, position++)
+                value |= static_cast<uint32_t>((data[position >> 3] >> (position & 7)) & 1) << i;
+            return value;
+        }
+
+    private:
+        const uint8_t *data;
+        uint32_t position = 0;
+    };
+
+    bool isSrgb(VkFormat format)
+    {
+        return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ||
+               format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+
+    uint32_t blockSize(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            return 8;
+        default:
+            return 16;
+        }
+    }
+
+    /** @brief Copies the 4x4 block at (blockX, blockY), clamping reads to the image */
+    void loadBlock(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t block[16][4])
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            uint32_t sy = std::min(blockY * 4 + y, height - 1);
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                uint32_t sx = std::min(blockX * 4 + x, width - 1);
+                memcpy(block[y * 4 + x], rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+            }
+        }
+    }
+
+    /** @brief Picks the closest palette entry for every texel and returns the summed squared error */
+    float selectIndices(const float texels[16][4], const Palette &palette, uint8_t indices[16])
+    {
+        float total = 0.0f;
+
+#ifdef TEXTURE_COMPRESSION_SSE2
+        // Four palette entries per iteration, one per lane
+        const __m128i step = _mm_set1_epi32(4);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            __m128 r = _mm_set1_ps(texels[i][0]);
+            __m128 g = _mm_set1_ps(texels[i][1]);
+            __m128 b = _mm_set1_ps(texels[i][2]);
+            __m128 a = _mm_set1_ps(texels[i][3]);
+
+            __m128 bestError = _mm_set1_ps(FLT_MAX);
+            __m128i bestIndex = _mm_setzero_si128();
+            __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+
+            for (uint32_t j = 0; j < palette.count; j += 4)
+            {
+                __m128 dr = _mm_sub_ps(r, _mm_load_ps(palette.r + j));
+                __m128 dg = _mm_sub_ps(g, _mm_load_ps(palette.g + j));
+                __m128 db = _mm_sub_ps(b, _mm_load_ps(palette.b + j));
+                __m128 da = _mm_sub_ps(a, _mm_load_ps(palette.a + j));
+                __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+                                          _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+
+                __m128i better = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+                bestError = _mm_min_ps(error, bestError);
+                bestIndex = _mm_or_si128(_mm_and_si128(better, index), _mm_andnot_si128(better, bestIndex));
+                index = _mm_add_epi32(index, step);
+            }
+
+            alignas(16) float errors[4];
+            alignas(16) int32_t candidates[4];
+            _mm_store_ps(errors, bestError);
+            _mm_store_si128(reinterpret_cast<__m128i *>(candidates), bestIndex);
+
+            uint32_t best = 0;
+            for (uint32_t lane = 1; lane < 4; lane++)
+            {
+                if (errors[lane] < errors[best] || (errors[lane] == errors[best] && candidates[lane] < candidates[best]))
+                    best = lane;
+            }
+            indices[i] = static_cast<uint8_t>(candidates[best]);
+            total += errors[best];
+        }
+#else
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float bestError = FLT_MAX;
+            for (uint32_t j = 0; j < palette.count; j++)
+            {
+                float dr = texels[i][0] - palette.r[j];
+                float dg = texels[i][1] - palette.g[j];
+                float db = texels[i][2] - palette.b[j];
+                float da = texels[i][3] - palette.a[j];
+                float error = dr * dr + dg * dg + db * db + da * da;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    indices[i] = static_cast<uint8_t>(j);
+                }
+            }
+            total += bestError;
+        }
+#endif
+
+        return total;
+    }
+
+    /** @brief Mean and dominant direction of the texels over the first channelCount channels */
+    void principalAxis(const float texels[16][4], uint32_t channelCount, float mean[4], float axis[4])
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            mean[c] = 0.0f;
+            axis[c] = 0.0f;
+        }
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < channelCount; c++)
+                mean[c] += texels[i][c] / 16.0f;
+        }
+
+        float covariance[4][4] = {};
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                for (uint32_t d = 0; d < channelCount; d++)
+                    covariance[c][d] += (texels[i][c] - mean[c]) * (texels[i][d] - mean[d]);
+            }
+        }
+
+        // Power iteration, seeded with the channel of largest variance
+        uint32_t seed = 0;
+        for (uint32_t c = 1; c < channelCount; c++)
+        {
+            if (covariance[c][c] > covariance[seed][seed])
+                seed = c;
+        }
+        if (covariance[seed][seed] < 1e-4f)
+            return;
+
+        for (uint32_t c = 0; c < channelCount; c++)
+            axis[c] = covariance[seed][c];
+
+        for (uint32_t iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            float length = 0.0f;
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                for (uint32_t d = 0; d < channelCount; d++)
+                    next[c] += covariance[c][d] * axis[d];
+                length += next[c] * next[c];
+            }
+
+            length = std::sqrt(length);
+            if (length < 1e-8f)
+                return;
+            for (uint32_t c = 0; c < channelCount; c++)
+                axis[c] = next[c] / length;
+        }
+    }
+
+    /** @brief Endpoints at the extremes of the texels projected on their principal axis */
+    void fitEndpoints(const float texels[16][4], uint32_t channelCount, float low[4], float high[4])
+    {
+        float mean[4], axis[4];
+        principalAxis(texels, channelCount, mean, axis);
+
+        float minT = 0.0f, maxT = 0.0f;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (uint32_t c = 0; c < channelCount; c++)
+                t += (texels[i][c] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            low[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+            high[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+        }
+    }
+
+    /**
+     * @brief Least squares endpoints for fixed interpolation weights
+     * @return false if the weights do not constrain both endpoints
+     */
+    bool refineEndpoints(const float texels[16][4], const float weights[16], uint32_t channelCount, float low[4], float high[4])
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {}, bx[4] = {};
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float a = 1.0f - weights[i];
+            float b = weights[i];
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                ax[c] += a * texels[i][c];
+                bx[c] += b * texels[i][c];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            low[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+            high[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    uint16_t packRgb565(const float color[4])
+    {
+        uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+        uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+        uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRgb565(uint16_t packed, uint32_t color[3])
+    {
+        uint32_t r = (packed >> 11) & 31;
+        uint32_t g = (packed >> 5) & 63;
+        uint32_t b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    /** @brief Encodes a four colour BC1 block from the given endpoints, returns its error */
+    float encodeBc1Endpoints(const float texels[16][4], const float low[4], const float high[4], uint8_t out[8], uint8_t indices[16])
+    {
+        uint16_t color0 = packRgb565(high);
+        uint16_t color1 = packRgb565(low);
+        // color0 > color1 selects the four colour mode
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        uint32_t c0[3], c1[3];
+        unpackRgb565(color0, c0);
+        unpackRgb565(color1, c1);
+
+        Palette palette;
+        palette.count = 4;
+        if (color0 == color1)
+        {
+            for (uint32_t j = 0; j < 4; j++)
+                palette.set(j, static_cast<float>(c0[0]), static_cast<float>(c0[1]), static_cast<float>(c0[2]), 0.0f);
+        }
+        else
+        {
+            palette.set(0, static_cast<float>(c0[0]), static_cast<float>(c0[1]), static_cast<float>(c0[2]), 0.0f);
+            palette.set(1, static_cast<float>(c1[0]), static_cast<float>(c1[1]), static_cast<float>(c1[2]), 0.0f);
+            palette.set(2, (2 * c0[0] + c1[0]) / 3.0f, (2 * c0[1] + c1[1]) / 3.0f, (2 * c0[2] + c1[2]) / 3.0f, 0.0f);
+            palette.set(3, (c0[0] + 2 * c1[0]) / 3.0f, (c0[1] + 2 * c1[1]) / 3.0f, (c0[2] + 2 * c1[2]) / 3.0f, 0.0f);
+        }
+
+        float error = selectIndices(texels, palette, indices);
+
+        uint32_t packedIndices = 0;
+        for (uint32_t i = 0; i < 16; i++)
+            packedIndices |= static_cast<uint32_t>(indices[i]) << (2 * i);
+
+        out[0] = static_cast<uint8_t>(color0);
+        out[1] = static_cast<uint8_t>(color0 >> 8);
+        out[2] = static_cast<uint8_t>(color1);
+        out[3] = static_cast<uint8_t>(color1 >> 8);
+        memcpy(out + 4, &packedIndices, 4);
+
+        return error;
+    }
+
+    void encodeBc1(const uint8_t block[16][4], uint8_t out[8])
+    {
+        float texels[16][4];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+                texels[i][c] = block[i][c];
+            texels[i][3] = 0.0f;
+        }
+
+        float low[4], high[4];
+        fitEndpoints(texels, 3, low, high);
+
+        uint8_t indices[16];
+        float error = encodeBc1Endpoints(texels, low, high, out, indices);
+
+        // One least squares pass on the chosen indices, index 0 weights color0 (the high end)
+        static const float towardColor1[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+        float weights[16];
+        for (uint32_t i = 0; i < 16; i++)
+            weights[i] = towardColor1[indices[i]];
+
+        if (refineEndpoints(texels, weights, 3, high, low))
+        {
+            uint8_t refined[8];
+            if (encodeBc1Endpoints(texels, low, high, refined, indices) < error)
+                memcpy(out, refined, 8);
+        }
+    }
+
+    void encodeBc4(const uint8_t values[16], uint8_t out[8])
+    {
+        uint8_t high = *std::max_element(values, values + 16);
+        uint8_t low = *std::min_element(values, values + 16);
+
+        // high > low selects the eight value mode
+        out[0] = high;
+        out[1] = low;
+
+        uint64_t packedIndices = 0;
+        if (high != low)
+        {
+            float palette[8];
+            palette[0] = high;
+            palette[1] = low;
+            for (uint32_t j = 2; j < 8; j++)
+                palette[j] = ((8 - j) * high + (j - 1) * low) / 7.0f;
+
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t best = 0;
+                float bestError = FLT_MAX;
+                for (uint32_t j = 0; j < 8; j++)
+                {
+                    float error = std::fabs(values[i] - palette[j]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = j;
+                    }
+                }
+                packedIndices |= static_cast<uint64_t>(best) << (3 * i);
+            }
+        }
+
+        for (uint32_t i = 0; i < 6; i++)
+            out[2 + i] = static_cast<uint8_t>(packedIndices >> (8 * i));
+    }
+
+    void encodeBc4Channel(const uint8_t block[16][4], uint32_t channel, uint8_t out[8])
+    {
+        uint8_t values[16];
+        for (uint32_t i = 0; i < 16; i++)
+            values[i] = block[i][channel];
+        encodeBc4(values, out);
+    }
+
+    uint32_t quantizeBc7Endpoint(const float color[4], uint32_t quantized[4])
+    {
+        // Mode 6 endpoints are 7 bits per channel plus a p-bit shared by the channels
+        uint32_t bestP = 0;
+        float bestError = FLT_MAX;
+        uint32_t candidate[4];
+        for (uint32_t p = 0; p < 2; p++)
+        {
+            float error = 0.0f;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                candidate[c] = static_cast<uint32_t>(std::clamp<long>(std::lround((color[c] - p) / 2.0f), 0, 127));
+                float value = static_cast<float>((candidate[c] << 1) | p);
+                error += (value - color[c]) * (value - color[c]);
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                bestP = p;
+                memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+        return bestP;
+    }
+
+    float encodeBc7Endpoints(const float texels[16][4], const float low[4], const float high[4], uint8_t out[16], uint8_t indices[16])
+    {
+        uint32_t q0[4], q1[4];
+        uint32_t p0 = quantizeBc7Endpoint(low, q0);
+        uint32_t p1 = quantizeBc7Endpoint(high, q1);
+
+        uint32_t e0[4], e1[4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            e0[c] = (q0[c] << 1) | p0;
+            e1[c] = (q1[c] << 1) | p1;
+        }
+
+        Palette palette;
+        palette.count = 16;
+        for (uint32_t j = 0; j < 16; j++)
+        {
+            uint32_t w = BC7_WEIGHTS4[j];
+            palette.set(j,
+                        static_cast<float>(((64 - w) * e0[0] + w * e1[0] + 32) >> 6),
+                        static_cast<float>(((64 - w) * e0[1] + w * e1[1] + 32) >> 6),
+                        static_cast<float>(((64 - w) * e0[2] + w * e1[2] + 32) >> 6),
+                        static_cast<float>(((64 - w) * e0[3] + w * e1[3] + 32) >> 6));
+        }
+
+        float error = selectIndices(texels, palette, indices);
+
+        // The most significant bit of the first index is implied zero
+        if (indices[0] & 8)
+        {
+            std::swap(q0, q1);
+            std::swap(p0, p1);
+            for (uint32_t i = 0; i < 16; i++)
+                indices[i] = static_cast<uint8_t>(15 - indices[i]);
+        }
+
+        memset(out, 0, 16);
+        BitWriter writer(out);
+        writer.write(1u << 6, 7);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            writer.write(q0[c], 7);
+            writer.write(q1[c], 7);
+        }
+        writer.write(p0, 1);
+        writer.write(p1, 1);
+        writer.write(indices[0], 3);
+        for (uint32_t i = 1; i < 16; i++)
+            writer.write(indices[i], 4);
+
+        return error;
+    }
+
+    void encodeBc7(const uint8_t block[16][4], uint8_t out[16])
+    {
+        float texels[16][4];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+                texels[i][c] = block[i][c];
+        }
+
+        float low[4], high[4];
+        fitEndpoints(texels, 4, low, high);
+
+        uint8_t indices[16];
+        float error = encodeBc7Endpoints(texels, low, high, out, indices);
+
+        // Indices may have been flipped for the anchor bit, refine against the endpoints as written
+        BitReader reader(out);
+        reader.read(7);
+        uint32_t written[2][4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            written[0][c] = reader.read(7);
+            written[1][c] = reader.read(7);
+        }
+        uint32_t p0 = reader.read(1);
+        uint32_t p1 = reader.read(1);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            low[c] = static_cast<float>((written[0][c] << 1) | p0);
+            high[c] = static_cast<float>((written[1][c] << 1) | p1);
+        }
+
+        float weights[16];
+        for (uint32_t i = 0; i < 16; i++)
+            weights[i] = BC7_WEIGHTS4[indices[i]] / 64.0f;
+
+        if (refineEndpoints(texels, weights, 4, low, high))
+        {
+            uint8_t refined[16];
+            if (encodeBc7Endpoints(texels, low, high, refined, indices) < error)
+                memcpy(out, refined, 16);
+        }
+    }
+
+    void encodeBlock(VkFormat format, const uint8_t block[16][4], uint8_t *out)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            encodeBc1(block, out);
+            break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            encodeBc4Channel(block, 3, out);
+            encodeBc1(block, out + 8);
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            encodeBc4Channel(block, 0, out);
+            encodeBc4Channel(block, 1, out + 8);
+            break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            encodeBc7(block, out);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void decodeBc1(const uint8_t *data, bool fourColorOnly, bool hasAlpha, uint8_t texels[16][4])
+    {
+        uint16_t color0 = static_cast<uint16_t>(data[0] | (data[1] << 8));
+        uint16_t color1 = static_cast<uint16_t>(data[2] | (data[3] << 8));
+
+        uint32_t palette[4][4];
+        unpackRgb565(color0, palette[0]);
+        unpackRgb565(color1, palette[1]);
+        palette[0][3] = palette[1][3] = 255;
+
+        if (color0 > color1 || fourColorOnly)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            palette[2][3] = palette[3][3] = 255;
+        }
+        else
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+            palette[2][3] = 255;
+            palette[3][3] = hasAlpha ? 0 : 255;
+        }
+
+        uint32_t packedIndices;
+        memcpy(&packedIndices, data + 4, 4);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t index = (packedIndices >> (2 * i)) & 3;
+            for (uint32_t c = 0; c < 4; c++)
+                texels[i][c] = static_cast<uint8_t>(palette[index][c]);
+        }
+    }
+
+    void decodeBc4(const uint8_t *data, uint32_t channel, uint8_t texels[16][4])
+    {
+        uint32_t a0 = data[0];
+        uint32_t a1 = data[1];
+
+        uint32_t palette[8] = {a0, a1};
+        if (a0 > a1)
+        {
+            for (uint32_t j = 2; j < 8; j++)
+                palette[j] = ((8 - j) * a0 + (j - 1) * a1) / 7;
+        }
+        else
+        {
+            for (uint32_t j = 2; j < 6; j++)
+                palette[j] = ((6 - j) * a0 + (j - 1) * a1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        uint64_t packedIndices = 0;
+        for (uint32_t i = 0; i < 6; i++)
+            packedIndices |= static_cast<uint64_t>(data[2 + i]) << (8 * i);
+
+        for (uint32_t i = 0; i < 16; i++)
+            texels[i][channel] = static_cast<uint8_t>(palette[(packedIndices >> (3 * i)) & 7]);
+    }
+
+    uint8_t interpolateBc7(uint32_t e0, uint32_t e1, uint32_t weight)
+    {
+        return static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+    }
+
+    /** @brief Reads one index per texel, the anchor (first) index has one bit less */
+    void readBc7Indices(BitReader &reader, uint32_t bits, uint32_t indices[16])
+    {
+        indices[0] = reader.read(bits - 1);
+        for (uint32_t i = 1; i < 16; i++)
+            indices[i] = reader.read(bits);
+    }
+
+    bool decodeBc7(const uint8_t *data, uint8_t texels[16][4])
+    {
+        uint32_t mode = 0;
+        while (mode < 8 && !(data[0] & (1u << mode)))
+            mode++;
+
+        BitReader reader(data);
+        reader.read(mode + 1);
+
+        if (mode == 6)
+        {
+            uint32_t e[2][4];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                e[0][c] = reader.read(7);
+                e[1][c] = reader.read(7);
+            }
+            uint32_t p0 = reader.read(1);
+            uint32_t p1 = reader.read(1);
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                e[0][c] = (e[0][c] << 1) | p0;
+                e[1][c] = (e[1][c] << 1) | p1;
+            }
+
+            uint32_t indices[16];
+            readBc7Indices(reader, 4, indices);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                for (uint32_t c = 0; c < 4; c++)
+                    texels[i][c] = interpolateBc7(e[0][c], e[1][c], BC7_WEIGHTS4[indices[i]]);
+            }
+            return true;
+        }
+
+        if (mode == 4 || mode == 5)
+        {
+            uint32_t rotation = reader.read(2);
+            uint32_t indexMode = mode == 4 ? reader.read(1) : 0;
+            uint32_t colorBits = mode == 4 ? 5 : 7;
+            uint32_t alphaBits = mode == 4 ? 6 : 8;
+
+            uint32_t e[2][4];
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                e[0][c] = reader.read(colorBits);
+                e[1][c] = reader.read(colorBits);
+            }
+            e[0][3] = reader.read(alphaBits);
+            e[1][3] = reader.read(alphaBits);
+
+            for (uint32_t i = 0; i < 2; i++)
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                    e[i][c] = (e[i][c] << (8 - colorBits)) | (e[i][c] >> (2 * colorBits - 8));
+                if (alphaBits < 8)
+                    e[i][3] = (e[i][3] << (8 - alphaBits)) | (e[i][3] >> (2 * alphaBits - 8));
+            }
+
+            // Mode 5 has two bit colour and alpha indices, mode 4 a two bit and a three bit set
+            uint32_t primary[16], secondary[16];
+            readBc7Indices(reader, 2, primary);
+            readBc7Indices(reader, mode == 4 ? 3 : 2, secondary);
+
+            const uint32_t *colorIndices = primary;
+            const uint32_t *alphaIndices = secondary;
+            const uint32_t *colorWeights = BC7_WEIGHTS2;
+            const uint32_t *alphaWeights = mode == 4 ? BC7_WEIGHTS3 : BC7_WEIGHTS2;
+            if (indexMode == 1)
+            {
+                std::swap(colorIndices, alphaIndices);
+                std::swap(colorWeights, alphaWeights);
+            }
+
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                    texels[i][c] = interpolateBc7(e[0][c], e[1][c], colorWeights[colorIndices[i]]);
+                texels[i][3] = interpolateBc7(e[0][3], e[1][3], alphaWeights[alphaIndices[i]]);
+
+                if (rotation > 0)
+                    std::swap(texels[i][3], texels[i][rotation - 1]);
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    bool decodeBlock(VkFormat format, const uint8_t *data, uint8_t texels[16][4])
+    {
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            decodeBc1(data, false, false, texels);
+            return true;
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            decodeBc1(data, false, true, texels);
+            return true;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            decodeBc1(data + 8, true, false, texels);
+            decodeBc4(data, 3, texels);
+            return true;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            decodeBc4(data, 0, texels);
+            decodeBc4(data + 8, 1, texels);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                texels[i][2] = 0;
+                texels[i][3] = 255;
+            }
+            return true;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return decodeBc7(data, texels);
+        default:
+            return false;
+        }
+    }
+}
+
+namespace TextureCompression
+{
+    bool canEncode(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool canDecode(VkFormat format)
+    {
+        return canEncode(format) || format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    }
+
+    VkFormat getDecodedFormat(VkFormat format)
+    {
+        return isSrgb(format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    VkDeviceSize getEncodedSize(VkFormat format, uint32_t width, uint32_t height)
+    {
+        VkDeviceSize blocksWide = (width + 3) / 4;
+        VkDeviceSize blocksHigh = (height + 3) / 4;
+        return blocksWide * blocksHigh * blockSize(format);
+    }
+
+    void encodeImage(VkFormat format, const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t *blocks,
+                     uint32_t firstBlockRow, uint32_t blockRowCount)
+    {
+        uint32_t blocksWide = (width + 3) / 4;
+        uint32_t blocksHigh = (height + 3) / 4;
+        uint32_t lastBlockRow = blockRowCount > blocksHigh - firstBlockRow ? blocksHigh : firstBlockRow + blockRowCount;
+        uint32_t size = blockSize(format);
+
+        uint8_t block[16][4];
+        for (uint32_t by = firstBlockRow; by < lastBlockRow; by++)
+        {
+            for (uint32_t bx = 0; bx < blocksWide; bx++)
+            {
+                loadBlock(rgba, width, height, bx, by, block);
+                encodeBlock(format, block, blocks + (static_cast<size_t>(by) * blocksWide + bx) * size);
+            }
+        }
+    }
+
+    bool decodeImage(VkFormat format, const uint8_t *blocks, uint32_t width, uint32_t height, uint8_t *rgba)
+    {
+        uint32_t blocksWide = (width + 3) / 4;
+        uint32_t blocksHigh = (height + 3) / 4;
+        uint32_t size = blockSize(format);
+
+        uint8_t texels[16][4];
+        for (uint32_t by = 0; by < blocksHigh; by++)
+        {
+            for (uint32_t bx = 0; bx < blocksWide; bx++)
+            {
+                if (!decodeBlock(format, blocks + (static_cast<size_t>(by) * blocksWide + bx) * size, texels))
+                    return false;
+
+                for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+                {
+                    for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+                        memcpy(rgba + ((static_cast<size_t>(by) * 4 + y) * width + bx * 4 + x) * 4, texels[y * 4 + x], 4);
+                }
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+
+/**
+ * @brief CPU encoder and decoder for the BC1, BC3, BC5 and BC7 block formats
+ *
+ * Images are tightly packed RGBA8. Blocks are 4x4 texels, edge blocks of images whose size is not a
+ * multiple of 4 replicate the last row and column. The encoder is meant for offline cooking, the
+ * decoder for devices that cannot sample a format. BC7 is encoded with mode 6 only and decoded for the
+ * single subset modes 4, 5 and 6.
+ */
+namespace TextureCompression
+{
+    bool canEncode(VkFormat format);
+    bool canDecode(VkFormat format);
+
+    /** @brief The RGBA8 format with the same colour space decodeImage() produces for format */
+    VkFormat getDecodedFormat(VkFormat format);
+    /** @brief Bytes of block data for an image of the given size */
+    VkDeviceSize getEncodedSize(VkFormat format, uint32_t width, uint32_t height);
+
+    /**
+     * @brief Encodes rows of blocks [firstBlockRow, firstBlockRow + blockRowCount) of an image
+     *
+     * blocks points at the start of the whole encoded image, so disjoint row ranges can be encoded
+     * from different threads.
+     */
+    void encodeImage(VkFormat format, const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t *blocks,
+                     uint32_t firstBlockRow = 0, uint32_t blockRowCount = UINT32_MAX);
+    /** @return false if the data uses a block mode the decoder does not implement */
+    bool decodeImage(VkFormat format, const uint8_t *blocks, uint32_t width, uint32_t height, uint8_t *rgba);
+}
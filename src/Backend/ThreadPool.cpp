@@ -0,0 +1,47 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+void ThreadPool::create(uint32_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+    stopping = false;
+    workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+void ThreadPool::destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (std::thread &worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]()
+                           { return stopping || !tasks.empty(); });
+
+            if (tasks.empty())
+                return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads draining a shared FIFO of tasks
+ *
+ * submit() returns a future for the task's result. destroy() lets the workers finish the queue
+ * before joining them.
+ */
+class ThreadPool
+{
+public:
+    ThreadPool() = default;
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool() { destroy(); }
+
+    /** @param threadCount 0 picks one thread per hardware thread, minus the one running the caller */
+    void create(uint32_t threadCount = 0);
+    void destroy();
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> submit(Function &&function)
+    {
+        using Result = std::invoke_result_t<Function>;
+
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back([task]()
+                            { (*task)(); });
+        }
+        condition.notify_one();
+        return future;
+    }
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    void workerLoop();
+};
@@ -0,0 +1,310 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <assert.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    uint32_t findLowestBit32(uint32_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+    }
+
+    uint32_t findLowestBit64(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+    }
+
+    uint32_t findHighestBit64(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t size)
+{
+    reset(size);
+}
+
+void TlsfAllocator::reset(uint64_t size)
+{
+    this->size = size;
+    used = 0;
+    allocationCount = 0;
+    regions.clear();
+    unusedRegions.clear();
+
+    flBitmap = 0;
+    for (uint32_t fl = 0; fl < FL_COUNT; fl++)
+    {
+        slBitmap[fl] = 0;
+        for (uint32_t sl = 0; sl < SL_COUNT; sl++)
+            freeHeads[fl][sl] = NIL;
+    }
+
+    if (size > 0)
+    {
+        uint32_t index = createRegion();
+        regions[index].offset = 0;
+        regions[index].size = size;
+        insertFree(index);
+    }
+}
+
+uint32_t TlsfAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t &offset)
+{
+    size = std::max<uint64_t>(size, 1);
+    alignment = std::max<uint64_t>(alignment, 1);
+    if (size > this->size - used)
+        return INVALID_HANDLE;
+
+    // First look in the good-fit bucket for the plain size; every region there is large enough,
+    // but alignment padding can still push one over, so walk that list before widening the search
+    uint32_t fl, sl;
+    mappingSearch(size, fl, sl);
+    uint32_t index = fl < FL_COUNT ? findFree(fl, sl) : NIL;
+    while (index != NIL && !fits(regions[index], size, alignment))
+        index = regions[index].nextFree;
+
+    if (index == NIL && alignment > 1)
+    {
+        mappingSearch(size + alignment - 1, fl, sl);
+        index = fl < FL_COUNT ? findFree(fl, sl) : NIL;
+    }
+
+    if (index == NIL)
+        return INVALID_HANDLE;
+
+    removeFree(index);
+
+    // Neighbours of a free region are never free themselves, so the split-off pieces need no merging
+    uint64_t alignedOffset = alignUp(regions[index].offset, alignment);
+    uint64_t padding = alignedOffset - regions[index].offset;
+    if (padding > 0)
+    {
+        uint32_t head = createRegion();
+        Region &region = regions[index];
+        regions[head].offset = region.offset;
+        regions[head].size = padding;
+        regions[head].prevPhysical = region.prevPhysical;
+        regions[head].nextPhysical = index;
+        if (region.prevPhysical != NIL)
+            regions[region.prevPhysical].nextPhysical = head;
+        region.prevPhysical = head;
+        region.offset = alignedOffset;
+        region.size -= padding;
+        insertFree(head);
+    }
+
+    uint64_t remainder = regions[index].size - size;
+    if (remainder > 0)
+    {
+        uint32_t tail = createRegion();
+        Region &region = regions[index];
+        regions[tail].offset = region.offset + size;
+        regions[tail].size = remainder;
+        regions[tail].prevPhysical = index;
+        regions[tail].nextPhysical = region.nextPhysical;
+        if (region.nextPhysical != NIL)
+            regions[region.nextPhysical].prevPhysical = tail;
+        region.nextPhysical = tail;
+        region.size = size;
+        insertFree(tail);
+    }
+
+    Region &region = regions[index];
+    region.isFree = false;
+    used += region.size;
+    allocationCount++;
+
+    offset = region.offset;
+    return index;
+}
+
+void TlsfAllocator::free(uint32_t handle)
+{
+    assert(handle < regions.size() && !regions[handle].isFree && regions[handle].size > 0);
+
+    used -= regions[handle].size;
+    allocationCount--;
+
+    uint32_t prev = regions[handle].prevPhysical;
+    if (prev != NIL && regions[prev].isFree)
+    {
+        removeFree(prev);
+        regions[prev].size += regions[handle].size;
+        regions[prev].nextPhysical = regions[handle].nextPhysical;
+        if (regions[handle].nextPhysical != NIL)
+            regions[regions[handle].nextPhysical].prevPhysical = prev;
+        releaseRegion(handle);
+        handle = prev;
+    }
+
+    uint32_t next = regions[handle].nextPhysical;
+    if (next != NIL && regions[next].isFree)
+    {
+        removeFree(next);
+        regions[handle].size += regions[next].size;
+        regions[handle].nextPhysical = regions[next].nextPhysical;
+        if (regions[next].nextPhysical != NIL)
+            regions[regions[next].nextPhysical].prevPhysical = handle;
+        releaseRegion(next);
+    }
+
+    insertFree(handle);
+}
+
+TlsfAllocator::Statistics TlsfAllocator::getStatistics() const
+{
+    Statistics stats{};
+    stats.size = size;
+    stats.used = used;
+    stats.allocationCount = allocationCount;
+    for (const Region &region : regions)
+    {
+        if (region.size > 0 && region.isFree)
+        {
+            stats.freeRegionCount++;
+            stats.largestFreeRegion = std::max(stats.largestFreeRegion, region.size);
+        }
+    }
+    return stats;
+}
+
+uint32_t TlsfAllocator::createRegion()
+{
+    if (!unusedRegions.empty())
+    {
+        uint32_t index = unusedRegions.back();
+        unusedRegions.pop_back();
+        regions[index] = Region{};
+        return index;
+    }
+
+    regions.emplace_back();
+    return static_cast<uint32_t>(regions.size() - 1);
+}
+
+void TlsfAllocator::releaseRegion(uint32_t index)
+{
+    regions[index] = Region{};
+    unusedRegions.push_back(index);
+}
+
+void TlsfAllocator::mapping(uint64_t size, uint32_t &fl, uint32_t &sl) const
+{
+    if (size < SMALL_SIZE)
+    {
+        fl = 0;
+        sl = static_cast<uint32_t>(size / (SMALL_SIZE / SL_COUNT));
+        return;
+    }
+
+    uint32_t highestBit = findHighestBit64(size);
+    fl = highestBit - findHighestBit64(SMALL_SIZE) + 1;
+    sl = static_cast<uint32_t>(size >> (highestBit - SL_LOG2)) ^ SL_COUNT;
+}
+
+void TlsfAllocator::mappingSearch(uint64_t size, uint32_t &fl, uint32_t &sl) const
+{
+    // Round up to the next bucket boundary so that every region in the chosen bucket is large enough
+    if (size < SMALL_SIZE)
+        size += (SMALL_SIZE / SL_COUNT) - 1;
+    else
+        size += (1ull << (findHighestBit64(size) - SL_LOG2)) - 1;
+
+    mapping(size, fl, sl);
+}
+
+uint32_t TlsfAllocator::findFree(uint32_t fl, uint32_t sl) const
+{
+    uint32_t slMap = slBitmap[fl] & (~0u << sl);
+    if (slMap == 0)
+    {
+        uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0)
+            return NIL;
+
+        fl = findLowestBit64(flMap);
+        slMap = slBitmap[fl];
+    }
+
+    sl = findLowestBit32(slMap);
+    return freeHeads[fl][sl];
+}
+
+void TlsfAllocator::insertFree(uint32_t index)
+{
+    uint32_t fl, sl;
+    mapping(regions[index].size, fl, sl);
+
+    Region &region = regions[index];
+    region.isFree = true;
+    region.prevFree = NIL;
+    region.nextFree = freeHeads[fl][sl];
+    if (region.nextFree != NIL)
+        regions[region.nextFree].prevFree = index;
+    freeHeads[fl][sl] = index;
+
+    slBitmap[fl] |= 1u << sl;
+    flBitmap |= 1ull << fl;
+}
+
+void TlsfAllocator::removeFree(uint32_t index)
+{
+    uint32_t fl, sl;
+    mapping(regions[index].size, fl, sl);
+
+    Region &region = regions[index];
+    if (region.prevFree != NIL)
+        regions[region.prevFree].nextFree = region.nextFree;
+    if (region.nextFree != NIL)
+        regions[region.nextFree].prevFree = region.prevFree;
+
+    if (freeHeads[fl][sl] == index)
+    {
+        freeHeads[fl][sl] = region.nextFree;
+        if (freeHeads[fl][sl] == NIL)
+        {
+            slBitmap[fl] &= ~(1u << sl);
+            if (slBitmap[fl] == 0)
+                flBitmap &= ~(1ull << fl);
+        }
+    }
+
+    region.isFree = false;
+    region.prevFree = NIL;
+    region.nextFree = NIL;
+}
+
+bool TlsfAllocator::fits(const Region &region, uint64_t size, uint64_t alignment) const
+{
+    return alignUp(region.offset, alignment) + size <= region.offset + region.size;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief Two-level segregated fit (TLSF) sub-allocator for a single linear range
+ *
+ * Pure bookkeeping: it hands out offsets into a range of a given size and never touches
+ * the memory itself, so it is used for device memory blocks as well as host ring buffers.
+ * Allocation and free are O(1); free regions are coalesced with their physical neighbours.
+ */
+class TlsfAllocator
+{
+public:
+    static const uint32_t INVALID_HANDLE = UINT32_MAX;
+
+    /** @brief Free space statistics used for fragmentation reporting */
+    struct Statistics
+    {
+        uint64_t size = 0;
+        uint64_t used = 0;
+        uint64_t largestFreeRegion = 0;
+        uint32_t freeRegionCount = 0;
+        uint32_t allocationCount = 0;
+    };
+
+    explicit TlsfAllocator(uint64_t size = 0);
+
+    void reset(uint64_t size);
+    /** @brief Returns a handle (or INVALID_HANDLE if the range is exhausted) and the aligned offset of the allocation */
+    uint32_t allocate(uint64_t size, uint64_t alignment, uint64_t &offset);
+    void free(uint32_t handle);
+
+    uint64_t getSize() const { return size; }
+    uint64_t getUsed() const { return used; }
+    uint32_t getAllocationCount() const { return allocationCount; }
+    bool isEmpty() const { return allocationCount == 0; }
+    Statistics getStatistics() const;
+
+private:
+    static const uint32_t SL_LOG2 = 5;
+    static const uint32_t SL_COUNT = 1u << SL_LOG2;
+    static const uint32_t FL_COUNT = 48;
+    /** @brief Sizes below this go into the linear first-level bucket 0 */
+    static const uint64_t SMALL_SIZE = 256;
+    static const uint32_t NIL = UINT32_MAX;
+
+    struct Region
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t prevPhysical = NIL;
+        uint32_t nextPhysical = NIL;
+        uint32_t prevFree = NIL;
+        uint32_t nextFree = NIL;
+        bool isFree = false;
+    };
+
+    uint64_t size = 0;
+    uint64_t used = 0;
+    uint32_t allocationCount = 0;
+
+    std::vector<Region> regions;
+    std::vector<uint32_t> unusedRegions;
+
+    uint64_t flBitmap = 0;
+    uint32_t slBitmap[FL_COUNT]{};
+    uint32_t freeHeads[FL_COUNT][SL_COUNT];
+
+    uint32_t createRegion();
+    void releaseRegion(uint32_t index);
+    void mapping(uint64_t size, uint32_t &fl, uint32_t &sl) const;
+    void mappingSearch(uint64_t size, uint32_t &fl, uint32_t &sl) const;
+    uint32_t findFree(uint32_t fl, uint32_t sl) const;
+    void insertFree(uint32_t index);
+    void removeFree(uint32_t index);
+    bool fits(const Region &region, uint64_t size, uint64_t alignment) const;
+};
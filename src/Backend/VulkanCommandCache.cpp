@@ -0,0 +1,91 @@
+#include "VulkanCommandCache.h"
+
+#include <stdexcept>
+
+void VulkanCommandCache::create(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight)
+{
+    this->device = device;
+    hits = 0;
+    records = 0;
+
+    // Entries are re-recorded one at a time, so buffers have to be resettable individually
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    frames.resize(framesInFlight);
+    for (FrameCache &frame : frames)
+    {
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &frame.pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create command cache pool!");
+        }
+    }
+}
+
+void VulkanCommandCache::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    for (FrameCache &frame : frames)
+        vkDestroyCommandPool(device, frame.pool, nullptr);
+    frames.clear();
+    device = VK_NULL_HANDLE;
+}
+
+VkCommandBuffer VulkanCommandCache::get(uint32_t frame, uint32_t image, uint32_t pass, uint64_t version, const VkCommandBufferInheritanceInfo &inheritance,
+                                        const RecordFunction &record)
+{
+    FrameCache &frameCache = frames[frame];
+    Entry &entry = frameCache.entries[(static_cast<uint64_t>(image) << 32) | pass];
+
+    if (entry.recorded && entry.version == version)
+    {
+        hits++;
+        return entry.commandBuffer;
+    }
+
+    if (entry.commandBuffer == VK_NULL_HANDLE)
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = frameCache.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, &entry.commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate cached command buffer!");
+        }
+    }
+    else
+    {
+        vkResetCommandBuffer(entry.commandBuffer, 0);
+    }
+
+    // Not one time submit, the buffer is executed again in every later frame that finds it current
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    entry.recorded = false;
+    if (vkBeginCommandBuffer(entry.commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording cached command buffer!");
+    }
+
+    record(entry.commandBuffer);
+
+    if (vkEndCommandBuffer(entry.commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record cached command buffer!");
+    }
+
+    entry.version = version;
+    entry.recorded = true;
+    records++;
+    return entry.commandBuffer;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Keeps recorded secondary command buffers of a pass and replays them while nothing they reference changed
+ *
+ * Entries are kept per frame in flight, swapchain image and pass. The frame is part of the key because
+ * a pass binds that frame's descriptor set, and because an entry is then only ever pending in the frame
+ * that owns it: once the frame's previous submission has completed, its entries can be executed again or
+ * re-recorded without simultaneous use. An entry is re-recorded when the version it was recorded
+ * against differs from the one passed to get(). The owner bumps that version whenever something baked
+ * into the commands changes, such as framebuffers, pipelines or descriptor set contents. Data read
+ * through buffers, like the per frame uniforms, can change freely.
+ */
+class VulkanCommandCache
+{
+public:
+    using RecordFunction = std::function<void(VkCommandBuffer commandBuffer)>;
+
+    void create(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight);
+    /** @brief No frame may still be executing on the device */
+    void destroy();
+
+    /**
+     * @brief Returns the pass's secondary for frame and image, recording it first if it is missing or stale
+     *
+     * Only call once the previous submission of frame has completed.
+     */
+    VkCommandBuffer get(uint32_t frame, uint32_t image, uint32_t pass, uint64_t version, const VkCommandBufferInheritanceInfo &inheritance,
+                        const RecordFunction &record);
+
+    uint64_t getHitCount() const { return hits; }
+    uint64_t getRecordCount() const { return records; }
+
+private:
+    struct Entry
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        uint64_t version = 0;
+        bool recorded = false;
+    };
+
+    struct FrameCache
+    {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        /** @brief Keyed by swapchain image in the high half and pass in the low half */
+        std::unordered_map<uint64_t, Entry> entries;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    std::vector<FrameCache> frames;
+    uint64_t hits = 0;
+    uint64_t records = 0;
+};
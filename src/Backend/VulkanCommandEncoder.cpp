@@ -0,0 +1,224 @@
+#include "VulkanCommandEncoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+uint64_t VulkanCommandEncoder::Statistics::getIssuedTotal() const
+{
+    uint64_t total = 0;
+    for (uint64_t count : issued)
+        total += count;
+    return total;
+}
+
+uint64_t VulkanCommandEncoder::Statistics::getElidedTotal() const
+{
+    uint64_t total = 0;
+    for (uint64_t count : elided)
+        total += count;
+    return total;
+}
+
+VulkanCommandEncoder::Statistics &VulkanCommandEncoder::Statistics::operator+=(const Statistics &other)
+{
+    for (uint32_t i = 0; i < COMMAND_COUNT; i++)
+    {
+        issued[i] += other.issued[i];
+        elided[i] += other.elided[i];
+    }
+    return *this;
+}
+
+VulkanCommandEncoder::VulkanCommandEncoder(VkCommandBuffer commandBuffer)
+{
+    reset(commandBuffer);
+}
+
+void VulkanCommandEncoder::reset(VkCommandBuffer commandBuffer)
+{
+    this->commandBuffer = commandBuffer;
+
+    graphics = BindPointState{};
+    compute = BindPointState{};
+    std::fill(std::begin(vertexBuffers), std::end(vertexBuffers), VK_NULL_HANDLE);
+    std::fill(std::begin(vertexOffsets), std::end(vertexOffsets), 0);
+    indexBuffer = VK_NULL_HANDLE;
+    indexOffset = 0;
+    indexType = VK_INDEX_TYPE_MAX_ENUM;
+    viewportKnown = false;
+    scissorKnown = false;
+    pushConstantLayout = VK_NULL_HANDLE;
+    pushConstantStages = 0;
+    pushConstantBegin = 0;
+    pushConstantEnd = 0;
+}
+
+VulkanCommandEncoder::BindPointState *VulkanCommandEncoder::getBindPoint(VkPipelineBindPoint bindPoint)
+{
+    if (bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
+        return &graphics;
+    if (bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE)
+        return &compute;
+    return nullptr;
+}
+
+bool VulkanCommandEncoder::issue(Command command, bool redundant)
+{
+    uint32_t index = static_cast<uint32_t>(command);
+    if (redundant && filtering)
+    {
+        statistics.elided[index]++;
+        return false;
+    }
+    statistics.issued[index]++;
+    return true;
+}
+
+void VulkanCommandEncoder::bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline)
+{
+    BindPointState *state = getBindPoint(bindPoint);
+    if (!issue(Command::BindPipeline, state && state->pipeline == pipeline))
+        return;
+
+    vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
+    if (state)
+        state->pipeline = pipeline;
+}
+
+void VulkanCommandEncoder::bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount,
+                                              const VkDescriptorSet *descriptorSets, uint32_t dynamicOffsetCount, const uint32_t *dynamicOffsets)
+{
+    BindPointState *state = getBindPoint(bindPoint);
+    bool tracked = state && firstSet + setCount <= MAX_DESCRIPTOR_SETS;
+
+    bool redundant = tracked && dynamicOffsetCount == 0 && state->layout == layout;
+    for (uint32_t i = 0; redundant && i < setCount; i++)
+        redundant = state->descriptorSets[firstSet + i] == descriptorSets[i];
+
+    if (!issue(Command::BindDescriptorSets, redundant))
+        return;
+
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, firstSet, setCount, descriptorSets, dynamicOffsetCount, dynamicOffsets);
+
+    if (!state)
+        return;
+
+    // Whether other sets survive a different layout depends on compatibility rules, forget them instead
+    if (state->layout != layout)
+    {
+        std::fill(std::begin(state->descriptorSets), std::end(state->descriptorSets), VK_NULL_HANDLE);
+        state->layout = layout;
+    }
+    for (uint32_t i = 0; i < setCount && firstSet + i < MAX_DESCRIPTOR_SETS; i++)
+        state->descriptorSets[firstSet + i] = dynamicOffsetCount == 0 ? descriptorSets[i] : VK_NULL_HANDLE;
+}
+
+void VulkanCommandEncoder::bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer *buffers, const VkDeviceSize *offsets)
+{
+    bool tracked = firstBinding + bindingCount <= MAX_VERTEX_BINDINGS;
+
+    bool redundant = tracked;
+    for (uint32_t i = 0; redundant && i < bindingCount; i++)
+        redundant = vertexBuffers[firstBinding + i] == buffers[i] && vertexOffsets[firstBinding + i] == offsets[i];
+
+    if (!issue(Command::BindVertexBuffers, redundant))
+        return;
+
+    vkCmdBindVertexBuffers(commandBuffer, firstBinding, bindingCount, buffers, offsets);
+    for (uint32_t i = 0; i < bindingCount && firstBinding + i < MAX_VERTEX_BINDINGS; i++)
+    {
+        vertexBuffers[firstBinding + i] = buffers[i];
+        vertexOffsets[firstBinding + i] = offsets[i];
+    }
+}
+
+void VulkanCommandEncoder::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+    if (!issue(Command::BindIndexBuffer, indexBuffer == buffer && indexOffset == offset && this->indexType == indexType))
+        return;
+
+    vkCmdBindIndexBuffer(commandBuffer, buffer, offset, indexType);
+    indexBuffer = buffer;
+    indexOffset = offset;
+    this->indexType = indexType;
+}
+
+void VulkanCommandEncoder::setViewport(const VkViewport &viewport)
+{
+    bool redundant = viewportKnown && this->viewport.x == viewport.x && this->viewport.y == viewport.y && this->viewport.width == viewport.width &&
+                     this->viewport.height == viewport.height && this->viewport.minDepth == viewport.minDepth && this->viewport.maxDepth == viewport.maxDepth;
+    if (!issue(Command::SetViewport, redundant))
+        return;
+
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    this->viewport = viewport;
+    viewportKnown = true;
+}
+
+void VulkanCommandEncoder::setScissor(const VkRect2D &scissor)
+{
+    bool redundant = scissorKnown && this->scissor.offset.x == scissor.offset.x && this->scissor.offset.y == scissor.offset.y &&
+                     this->scissor.extent.width == scissor.extent.width && this->scissor.extent.height == scissor.extent.height;
+    if (!issue(Command::SetScissor, redundant))
+        return;
+
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    this->scissor = scissor;
+    scissorKnown = true;
+}
+
+void VulkanCommandEncoder::pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void *values)
+{
+    uint32_t end = offset + size;
+    bool tracked = end <= MAX_PUSH_CONSTANT_BYTES;
+    bool sameTarget = pushConstantLayout == layout && pushConstantStages == stages;
+
+    bool redundant = tracked && sameTarget && offset >= pushConstantBegin && end <= pushConstantEnd &&
+                     std::memcmp(pushConstantBytes + offset, values, size) == 0;
+    if (!issue(Command::PushConstants, redundant))
+        return;
+
+    vkCmdPushConstants(commandBuffer, layout, stages, offset, size, values);
+
+    if (!tracked)
+    {
+        pushConstantLayout = VK_NULL_HANDLE;
+        pushConstantBegin = pushConstantEnd = 0;
+        return;
+    }
+
+    // Grow the known range when the new one touches it, otherwise start over from the new one
+    if (sameTarget && offset <= pushConstantEnd && end >= pushConstantBegin && pushConstantBegin != pushConstantEnd)
+    {
+        pushConstantBegin = std::min(pushConstantBegin, offset);
+        pushConstantEnd = std::max(pushConstantEnd, end);
+    }
+    else
+    {
+        pushConstantBegin = offset;
+        pushConstantEnd = end;
+    }
+    pushConstantLayout = layout;
+    pushConstantStages = stages;
+    std::memcpy(pushConstantBytes + offset, values, size);
+}
+
+void VulkanCommandEncoder::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+    issue(Command::Draw, false);
+    vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+void VulkanCommandEncoder::drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
+{
+    issue(Command::Draw, false);
+    vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+}
+
+void VulkanCommandEncoder::drawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount,
+                                                    uint32_t stride)
+{
+    issue(Command::Draw, false);
+    vkCmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
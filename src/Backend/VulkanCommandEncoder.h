@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+
+/**
+ * @brief Records state commands into a command buffer, dropping the ones that would not change bound state
+ *
+ * Tracks the pipeline and descriptor sets of the graphics and compute bind points, vertex and index
+ * buffers, viewport and scissor 0 and up to MAX_PUSH_CONSTANT_BYTES of push constants. A command is
+ * elided when everything it sets is already known to hold the same values. The tracking is
+ * conservative. Binding descriptor sets through a different pipeline layout forgets the other sets,
+ * and push constants are only compared against values pushed through the same layout and stages.
+ * Sets bound with dynamic offsets are always issued.
+ *
+ * An encoder starts with nothing known, which matches a freshly begun command buffer, in particular a
+ * secondary. Call reset() wherever bound state becomes undefined, such as after vkCmdExecuteCommands.
+ * Commands recorded directly into the command buffer bypass the tracking and must be followed by reset().
+ */
+class VulkanCommandEncoder
+{
+public:
+    enum class Command
+    {
+        BindPipeline,
+        BindDescriptorSets,
+        BindVertexBuffers,
+        BindIndexBuffer,
+        SetViewport,
+        SetScissor,
+        PushConstants,
+        Draw,
+        Count
+    };
+
+    static const uint32_t COMMAND_COUNT = static_cast<uint32_t>(Command::Count);
+    static const uint32_t MAX_DESCRIPTOR_SETS = 8;
+    static const uint32_t MAX_VERTEX_BINDINGS = 8;
+    static const uint32_t MAX_PUSH_CONSTANT_BYTES = 128;
+
+    struct Statistics
+    {
+        uint64_t issued[COMMAND_COUNT] = {};
+        uint64_t elided[COMMAND_COUNT] = {};
+
+        uint64_t getIssued(Command command) const { return issued[static_cast<uint32_t>(command)]; }
+        uint64_t getElided(Command command) const { return elided[static_cast<uint32_t>(command)]; }
+        uint64_t getIssuedTotal() const;
+        uint64_t getElidedTotal() const;
+
+        Statistics &operator+=(const Statistics &other);
+    };
+
+    explicit VulkanCommandEncoder(VkCommandBuffer commandBuffer = VK_NULL_HANDLE);
+
+    /** @brief Continues with commandBuffer and forgets all bound state, statistics are kept */
+    void reset(VkCommandBuffer commandBuffer);
+    void reset() { reset(commandBuffer); }
+    /** @brief With filtering off every command is issued, for measuring what the filtering saves */
+    void setFiltering(bool enabled) { filtering = enabled; }
+
+    void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+    void bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount, const VkDescriptorSet *descriptorSets,
+                            uint32_t dynamicOffsetCount = 0, const uint32_t *dynamicOffsets = nullptr);
+    void bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer *buffers, const VkDeviceSize *offsets);
+    void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+    void setViewport(const VkViewport &viewport);
+    void setScissor(const VkRect2D &scissor);
+    void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void *values);
+
+    void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+    void drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+    void drawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride);
+
+    VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+    const Statistics &getStatistics() const { return statistics; }
+
+private:
+    struct BindPointState
+    {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSets[MAX_DESCRIPTOR_SETS] = {};
+    };
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    bool filtering = true;
+    Statistics statistics;
+
+    BindPointState graphics;
+    BindPointState compute;
+
+    VkBuffer vertexBuffers[MAX_VERTEX_BINDINGS] = {};
+    VkDeviceSize vertexOffsets[MAX_VERTEX_BINDINGS] = {};
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize indexOffset = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_MAX_ENUM;
+
+    bool viewportKnown = false;
+    VkViewport viewport{};
+    bool scissorKnown = false;
+    VkRect2D scissor{};
+
+    VkPipelineLayout pushConstantLayout = VK_NULL_HANDLE;
+    VkShaderStageFlags pushConstantStages = 0;
+    /** @brief Bytes [pushConstantBegin, pushConstantEnd) of pushConstantBytes hold the last pushed values */
+    uint32_t pushConstantBegin = 0;
+    uint32_t pushConstantEnd = 0;
+    uint8_t pushConstantBytes[MAX_PUSH_CONSTANT_BYTES] = {};
+
+    BindPointState *getBindPoint(VkPipelineBindPoint bindPoint);
+    /** @brief Counts the command and returns whether it has to be recorded */
+    bool issue(Command command, bool redundant);
+};
@@ -0,0 +1,153 @@
+#include "VulkanCommandRecorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void VulkanCommandRecorder::create(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, JobSystem &jobs, uint32_t minDrawsPerBuffer)
+{
+    this->device = device;
+    this->jobs = &jobs;
+    threadCount = std::max(1u, jobs.getThreadCount());
+    this->minDrawsPerBuffer = std::max(1u, minDrawsPerBuffer);
+    currentFrame = 0;
+
+    // Pools are reset as a whole, individual buffers never are
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    framePools.resize(framesInFlight);
+    for (std::vector<FramePool> &slots : framePools)
+    {
+        slots.resize(threadCount);
+        for (FramePool &framePool : slots)
+        {
+            if (vkCreateCommandPool(device, &poolInfo, nullptr, &framePool.pool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create recording command pool!");
+            }
+        }
+    }
+}
+
+void VulkanCommandRecorder::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    jobs = nullptr;
+    for (std::vector<FramePool> &slots : framePools)
+    {
+        for (FramePool &framePool : slots)
+            vkDestroyCommandPool(device, framePool.pool, nullptr);
+    }
+    framePools.clear();
+    recorded.clear();
+    device = VK_NULL_HANDLE;
+}
+
+void VulkanCommandRecorder::beginFrame(uint32_t frame)
+{
+    currentFrame = frame;
+    for (FramePool &framePool : framePools[frame])
+    {
+        vkResetCommandPool(device, framePool.pool, 0);
+        framePool.used = 0;
+    }
+    recorded.clear();
+}
+
+const std::vector<VkCommandBuffer> &VulkanCommandRecorder::record(const VkCommandBufferInheritanceInfo &inheritance, uint32_t drawCount,
+                                                                  const RecordFunction &recordDraws)
+{
+    std::vector<FramePool> &slots = framePools[currentFrame];
+
+    uint32_t batchCount = std::max(1u, std::min(threadCount, drawCount / minDrawsPerBuffer));
+    uint32_t drawsPerBatch = (drawCount + batchCount - 1) / batchCount;
+    batchCount = drawCount > 0 ? (drawCount + drawsPerBatch - 1) / drawsPerBatch : 1;
+
+    // Buffers are taken from the pools here, batch i is recorded from slot i's pool and no two threads share one
+    size_t firstRecorded = recorded.size();
+    for (uint32_t batch = 0; batch < batchCount; batch++)
+        recorded.push_back(acquireBuffer(slots[batch]));
+
+    JobCounter batches;
+    for (uint32_t batch = 1; batch < batchCount; batch++)
+    {
+        uint32_t firstDraw = batch * drawsPerBatch;
+        uint32_t count = std::min(drawsPerBatch, drawCount - firstDraw);
+        VkCommandBuffer commandBuffer = recorded[firstRecorded + batch];
+        jobs->run([commandBuffer, &inheritance, firstDraw, count, &recordDraws]()
+                  { recordBatch(commandBuffer, inheritance, firstDraw, count, recordDraws); },
+                  &batches);
+    }
+
+    // The caller records the first batch instead of idling until the others are done
+    std::exception_ptr error;
+    try
+    {
+        recordBatch(recorded[firstRecorded], inheritance, 0, std::min(drawsPerBatch, drawCount), recordDraws);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    // Every batch has to finish before anything it references goes out of scope, even after a failure
+    try
+    {
+        jobs->wait(batches);
+    }
+    catch (...)
+    {
+        if (!error)
+            error = std::current_exception();
+    }
+    if (error)
+        std::rethrow_exception(error);
+
+    return recorded;
+}
+
+VkCommandBuffer VulkanCommandRecorder::acquireBuffer(FramePool &framePool)
+{
+    if (framePool.used == framePool.buffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = framePool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate secondary command buffer!");
+        }
+        framePool.buffers.push_back(commandBuffer);
+    }
+    return framePool.buffers[framePool.used++];
+}
+
+void VulkanCommandRecorder::recordBatch(VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo &inheritance, uint32_t firstDraw,
+                                        uint32_t drawCount, const RecordFunction &recordDraws)
+{
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+
+    if (drawCount > 0)
+        recordDraws(commandBuffer, firstDraw, drawCount);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record secondary command buffer!");
+    }
+}
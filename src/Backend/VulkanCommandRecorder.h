@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <vector>
+
+#include "JobSystem.h"
+
+/**
+ * @brief Records the draws of a render pass into secondary command buffers on several threads
+ *
+ * Every recording slot owns one command pool per frame in flight, so no pool is ever touched by two
+ * threads at once. beginFrame() resets all pools of a frame with vkResetCommandPool instead of
+ * resetting buffers one by one. Batches run as jobs of a JobSystem, the calling thread records the first
+ * one and then helps with the rest until all are done. The returned secondaries are in draw order and are executed with vkCmdExecuteCommands
+ * inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+ */
+class VulkanCommandRecorder
+{
+public:
+    /** @brief Records draws [firstDraw, firstDraw + drawCount), including any state a secondary does not inherit */
+    using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)>;
+
+    /**
+     * @param jobs Records the batches, one batch per thread at most, must outlive the recorder
+     * @param minDrawsPerBuffer Smaller batches are merged, a secondary is not worth it for a handful of draws
+     */
+    void create(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, JobSystem &jobs, uint32_t minDrawsPerBuffer = 64);
+    /** @brief No frame may still be executing on the device */
+    void destroy();
+
+    /** @brief Resets every pool of frame, the frame's previous submission must have completed */
+    void beginFrame(uint32_t frame);
+
+    /**
+     * @brief Splits drawCount draws into contiguous batches and records them in parallel
+     * @return Secondaries of the current frame in draw order, valid until its next beginFrame()
+     */
+    const std::vector<VkCommandBuffer> &record(const VkCommandBufferInheritanceInfo &inheritance, uint32_t drawCount, const RecordFunction &recordDraws);
+
+    uint32_t getThreadCount() const { return threadCount; }
+
+private:
+    struct FramePool
+    {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        /** @brief Allocated on demand and reused after every reset */
+        std::vector<VkCommandBuffer> buffers;
+        uint32_t used = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    uint32_t threadCount = 0;
+    uint32_t minDrawsPerBuffer = 0;
+    uint32_t currentFrame = 0;
+    JobSystem *jobs = nullptr;
+
+    /** @brief Indexed [frame][slot] */
+    std::vector<std::vector<FramePool>> framePools;
+    std::vector<VkCommandBuffer> recorded;
+
+    VkCommandBuffer acquireBuffer(FramePool &framePool);
+    static void recordBatch(VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo &inheritance, uint32_t firstDraw, uint32_t drawCount,
+                            const RecordFunction &recordDraws);
+};
@@ -16,6 +16,7 @@ VulkanDevice::VulkanDevice(VkPhysicalDevice physicalDevice)
     uint32_t queueFamilyCount;
     vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
     assert(queueFamilyCount > 0);
+    queueFamilyProperties.resize(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
 
     // Get list of supported extensions
@@ -36,6 +37,7 @@ VulkanDevice::VulkanDevice(VkPhysicalDevice physicalDevice)
 
 VulkanDevice::~VulkanDevice()
 {
+    memoryAllocator.destroy();
     vkDestroyDevice(logicalDevice, nullptr);
 }
 
@@ -55,6 +57,17 @@ VkResult VulkanDevice::createLogicalDevice(VkPhysicalDeviceFeatures enabledFeatu
         queueCreateInfos.push_back(graphicsQueue);
     }
 
+    // Dedicated transfer queue for asynchronous uploads, if the device has a separate family for it
+    if (queueFamilyIndices.transfer != queueFamilyIndices.graphics.value())
+    {
+        VkDeviceQueueCreateInfo transferQueue{};
+        transferQueue.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        transferQueue.pQueuePriorities = &queuePriority;
+        transferQueue.queueFamilyIndex = queueFamilyIndices.transfer;
+        transferQueue.queueCount = 1;
+        queueCreateInfos.push_back(transferQueue);
+    }
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
@@ -70,8 +83,13 @@ VkResult VulkanDevice::createLogicalDevice(VkPhysicalDeviceFeatures enabledFeatu
         }
     }
 
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &timelineFeatures;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
@@ -82,6 +100,10 @@ VkResult VulkanDevice::createLogicalDevice(VkPhysicalDeviceFeatures enabledFeatu
     {
         throw std::runtime_error("failed to create logical device");
     }
+
+    memoryAllocator.init(physicalDevice, logicalDevice);
+
+    return VK_SUCCESS;
 }
 
 void VulkanDevice::findQueueFamilies(VkPhysicalDevice device)
@@ -118,5 +140,57 @@ void VulkanDevice::findQueueFamilies(VkPhysicalDevice device)
         i++;
     }
 
+    queueFamilyIndices.compute = getQueueFamilyIndex(VK_QUEUE_COMPUTE_BIT);
+    queueFamilyIndices.transfer = getQueueFamilyIndex(VK_QUEUE_TRANSFER_BIT);
+
     // return indices;
 }
+
+uint32_t VulkanDevice::getQueueFamilyIndex(VkQueueFlags queueFlags) const
+{
+    // Prefer a family that supports the requested flags and as little else as possible
+    if ((queueFlags & VK_QUEUE_COMPUTE_BIT) == queueFlags)
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilyProperties.size()); i++)
+        {
+            if ((queueFamilyProperties[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+                return i;
+        }
+    }
+
+    if ((queueFlags & VK_QUEUE_TRANSFER_BIT) == queueFlags)
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilyProperties.size()); i++)
+        {
+            if ((queueFamilyProperties[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamilyProperties[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+                return i;
+        }
+    }
+
+    // Graphics and compute families implicitly support transfer
+    for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilyProperties.size()); i++)
+    {
+        VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+        if (flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+            flags |= VK_QUEUE_TRANSFER_BIT;
+        if ((flags & queueFlags) == queueFlags)
+            return i;
+    }
+
+    throw std::runtime_error("Could not find a matching queue family index");
+}
+
+uint32_t VulkanDevice::getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+    return memoryAllocator.findMemoryType(typeBits, properties);
+}
+
+void VulkanDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VulkanAllocation &allocation)
+{
+    memoryAllocator.createBuffer(size, usage, properties, buffer, allocation);
+}
+
+void VulkanDevice::createImage(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image, VulkanAllocation &allocation)
+{
+    memoryAllocator.createImage(imageInfo, properties, image, allocation);
+}
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <optional>
 
+#include "VulkanMemoryAllocator.h"
+
 struct VulkanDevice
 {
     VkPhysicalDevice physicalDevice;
@@ -20,6 +22,8 @@ struct VulkanDevice
 	std::vector<VkQueueFamilyProperties> queueFamilyProperties;
 	/** @brief List of extensions supported by the device */
 	std::vector<std::string> supportedExtensions;
+	/** @brief Sub-allocator all buffer and image memory of this device is taken from */
+	VulkanMemoryAllocator memoryAllocator;
 	/** @brief Default command pool for the graphics queue family index */
 	VkCommandPool commandPool = VK_NULL_HANDLE;
 	/** @brief Contains queue family indices */
@@ -28,6 +32,7 @@ struct VulkanDevice
 		std::optional<uint32_t> graphics;
         //std::optional<uint32_t> present;
 		uint32_t compute;
+		/** @brief Transfer only family if there is one, used for asynchronous uploads */
 		uint32_t transfer;
 
         bool isComplete()
@@ -44,4 +49,8 @@ struct VulkanDevice
     ~VulkanDevice();
     VkResult createLogicalDevice(VkPhysicalDeviceFeatures enabledFeatures, std::vector<const char*> enabledExtensions, bool useSwapChain = true);
     void findQueueFamilies(VkPhysicalDevice device);
+    uint32_t getQueueFamilyIndex(VkQueueFlags queueFlags) const;
+    uint32_t getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VulkanAllocation &allocation);
+    void createImage(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image, VulkanAllocation &allocation);
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "VulkanFrameScheduler.h"
+
+#include <stdexcept>
+
+void VulkanFrameScheduler::create(VkDevice device, uint32_t framesInFlight)
+{
+    this->device = device;
+    this->framesInFlight = framesInFlight;
+    frameValue = 1;
+
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create frame timeline semaphore!");
+    }
+}
+
+void VulkanFrameScheduler::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    // Every value below the upcoming frame's has been submitted
+    wait(frameValue - 1);
+    runDeferred(UINT64_MAX);
+
+    vkDestroySemaphore(device, timeline, nullptr);
+    device = VK_NULL_HANDLE;
+}
+
+uint32_t VulkanFrameScheduler::beginFrame()
+{
+    if (frameValue > framesInFlight)
+    {
+        wait(frameValue - framesInFlight);
+    }
+    runDeferred(getCompletedValue());
+
+    return getFrameSlot();
+}
+
+void VulkanFrameScheduler::endFrame()
+{
+    frameValue++;
+}
+
+void VulkanFrameScheduler::defer(std::function<void()> function)
+{
+    deferred.push_back({frameValue, std::move(function)});
+}
+
+uint64_t VulkanFrameScheduler::getCompletedValue()
+{
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(device, timeline, &completed);
+    return completed;
+}
+
+bool VulkanFrameScheduler::isComplete(uint64_t value)
+{
+    return getCompletedValue() >= value;
+}
+
+void VulkanFrameScheduler::wait(uint64_t value)
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &value;
+    if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to wait for frame timeline semaphore!");
+    }
+}
+
+void VulkanFrameScheduler::runDeferred(uint64_t completed)
+{
+    // Deferred in frame order, so the completed ones are at the front
+    while (!deferred.empty() && deferred.front().value <= completed)
+    {
+        std::function<void()> function = std::move(deferred.front().function);
+        deferred.pop_front();
+        function();
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <functional>
+
+/** @brief Takes a function that destroys something once no submitted frame can use it anymore, such as VulkanFrameScheduler::defer */
+typedef std::function<void(std::function<void()>)> RetireFunction;
+
+/**
+ * @brief Paces frames on the graphics queue with one timeline semaphore instead of a fence per frame
+ *
+ * Frame N signals value N on the timeline when its submission completes and records into the per frame
+ * resources of slot N % framesInFlight. beginFrame() only waits for frame N - framesInFlight, the last
+ * one to use that slot, so the CPU records frame N + 1 while the GPU is still busy with frame N.
+ *
+ * Other work can key off the same timeline. Pass getFrameValue() to code that needs to know when the
+ * frame being recorded is done, poll it with isComplete(), or hand cleanup to defer(). Deferred functions
+ * run in beginFrame() once their frame has completed.
+ */
+class VulkanFrameScheduler
+{
+public:
+    void create(VkDevice device, uint32_t framesInFlight);
+    /** @brief Waits for every submitted frame and runs everything deferred */
+    void destroy();
+
+    /**
+     * @brief Waits until the upcoming frame's slot is free and runs the deferred work that completed
+     * @return Slot of the per frame resources the upcoming frame uses
+     */
+    uint32_t beginFrame();
+    /** @brief The upcoming frame's submission signalled getFrameValue() on getTimeline(), move on to the next frame */
+    void endFrame();
+
+    /** @brief Timeline value the submission of the frame being recorded has to signal */
+    uint64_t getFrameValue() const { return frameValue; }
+    uint32_t getFrameSlot() const { return static_cast<uint32_t>(frameValue % framesInFlight); }
+    uint32_t getFramesInFlight() const { return framesInFlight; }
+    VkSemaphore getTimeline() const { return timeline; }
+
+    /** @brief Runs function once the frame being recorded, and so every frame before it, has completed */
+    void defer(std::function<void()> function);
+
+    uint64_t getCompletedValue();
+    bool isComplete(uint64_t value);
+    void wait(uint64_t value);
+
+private:
+    struct Deferred
+    {
+        uint64_t value;
+        std::function<void()> function;
+    };
+
+    VkDevice device{VK_NULL_HANDLE};
+    VkSemaphore timeline{VK_NULL_HANDLE};
+    uint32_t framesInFlight = 0;
+    /** @brief Starts at 1, the timeline's initial value of 0 means nothing has completed */
+    uint64_t frameValue = 1;
+
+    std::deque<Deferred> deferred;
+
+    void runDeferred(uint64_t completed);
+};
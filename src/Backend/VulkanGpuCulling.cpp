@@ -0,0 +1,549 @@
+#include "VulkanGpuCulling.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    const uint32_t CULL_GROUP_SIZE = 64;
+    const uint32_t PYRAMID_GROUP_SIZE = 8;
+
+    uint32_t previousPowerOfTwo(uint32_t value)
+    {
+        uint32_t result = 1;
+        while (result * 2 <= value)
+            result *= 2;
+        return result;
+    }
+
+    VkWriteDescriptorSet bufferWrite(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, const VkDescriptorBufferInfo *info)
+    {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.descriptorCount = 1;
+        write.descriptorType = type;
+        write.pBufferInfo = info;
+        return write;
+    }
+
+    VkWriteDescriptorSet imageWrite(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo *info)
+    {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.descriptorCount = 1;
+        write.descriptorType = type;
+        write.pImageInfo = info;
+        return write;
+    }
+}
+
+void VulkanGpuCulling::create(VkDevice device, VulkanMemoryAllocator &allocator, uint32_t framesInFlight, const CullingInputs &inputs,
+                              VkShaderModule cullShader, VkShaderModule pyramidShader, bool compact)
+{
+    this->device = device;
+    this->allocator = &allocator;
+    this->inputs = inputs;
+    this->compact = compact;
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &pyramidSampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create depth pyramid sampler!");
+    }
+
+    createPipelines(cullShader, pyramidShader);
+    createBuffers(framesInFlight);
+    createCullSets(framesInFlight);
+}
+
+void VulkanGpuCulling::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    destroyPyramid();
+
+    for (size_t i = 0; i < uniformBuffers.size(); i++)
+        allocator->destroyBuffer(uniformBuffers[i], uniformAllocations[i]);
+    uniformBuffers.clear();
+    uniformAllocations.clear();
+    allocator->destroyBuffer(drawCountBuffer, drawCountAllocation);
+    allocator->destroyBuffer(outputCommandBuffer, outputCommandAllocation);
+
+    vkDestroyDescriptorPool(device, pyramidDescriptorPool, nullptr);
+    vkDestroyDescriptorPool(device, cullDescriptorPool, nullptr);
+    vkDestroyPipeline(device, pyramidPipeline, nullptr);
+    vkDestroyPipeline(device, cullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, pyramidPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, pyramidSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, cullSetLayout, nullptr);
+    vkDestroySampler(device, pyramidSampler, nullptr);
+    cullSets.clear();
+    device = VK_NULL_HANDLE;
+}
+
+void VulkanGpuCulling::createPipelines(VkShaderModule cullShader, VkShaderModule pyramidShader)
+{
+    // Uniforms, objects, bounds, input commands, output commands, count and the depth pyramid
+    std::array<VkDescriptorSetLayoutBinding, 7> cullBindings{};
+    for (uint32_t i = 0; i < cullBindings.size(); i++)
+    {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    cullBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cullBindings[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+    layoutInfo.pBindings = cullBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull descriptor set layout!");
+    }
+
+    // Source level (or the depth image) and destination level
+    std::array<VkDescriptorSetLayoutBinding, 2> pyramidBindings{};
+    pyramidBindings[0].binding = 0;
+    pyramidBindings[0].descriptorCount = 1;
+    pyramidBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pyramidBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pyramidBindings[1].binding = 1;
+    pyramidBindings[1].descriptorCount = 1;
+    pyramidBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    pyramidBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    layoutInfo.bindingCount = static_cast<uint32_t>(pyramidBindings.size());
+    layoutInfo.pBindings = pyramidBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &pyramidSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create depth pyramid descriptor set layout!");
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &cullSetLayout;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull pipeline layout!");
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PyramidSizes);
+
+    pipelineLayoutInfo.pSetLayouts = &pyramidSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pyramidPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create depth pyramid pipeline layout!");
+    }
+
+    std::array<VkComputePipelineCreateInfo, 2> pipelineInfos{};
+    for (VkComputePipelineCreateInfo &pipelineInfo : pipelineInfos)
+    {
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.pName = "main";
+    }
+    pipelineInfos[0].stage.module = cullShader;
+    pipelineInfos[0].layout = cullPipelineLayout;
+    pipelineInfos[1].stage.module = pyramidShader;
+    pipelineInfos[1].layout = pyramidPipelineLayout;
+
+    std::array<VkPipeline, 2> pipelines{};
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, static_cast<uint32_t>(pipelineInfos.size()), pipelineInfos.data(), nullptr, pipelines.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create culling pipelines!");
+    }
+    cullPipeline = pipelines[0];
+    pyramidPipeline = pipelines[1];
+}
+
+void VulkanGpuCulling::createBuffers(uint32_t framesInFlight)
+{
+    VkDeviceSize commandsSize = static_cast<VkDeviceSize>(std::max(1u, inputs.objectCount)) * sizeof(VkDrawIndexedIndirectCommand);
+    allocator->createBuffer(commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                            outputCommandBuffer, outputCommandAllocation);
+    allocator->createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawCountBuffer, drawCountAllocation);
+
+    uniformBuffers.resize(framesInFlight);
+    uniformAllocations.resize(framesInFlight);
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        allocator->createBuffer(sizeof(CullUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                uniformBuffers[i], uniformAllocations[i]);
+        std::memset(uniformAllocations[i].mapped, 0, sizeof(CullUniforms));
+    }
+}
+
+void VulkanGpuCulling::createCullSets(uint32_t framesInFlight)
+{
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, framesInFlight};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 * framesInFlight};
+    poolSizes[2] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, framesInFlight};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = framesInFlight;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &cullDescriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, cullSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = cullDescriptorPool;
+    allocInfo.descriptorSetCount = framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+
+    cullSets.resize(framesInFlight);
+    if (vkAllocateDescriptorSets(device, &allocInfo, cullSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate cull descriptor sets!");
+    }
+
+    cullSetsStale.assign(framesInFlight, false);
+
+    // The pyramid binding is written once setDepthImage() has created a pyramid
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        std::array<VkDescriptorBufferInfo, 6> bufferInfos{};
+        bufferInfos[0] = {uniformBuffers[i], 0, sizeof(CullUniforms)};
+        bufferInfos[1] = {inputs.objectBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[2] = {inputs.boundsBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[3] = {inputs.drawCommandBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[4] = {outputCommandBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[5] = {drawCountBuffer, 0, VK_WHOLE_SIZE};
+
+        std::array<VkWriteDescriptorSet, 6> writes{};
+        writes[0] = bufferWrite(cullSets[i], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &bufferInfos[0]);
+        for (uint32_t binding = 1; binding < writes.size(); binding++)
+            writes[binding] = bufferWrite(cullSets[i], binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfos[binding]);
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+}
+
+void VulkanGpuCulling::setDepthImage(VkImageView depthView, uint32_t width, uint32_t height, const RetireFunction &retire)
+{
+    destroyPyramid(retire);
+
+    depthWidth = width;
+    depthHeight = height;
+
+    // Power of two levels so every texel of a level covers exactly 2x2 texels of the one above
+    pyramidWidth = previousPowerOfTwo(width);
+    pyramidHeight = previousPowerOfTwo(height);
+    pyramidLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(pyramidWidth, pyramidHeight)))) + 1;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {pyramidWidth, pyramidHeight, 1};
+    imageInfo.mipLevels = pyramidLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    allocator->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pyramid, pyramidAllocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pyramid;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramidLevels, 0, 1};
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &pyramidView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create depth pyramid view!");
+    }
+
+    pyramidLevelViews.resize(pyramidLevels);
+    for (uint32_t level = 0; level < pyramidLevels; level++)
+    {
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+        if (vkCreateImageView(device, &viewInfo, nullptr, &pyramidLevelViews[level]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create depth pyramid level view!");
+        }
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, pyramidLevels};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, pyramidLevels};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = pyramidLevels;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pyramidDescriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create depth pyramid descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(pyramidLevels, pyramidSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pyramidDescriptorPool;
+    allocInfo.descriptorSetCount = pyramidLevels;
+    allocInfo.pSetLayouts = layouts.data();
+
+    pyramidSets.resize(pyramidLevels);
+    if (vkAllocateDescriptorSets(device, &allocInfo, pyramidSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate depth pyramid descriptor sets!");
+    }
+
+    // Level 0 reduces the depth image, every other level the level above it
+    for (uint32_t level = 0; level < pyramidLevels; level++)
+    {
+        VkDescriptorImageInfo sourceInfo{};
+        sourceInfo.sampler = pyramidSampler;
+        sourceInfo.imageView = level == 0 ? depthView : pyramidLevelViews[level - 1];
+        sourceInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo destinationInfo{};
+        destinationInfo.imageView = pyramidLevelViews[level];
+        destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        std::array<VkWriteDescriptorSet, 2> writes = {imageWrite(pyramidSets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &sourceInfo),
+                                                      imageWrite(pyramidSets[level], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &destinationInfo)};
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    // Frames in flight may still be bound to the cull sets, recordCull() rewrites each once its frame comes around
+    cullSetsStale.assign(cullSets.size(), true);
+
+    pyramidUndefined = true;
+    pyramidBuilt = false;
+}
+
+void VulkanGpuCulling::destroyPyramid(const RetireFunction &retire)
+{
+    if (pyramid == VK_NULL_HANDLE)
+        return;
+
+    VkDevice device = this->device;
+    VulkanMemoryAllocator *allocator = this->allocator;
+    VkDescriptorPool descriptorPool = pyramidDescriptorPool;
+    std::vector<VkImageView> views = pyramidLevelViews;
+    views.push_back(pyramidView);
+    VkImage image = pyramid;
+    VulkanAllocation allocation = pyramidAllocation;
+
+    auto destroy = [device, allocator, descriptorPool, views, image, allocation]() mutable
+    {
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        for (VkImageView view : views)
+            vkDestroyImageView(device, view, nullptr);
+        allocator->destroyImage(image, allocation);
+    };
+
+    if (retire)
+        retire(destroy);
+    else
+        destroy();
+
+    pyramidDescriptorPool = VK_NULL_HANDLE;
+    pyramidSets.clear();
+    pyramidLevelViews.clear();
+    pyramidView = VK_NULL_HANDLE;
+    pyramid = VK_NULL_HANDLE;
+}
+
+void VulkanGpuCulling::setView(uint32_t frame, const float viewProjection[16])
+{
+    CullUniforms uniforms{};
+    std::memcpy(uniforms.viewProjection, viewProjection, sizeof(uniforms.viewProjection));
+
+    // Planes from the rows of the column major matrix, clip space depth is [0, 1]
+    auto row = [viewProjection](int i, int component)
+    { return viewProjection[component * 4 + i]; };
+    for (int component = 0; component < 4; component++)
+    {
+        uniforms.frustumPlanes[0][component] = row(3, component) + row(0, component);
+        uniforms.frustumPlanes[1][component] = row(3, component) - row(0, component);
+        uniforms.frustumPlanes[2][component] = row(3, component) + row(1, component);
+        uniforms.frustumPlanes[3][component] = row(3, component) - row(1, component);
+        uniforms.frustumPlanes[4][component] = row(2, component);
+        uniforms.frustumPlanes[5][component] = row(3, component) - row(2, component);
+    }
+    for (float *plane : uniforms.frustumPlanes)
+    {
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for (int component = 0; component < 4; component++)
+            plane[component] /= length;
+    }
+
+    uniforms.objectCount = inputs.objectCount;
+    uniforms.occlusionEnabled = pyramidBuilt ? 1 : 0;
+    uniforms.compact = compact ? 1 : 0;
+    uniforms.pyramidLevels = pyramidLevels;
+    uniforms.pyramidWidth = static_cast<float>(pyramidWidth);
+    uniforms.pyramidHeight = static_cast<float>(pyramidHeight);
+
+    std::memcpy(uniformAllocations[frame].mapped, &uniforms, sizeof(uniforms));
+}
+
+void VulkanGpuCulling::recordCull(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+    if (cullSetsStale[frame])
+    {
+        VkDescriptorImageInfo pyramidInfo{};
+        pyramidInfo.sampler = pyramidSampler;
+        pyramidInfo.imageView = pyramidView;
+        pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet write = imageWrite(cullSets[frame], 6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &pyramidInfo);
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        cullSetsStale[frame] = false;
+    }
+
+    // The previous frame's indirect reads and pyramid writes have to be done before the outputs are rewritten and the pyramid is read
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    // Until the first build the pyramid only needs a layout the cull set can be bound with
+    VkImageMemoryBarrier pyramidBarrier{};
+    pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    pyramidBarrier.srcAccessMask = 0;
+    pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.image = pyramid;
+    pyramidBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramidLevels, 0, 1};
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, pyramidUndefined ? 1 : 0,
+                         &pyramidBarrier);
+    pyramidUndefined = false;
+
+    if (compact)
+    {
+        vkCmdFillBuffer(commandBuffer, drawCountBuffer, 0, sizeof(uint32_t), 0);
+
+        VkBufferMemoryBarrier countBarrier{};
+        countBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        countBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        countBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        countBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        countBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        countBarrier.buffer = drawCountBuffer;
+        countBarrier.offset = 0;
+        countBarrier.size = VK_WHOLE_SIZE;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &countBarrier, 0, nullptr);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullSets[frame], 0, nullptr);
+    vkCmdDispatch(commandBuffer, (inputs.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier outputBarrier{};
+    outputBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    outputBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    outputBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &outputBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanGpuCulling::recordDepthPyramid(VkCommandBuffer commandBuffer)
+{
+    // The whole pyramid is rewritten, its old contents only had to outlive this frame's cull
+    VkImageMemoryBarrier pyramidBarrier{};
+    pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    pyramidBarrier.srcAccessMask = 0;
+    pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.image = pyramid;
+    pyramidBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramidLevels, 0, 1};
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &pyramidBarrier);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidPipeline);
+
+    uint32_t sourceWidth = depthWidth;
+    uint32_t sourceHeight = depthHeight;
+    for (uint32_t level = 0; level < pyramidLevels; level++)
+    {
+        uint32_t width = std::max(1u, pyramidWidth >> level);
+        uint32_t height = std::max(1u, pyramidHeight >> level);
+
+        PyramidSizes sizes{};
+        sizes.sourceWidth = static_cast<int32_t>(sourceWidth);
+        sizes.sourceHeight = static_cast<int32_t>(sourceHeight);
+        sizes.destinationWidth = static_cast<int32_t>(width);
+        sizes.destinationHeight = static_cast<int32_t>(height);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidPipelineLayout, 0, 1, &pyramidSets[level], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(sizes), &sizes);
+        vkCmdDispatch(commandBuffer, (width + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, (height + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, 1);
+
+        VkImageMemoryBarrier levelBarrier{};
+        levelBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        levelBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        levelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        levelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        levelBarrier.image = pyramid;
+        levelBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+
+        sourceWidth = width;
+        sourceHeight = height;
+    }
+
+    pyramidBuilt = true;
+}
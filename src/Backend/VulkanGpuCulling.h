@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "VulkanFrameScheduler.h"
+#include "VulkanMemoryAllocator.h"
+
+/** @brief Buffers the cull pass reads, all of them indexed by object through each command's firstInstance */
+struct CullingInputs
+{
+    /** @brief One mat4 model matrix per object, std430 */
+    VkBuffer objectBuffer = VK_NULL_HANDLE;
+    /** @brief One vec4 per object, the bounding sphere centre in xyz and its radius in w, in model space */
+    VkBuffer boundsBuffer = VK_NULL_HANDLE;
+    /** @brief One VkDrawIndexedIndirectCommand per object */
+    VkBuffer drawCommandBuffer = VK_NULL_HANDLE;
+    uint32_t objectCount = 0;
+};
+
+/**
+ * @brief Compute pass that culls indirect draws against the view frustum and a depth pyramid of the previous frame
+ *
+ * recordCull() writes the surviving commands to its own command buffer. When compacting, they are
+ * packed to the front and counted for vkCmdDrawIndexedIndirectCount. Otherwise culled commands keep
+ * their slot with an instance count of 0. recordDepthPyramid() reduces the depth image to a mip chain
+ * of farthest depths once the frame's geometry is drawn. The next frame's cull tests object bounds
+ * against it with the current matrices. An object that only becomes visible because of this frame's
+ * motion can therefore appear one frame late. Occlusion is skipped until the first pyramid exists.
+ *
+ * Everything is recorded on the graphics queue, so a single pyramid and output buffer are enough: a
+ * frame's cull is ordered after the previous frame's indirect reads and pyramid writes by its barriers.
+ */
+class VulkanGpuCulling
+{
+public:
+    /**
+     * @param cullShader Module of cull.comp, not kept
+     * @param pyramidShader Module of depthpyramid.comp, not kept
+     * @param compact Pack surviving commands and count them, needs drawIndirectCount to consume
+     */
+    void create(VkDevice device, VulkanMemoryAllocator &allocator, uint32_t framesInFlight, const CullingInputs &inputs, VkShaderModule cullShader,
+                VkShaderModule pyramidShader, bool compact);
+    /** @brief The device must be idle */
+    void destroy();
+
+    /**
+     * @brief Rebuilds the pyramid for a new depth image
+     *
+     * The image has to be created with sampled usage. Occlusion is disabled until the pyramid has been built again.
+     * The old pyramid is handed to retire, without one the device must be done with it. Each frame's cull set
+     * is pointed at the new pyramid the next time that frame is culled, when it is no longer in flight.
+     */
+    void setDepthImage(VkImageView depthView, uint32_t width, uint32_t height, const RetireFunction &retire = nullptr);
+
+    /** @brief Column major view projection, applied after each object's model matrix, written into frame's uniforms */
+    void setView(uint32_t frame, const float viewProjection[16]);
+
+    /** @brief Outside a render pass: culls into the output buffers and makes them readable as indirect commands */
+    void recordCull(VkCommandBuffer commandBuffer, uint32_t frame);
+    /** @brief Rebuilds the pyramid, the depth image has to be in shader read only layout and visible to compute reads */
+    void recordDepthPyramid(VkCommandBuffer commandBuffer);
+
+    VkBuffer getDrawCommandBuffer() const { return outputCommandBuffer; }
+    /** @brief Number of surviving commands, only written when compacting */
+    VkBuffer getDrawCountBuffer() const { return drawCountBuffer; }
+    uint32_t getMaxDrawCount() const { return inputs.objectCount; }
+
+private:
+    /** @brief Matches CullUniforms in cull.comp, std140 */
+    struct CullUniforms
+    {
+        float viewProjection[16];
+        float frustumPlanes[6][4];
+        uint32_t objectCount;
+        uint32_t occlusionEnabled;
+        uint32_t compact;
+        uint32_t pyramidLevels;
+        float pyramidWidth;
+        float pyramidHeight;
+        float padding[2];
+    };
+
+    struct PyramidSizes
+    {
+        int32_t sourceWidth;
+        int32_t sourceHeight;
+        int32_t destinationWidth;
+        int32_t destinationHeight;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VulkanMemoryAllocator *allocator{nullptr};
+    CullingInputs inputs;
+    bool compact = false;
+
+    VkBuffer outputCommandBuffer = VK_NULL_HANDLE;
+    VulkanAllocation outputCommandAllocation;
+    VkBuffer drawCountBuffer = VK_NULL_HANDLE;
+    VulkanAllocation drawCountAllocation;
+    std::vector<VkBuffer> uniformBuffers;
+    std::vector<VulkanAllocation> uniformAllocations;
+
+    VkSampler pyramidSampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout pyramidSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pyramidPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline cullPipeline = VK_NULL_HANDLE;
+    VkPipeline pyramidPipeline = VK_NULL_HANDLE;
+    VkDescriptorPool cullDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorPool pyramidDescriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> cullSets;
+    /** @brief Cull sets that do not name the current pyramid yet */
+    std::vector<bool> cullSetsStale;
+    std::vector<VkDescriptorSet> pyramidSets;
+
+    uint32_t depthWidth = 0;
+    uint32_t depthHeight = 0;
+
+    VkImage pyramid = VK_NULL_HANDLE;
+    VulkanAllocation pyramidAllocation;
+    VkImageView pyramidView = VK_NULL_HANDLE;
+    std::vector<VkImageView> pyramidLevelViews;
+    uint32_t pyramidWidth = 0;
+    uint32_t pyramidHeight = 0;
+    uint32_t pyramidLevels = 0;
+    /** @brief The pyramid still has undefined contents and layout */
+    bool pyramidUndefined = true;
+    bool pyramidBuilt = false;
+
+    void createPipelines(VkShaderModule cullShader, VkShaderModule pyramidShader);
+    void createBuffers(uint32_t framesInFlight);
+    void createCullSets(uint32_t framesInFlight);
+    void destroyPyramid(const RetireFunction &retire = nullptr);
+};
@@ -0,0 +1,321 @@
+#include "VulkanMemoryAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+    destroy();
+}
+
+void VulkanMemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize)
+{
+    this->physicalDevice = physicalDevice;
+    this->device = device;
+    this->preferredBlockSize = preferredBlockSize;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+    nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    pools.resize(memoryProperties.memoryTypeCount * 2);
+}
+
+void VulkanMemoryAllocator::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    for (auto &pool : pools)
+    {
+        for (auto &block : pool)
+            vkFreeMemory(device, block->memory, nullptr);
+        pool.clear();
+    }
+    pools.clear();
+    device = VK_NULL_HANDLE;
+}
+
+VulkanAllocation VulkanMemoryAllocator::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, AllocationKind kind, bool dedicated)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    VulkanAllocation allocation{};
+    uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+    // Anything that would take up a big share of a block is cheaper to give its own allocation
+    if (!dedicated && requirements.size > getBlockSize(memoryTypeIndex) / 2)
+        dedicated = true;
+
+    if (!dedicated && allocateFromPool(requirements, memoryTypeIndex, kind, allocation))
+        return allocation;
+
+    if (allocateDedicated(requirements.size, memoryTypeIndex, allocation))
+        return allocation;
+
+    throw std::runtime_error("failed to allocate device memory!");
+}
+
+void VulkanMemoryAllocator::free(VulkanAllocation &allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (allocation.block == nullptr)
+    {
+        vkFreeMemory(device, allocation.memory, nullptr);
+        dedicatedAllocationCount--;
+        dedicatedBytes -= allocation.size;
+        allocation = VulkanAllocation{};
+        return;
+    }
+
+    VulkanMemoryBlock *block = allocation.block;
+    block->allocator.free(allocation.handle);
+
+    // Keep a single empty block around per pool so churn at a block boundary does not hit the driver every time
+    if (block->allocator.isEmpty())
+    {
+        for (auto &pool : pools)
+        {
+            auto it = std::find_if(pool.begin(), pool.end(), [block](const std::unique_ptr<VulkanMemoryBlock> &b) { return b.get() == block; });
+            if (it == pool.end())
+                continue;
+
+            bool otherEmpty = std::any_of(pool.begin(), pool.end(), [block](const std::unique_ptr<VulkanMemoryBlock> &b) { return b.get() != block && b->allocator.isEmpty(); });
+            if (otherEmpty)
+            {
+                vkFreeMemory(device, block->memory, nullptr);
+                pool.erase(it);
+            }
+            break;
+        }
+    }
+
+    allocation = VulkanAllocation{};
+}
+
+void VulkanMemoryAllocator::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VulkanAllocation &allocation)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+    allocation = allocate(memRequirements, properties, AllocationKind::Buffer);
+    vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+}
+
+void VulkanMemoryAllocator::createImage(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image, VulkanAllocation &allocation)
+{
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+    // Drivers can apply compression and other tricks to render targets that only work with their own allocation
+    bool renderTarget = (imageInfo.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) != 0;
+    AllocationKind kind = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? AllocationKind::OptimalImage : AllocationKind::LinearImage;
+
+    allocation = allocate(memRequirements, properties, kind, renderTarget);
+    vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+}
+
+void VulkanMemoryAllocator::destroyBuffer(VkBuffer buffer, VulkanAllocation &allocation)
+{
+    vkDestroyBuffer(device, buffer, nullptr);
+    free(allocation);
+}
+
+void VulkanMemoryAllocator::destroyImage(VkImage image, VulkanAllocation &allocation)
+{
+    vkDestroyImage(device, image, nullptr);
+    free(allocation);
+}
+
+uint32_t VulkanMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VulkanMemoryAllocator::Statistics VulkanMemoryAllocator::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Statistics stats{};
+    stats.dedicatedAllocationCount = dedicatedAllocationCount;
+    stats.allocationCount = dedicatedAllocationCount;
+    stats.bytesReserved = dedicatedBytes;
+    stats.bytesUsed = dedicatedBytes;
+    for (const auto &pool : pools)
+    {
+        for (const auto &block : pool)
+        {
+            TlsfAllocator::Statistics blockStats = block->allocator.getStatistics();
+            stats.blockCount++;
+            stats.allocationCount += blockStats.allocationCount;
+            stats.freeRegionCount += blockStats.freeRegionCount;
+            stats.bytesReserved += blockStats.size;
+            stats.bytesUsed += blockStats.used;
+            stats.largestFreeRegion = std::max(stats.largestFreeRegion, blockStats.largestFreeRegion);
+        }
+    }
+    return stats;
+}
+
+uint32_t VulkanMemoryAllocator::getPoolIndex(uint32_t memoryTypeIndex, AllocationKind kind) const
+{
+    // Linear and optimal resources only need to be kept apart when they could alias within a granularity page
+    bool separate = bufferImageGranularity > 1 && kind == AllocationKind::OptimalImage;
+    return memoryTypeIndex * 2 + (separate ? 1 : 0);
+}
+
+VkDeviceSize VulkanMemoryAllocator::getBlockSize(uint32_t memoryTypeIndex) const
+{
+    uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    VkDeviceSize heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+    const VkDeviceSize smallHeapSize = 1024ull * 1024 * 1024;
+
+    return heapSize <= smallHeapSize ? heapSize / 8 : preferredBlockSize;
+}
+
+VkResult VulkanMemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, VkDeviceMemory &memory, void *&mapped)
+{
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+    if (result != VK_SUCCESS)
+        return result;
+
+    // Host visible memory stays mapped for its whole lifetime, a block can only be mapped once anyway
+    mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        result = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        if (result != VK_SUCCESS)
+        {
+            vkFreeMemory(device, memory, nullptr);
+            memory = VK_NULL_HANDLE;
+        }
+    }
+
+    return result;
+}
+
+bool VulkanMemoryAllocator::allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex, VulkanAllocation &allocation)
+{
+    VkDeviceMemory memory;
+    void *mapped;
+    if (allocateDeviceMemory(size, memoryTypeIndex, memory, mapped) != VK_SUCCESS)
+        return false;
+
+    allocation.memory = memory;
+    allocation.offset = 0;
+    allocation.size = size;
+    allocation.mapped = mapped;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.block = nullptr;
+    allocation.handle = TlsfAllocator::INVALID_HANDLE;
+
+    dedicatedAllocationCount++;
+    dedicatedBytes += size;
+    return true;
+}
+
+bool VulkanMemoryAllocator::allocateFromPool(const VkMemoryRequirements &requirements, uint32_t memoryTypeIndex, AllocationKind kind, VulkanAllocation &allocation)
+{
+    VkDeviceSize size = requirements.size;
+    VkDeviceSize alignment = requirements.alignment;
+
+    // Flushes of non coherent memory work on nonCoherentAtomSize granules, keep neighbours out of ours
+    VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+    {
+        alignment = std::max(alignment, nonCoherentAtomSize);
+        size = (size + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize;
+    }
+
+    auto &pool = pools[getPoolIndex(memoryTypeIndex, kind)];
+    for (auto &block : pool)
+    {
+        VkDeviceSize offset;
+        uint32_t handle = block->allocator.allocate(size, alignment, offset);
+        if (handle == TlsfAllocator::INVALID_HANDLE)
+            continue;
+
+        allocation.memory = block->memory;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mapped = block->mapped ? static_cast<char *>(block->mapped) + offset : nullptr;
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.block = block.get();
+        allocation.handle = handle;
+        return true;
+    }
+
+    // Start with small blocks and double up to the preferred size, so small scenes do not reserve a full block
+    VkDeviceSize maxBlockSize = getBlockSize(memoryTypeIndex);
+    VkDeviceSize largestBlock = 0;
+    for (auto &block : pool)
+        largestBlock = std::max(largestBlock, block->allocator.getSize());
+
+    VkDeviceSize blockSize = std::min(maxBlockSize, std::max(maxBlockSize / 8, largestBlock * 2));
+    blockSize = std::max(blockSize, size + alignment);
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void *mapped = nullptr;
+    while (allocateDeviceMemory(blockSize, memoryTypeIndex, memory, mapped) != VK_SUCCESS)
+    {
+        // Out of memory for a full block, retry with smaller ones before giving up on the pool
+        if (blockSize / 2 < size + alignment)
+            return false;
+        blockSize /= 2;
+    }
+
+    auto block = std::make_unique<VulkanMemoryBlock>();
+    block->memory = memory;
+    block->mapped = mapped;
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->allocator.reset(blockSize);
+
+    VkDeviceSize offset;
+    uint32_t handle = block->allocator.allocate(size, alignment, offset);
+
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.mapped = block->mapped ? static_cast<char *>(block->mapped) + offset : nullptr;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.block = block.get();
+    allocation.handle = handle;
+
+    pool.push_back(std::move(block));
+    return true;
+}
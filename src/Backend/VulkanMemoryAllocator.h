@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+/** @brief Kind of resource an allocation is bound to, needed to honour bufferImageGranularity */
+enum class AllocationKind
+{
+    Buffer,
+    LinearImage,
+    OptimalImage
+};
+
+struct VulkanMemoryBlock;
+
+/** @brief A range of device memory handed out by the VulkanMemoryAllocator */
+struct VulkanAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    /** @brief Host pointer to the start of the allocation if the memory type is host visible, persistently mapped */
+    void *mapped = nullptr;
+    uint32_t memoryTypeIndex = 0;
+
+    /** @brief Owning block, null for dedicated allocations */
+    VulkanMemoryBlock *block = nullptr;
+    uint32_t handle = TlsfAllocator::INVALID_HANDLE;
+};
+
+/** @brief One vkAllocateMemory worth of device memory, sub-allocated with TLSF */
+struct VulkanMemoryBlock
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void *mapped = nullptr;
+    uint32_t memoryTypeIndex = 0;
+    TlsfAllocator allocator;
+};
+
+/**
+ * @brief Device memory allocator that sub-allocates resources out of large per memory type blocks
+ *
+ * Keeps the number of live vkAllocateMemory calls far below maxMemoryAllocationCount. Large resources
+ * and render targets get dedicated allocations, everything else is placed in TLSF managed blocks.
+ */
+class VulkanMemoryAllocator
+{
+public:
+    /** @brief Allocator wide statistics, used by the benchmark and for fragmentation reports */
+    struct Statistics
+    {
+        uint32_t blockCount = 0;
+        uint32_t dedicatedAllocationCount = 0;
+        uint32_t allocationCount = 0;
+        uint32_t freeRegionCount = 0;
+        VkDeviceSize bytesReserved = 0;
+        VkDeviceSize bytesUsed = 0;
+        VkDeviceSize largestFreeRegion = 0;
+    };
+
+    /** @brief Default size of a block, smaller heaps use an eighth of the heap instead */
+    static const VkDeviceSize DEFAULT_BLOCK_SIZE = 256ull * 1024 * 1024;
+
+    VulkanMemoryAllocator() = default;
+    ~VulkanMemoryAllocator();
+
+    VulkanMemoryAllocator(const VulkanMemoryAllocator &other) = delete;
+    VulkanMemoryAllocator &operator=(const VulkanMemoryAllocator &other) = delete;
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE);
+    void destroy();
+
+    VulkanAllocation allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, AllocationKind kind, bool dedicated = false);
+    void free(VulkanAllocation &allocation);
+
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VulkanAllocation &allocation);
+    void createImage(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image, VulkanAllocation &allocation);
+    void destroyBuffer(VkBuffer buffer, VulkanAllocation &allocation);
+    void destroyImage(VkImage image, VulkanAllocation &allocation);
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    Statistics getStatistics();
+
+private:
+    VkPhysicalDevice physicalDevice{VK_NULL_HANDLE};
+    VkDevice device{VK_NULL_HANDLE};
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize bufferImageGranularity = 1;
+    VkDeviceSize nonCoherentAtomSize = 1;
+    VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE;
+
+    /** @brief Block lists indexed by memory type, split in linear/optimal halves when bufferImageGranularity requires it */
+    std::vector<std::vector<std::unique_ptr<VulkanMemoryBlock>>> pools;
+    uint32_t dedicatedAllocationCount = 0;
+    VkDeviceSize dedicatedBytes = 0;
+    std::mutex mutex;
+
+    uint32_t getPoolIndex(uint32_t memoryTypeIndex, AllocationKind kind) const;
+    VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+    VkResult allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, VkDeviceMemory &memory, void *&mapped);
+    bool allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex, VulkanAllocation &allocation);
+    bool allocateFromPool(const VkMemoryRequirements &requirements, uint32_t memoryTypeIndex, AllocationKind kind, VulkanAllocation &allocation);
+};
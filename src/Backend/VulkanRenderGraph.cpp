@@ -0,0 +1,399 @@
+#include "VulkanRenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void VulkanRenderGraph::create(VkDevice device, VulkanMemoryAllocator &allocator, VulkanResourceStateTracker &stateTracker)
+{
+    this->device = device;
+    this->allocator = &allocator;
+    this->stateTracker = &stateTracker;
+}
+
+void VulkanRenderGraph::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    reset();
+    device = VK_NULL_HANDLE;
+    allocator = nullptr;
+    stateTracker = nullptr;
+}
+
+void VulkanRenderGraph::reset(const RetireFunction &retire)
+{
+    destroyTransients(retire);
+    resources.clear();
+    passes.clear();
+    statistics = Statistics{};
+}
+
+ResourceUsage VulkanRenderGraph::getResourceUsage(RenderGraphUsage usage)
+{
+    switch (usage)
+    {
+    case RenderGraphUsage::ColorAttachment:
+        return ResourceUsage::ColorAttachment;
+    case RenderGraphUsage::DepthAttachment:
+        return ResourceUsage::DepthAttachment;
+    case RenderGraphUsage::SampledFragment:
+        return ResourceUsage::SampledFragment;
+    case RenderGraphUsage::SampledCompute:
+        return ResourceUsage::SampledCompute;
+    case RenderGraphUsage::StorageCompute:
+        return ResourceUsage::StorageCompute;
+    case RenderGraphUsage::TransferSource:
+        return ResourceUsage::CopySource;
+    case RenderGraphUsage::TransferDestination:
+        return ResourceUsage::CopyDestination;
+    }
+    throw std::runtime_error("unknown render graph usage!");
+}
+
+VkImageUsageFlags VulkanRenderGraph::getImageUsage(RenderGraphUsage usage)
+{
+    switch (usage)
+    {
+    case RenderGraphUsage::ColorAttachment:
+        return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    case RenderGraphUsage::DepthAttachment:
+        return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    case RenderGraphUsage::SampledFragment:
+    case RenderGraphUsage::SampledCompute:
+        return VK_IMAGE_USAGE_SAMPLED_BIT;
+    case RenderGraphUsage::StorageCompute:
+        return VK_IMAGE_USAGE_STORAGE_BIT;
+    case RenderGraphUsage::TransferSource:
+        return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    case RenderGraphUsage::TransferDestination:
+        return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+    throw std::runtime_error("unknown render graph usage!");
+}
+
+RenderGraphResource VulkanRenderGraph::importImage(const std::string &name, const RenderGraphImportedImage &image)
+{
+    Resource resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.import = image;
+    resource.image = image.image;
+    resource.view = image.view;
+    resource.aspect = image.aspect;
+    resources.push_back(resource);
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+void VulkanRenderGraph::setImportedImage(RenderGraphResource resource, VkImage image, VkImageView view)
+{
+    resources[resource].image = image;
+    resources[resource].view = view;
+}
+
+RenderGraphResource VulkanRenderGraph::createImage(const std::string &name, const RenderGraphImageDesc &desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.aspect = desc.aspect;
+    resources.push_back(resource);
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphPass VulkanRenderGraph::addPass(const std::string &name, std::function<void(VkCommandBuffer)> execute)
+{
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+    return static_cast<RenderGraphPass>(passes.size() - 1);
+}
+
+void VulkanRenderGraph::use(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage)
+{
+    passes[pass].uses.push_back({resource, usage});
+}
+
+void VulkanRenderGraph::setSideEffects(RenderGraphPass pass)
+{
+    passes[pass].sideEffects = true;
+}
+
+void VulkanRenderGraph::compile()
+{
+    destroyTransients();
+
+    cullPasses();
+    createTransients();
+
+    statistics.passCount = static_cast<uint32_t>(passes.size());
+    statistics.culledPassCount = static_cast<uint32_t>(std::count_if(passes.begin(), passes.end(), [](const Pass &pass)
+                                                                     { return pass.culled; }));
+}
+
+void VulkanRenderGraph::cullPasses()
+{
+    // Walking backwards, a pass is needed once a needed pass after it uses one of its outputs
+    std::vector<bool> needed(resources.size(), false);
+    for (size_t i = 0; i < resources.size(); i++)
+        needed[i] = resources[i].imported;
+
+    for (size_t i = passes.size(); i-- > 0;)
+    {
+        Pass &pass = passes[i];
+        bool alive = pass.sideEffects;
+        for (const PassUse &use : pass.uses)
+            alive = alive || (isWriteUsage(getResourceUsage(use.usage)) && needed[use.resource]);
+
+        pass.culled = !alive;
+        if (pass.culled)
+            continue;
+
+        // Writes keep earlier writers too, a pass may rely on what was there before
+        for (const PassUse &use : pass.uses)
+            needed[use.resource] = true;
+    }
+}
+
+void VulkanRenderGraph::createTransients()
+{
+    statistics.transientBytes = 0;
+    statistics.unaliasedBytes = 0;
+
+    for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++)
+    {
+        const Pass &pass = passes[passIndex];
+        if (pass.culled)
+            continue;
+
+        for (const PassUse &use : pass.uses)
+        {
+            Resource &resource = resources[use.resource];
+            if (resource.firstPass == INVALID)
+                resource.firstPass = passIndex;
+            resource.lastPass = passIndex;
+            resource.usage |= getImageUsage(use.usage);
+        }
+    }
+
+    std::vector<RenderGraphResource> transients;
+    for (uint32_t i = 0; i < resources.size(); i++)
+    {
+        Resource &resource = resources[i];
+        if (resource.imported || resource.firstPass == INVALID)
+            continue;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = resource.desc.format;
+        imageInfo.extent = {resource.desc.extent.width, resource.desc.extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = resource.usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create render graph image!");
+        }
+        vkGetImageMemoryRequirements(device, resource.image, &resource.requirements);
+        transients.push_back(i);
+    }
+
+    // Largest first, each goes into the first block it fits in without overlapping the lifetime of anything there
+    std::sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b)
+              { return resources[a].requirements.size > resources[b].requirements.size; });
+
+    for (RenderGraphResource index : transients)
+    {
+        Resource &resource = resources[index];
+        for (uint32_t blockIndex = 0; blockIndex < blocks.size() && resource.block == INVALID; blockIndex++)
+        {
+            MemoryBlock &block = blocks[blockIndex];
+            if ((block.requirements.memoryTypeBits & resource.requirements.memoryTypeBits) == 0)
+                continue;
+
+            bool overlaps = std::any_of(block.resources.begin(), block.resources.end(), [&](RenderGraphResource other)
+                                        { return resources[other].firstPass <= resource.lastPass && resource.firstPass <= resources[other].lastPass; });
+            if (overlaps)
+                continue;
+
+            block.requirements.size = std::max(block.requirements.size, resource.requirements.size);
+            block.requirements.alignment = std::max(block.requirements.alignment, resource.requirements.alignment);
+            block.requirements.memoryTypeBits &= resource.requirements.memoryTypeBits;
+            block.resources.push_back(index);
+            resource.block = blockIndex;
+        }
+
+        if (resource.block == INVALID)
+        {
+            MemoryBlock block;
+            block.requirements = resource.requirements;
+            block.resources.push_back(index);
+            blocks.push_back(block);
+            resource.block = static_cast<uint32_t>(blocks.size() - 1);
+        }
+        statistics.unaliasedBytes += resource.requirements.size;
+    }
+
+    for (MemoryBlock &block : blocks)
+    {
+        block.allocation = allocator->allocate(block.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::OptimalImage, true);
+        statistics.transientBytes += block.allocation.size;
+
+        for (RenderGraphResource index : block.resources)
+        {
+            Resource &resource = resources[index];
+            vkBindImageMemory(device, resource.image, block.allocation.memory, block.allocation.offset);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = resource.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.desc.format;
+            // A view that is sampled may only name one of depth and stencil
+            viewInfo.subresourceRange.aspectMask = (resource.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? static_cast<VkImageAspectFlags>(VK_IMAGE_ASPECT_DEPTH_BIT) : resource.aspect;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create render graph image view!");
+            }
+        }
+    }
+
+    statistics.transientImageCount = static_cast<uint32_t>(transients.size());
+    statistics.memoryBlockCount = static_cast<uint32_t>(blocks.size());
+}
+
+void VulkanRenderGraph::destroyTransients(const RetireFunction &retire)
+{
+    std::vector<VkImageView> views;
+    std::vector<VkImage> images;
+    std::vector<VulkanAllocation> allocations;
+
+    for (Resource &resource : resources)
+    {
+        if (resource.imported)
+            continue;
+
+        if (resource.view != VK_NULL_HANDLE)
+            views.push_back(resource.view);
+        if (resource.image != VK_NULL_HANDLE)
+            images.push_back(resource.image);
+        resource.view = VK_NULL_HANDLE;
+        resource.image = VK_NULL_HANDLE;
+        resource.firstPass = INVALID;
+        resource.lastPass = INVALID;
+        resource.usage = 0;
+        resource.block = INVALID;
+    }
+
+    for (MemoryBlock &block : blocks)
+        allocations.push_back(block.allocation);
+    blocks.clear();
+
+    VkDevice device = this->device;
+    VulkanMemoryAllocator *allocator = this->allocator;
+    auto destroy = [device, allocator, views, images, allocations]()
+    {
+        for (VkImageView view : views)
+            vkDestroyImageView(device, view, nullptr);
+        for (VkImage image : images)
+            vkDestroyImage(device, image, nullptr);
+        for (VulkanAllocation allocation : allocations)
+            allocator->free(allocation);
+    };
+
+    if (retire && !(views.empty() && images.empty() && allocations.empty()))
+        retire(destroy);
+    else
+        destroy();
+}
+
+void VulkanRenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+    VulkanResourceStateTracker::Statistics before = stateTracker->getStatistics();
+
+    for (Resource &resource : resources)
+        resource.started = false;
+
+    for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++)
+    {
+        Pass &pass = passes[passIndex];
+        if (pass.culled)
+            continue;
+
+        for (const PassUse &use : pass.uses)
+        {
+            Resource &resource = resources[use.resource];
+            if (!resource.started)
+            {
+                ResourceState initial;
+                if (resource.imported)
+                {
+                    initial.stages = resource.import.initialStages;
+                    initial.layout = resource.import.initialLayout;
+                }
+                else
+                {
+                    // The contents are discarded, but the previous image in the memory has to be done with it
+                    const MemoryBlock &block = blocks[resource.block];
+                    initial.stages = block.lastStages;
+                    initial.access = block.lastWriteAccess;
+                }
+                stateTracker->trackImage(resource.image, resource.aspect, 1, 1, initial);
+                resource.started = true;
+            }
+            stateTracker->useImage(resource.image, getResourceUsage(use.usage));
+        }
+        stateTracker->flush(commandBuffer);
+
+        pass.execute(commandBuffer);
+
+        for (const PassUse &use : pass.uses)
+        {
+            Resource &resource = resources[use.resource];
+            if (resource.imported)
+                continue;
+
+            ResourceState last = stateTracker->getImageState(resource.image, 0, 0);
+            MemoryBlock &block = blocks[resource.block];
+            block.lastStages = last.stages;
+            block.lastWriteAccess = last.access;
+        }
+    }
+
+    // Hand imported images back in the layout their owner expects, nothing in this submission uses them afterwards
+    for (Resource &resource : resources)
+    {
+        if (!resource.started)
+            continue;
+
+        if (resource.imported && resource.import.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED &&
+            stateTracker->getImageState(resource.image, 0, 0).layout != resource.import.finalLayout)
+        {
+            ResourceState final;
+            final.layout = resource.import.finalLayout;
+            stateTracker->useImage(resource.image, {resource.aspect, 0, 1, 0, 1}, final, false);
+        }
+    }
+    stateTracker->flush(commandBuffer);
+
+    for (Resource &resource : resources)
+    {
+        if (resource.started)
+            stateTracker->forgetImage(resource.image);
+    }
+
+    const VulkanResourceStateTracker::Statistics &after = stateTracker->getStatistics();
+    statistics.barrierBatches = after.batches - before.batches;
+    statistics.imageBarriers = after.imageBarriers - before.imageBarriers;
+    statistics.overSynchronization = after.overSynchronization - before.overSynchronization;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "VulkanFrameScheduler.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanResourceStateTracker.h"
+
+typedef uint32_t RenderGraphResource;
+typedef uint32_t RenderGraphPass;
+
+/** @brief How a pass uses an image, implies whether it reads or writes it and the layout it needs */
+enum class RenderGraphUsage
+{
+    ColorAttachment,
+    /** @brief Depth test and write */
+    DepthAttachment,
+    SampledFragment,
+    SampledCompute,
+    /** @brief Read and written as a storage image in a compute shader */
+    StorageCompute,
+    TransferSource,
+    TransferDestination
+};
+
+/** @brief Image owned by the graph, created at compile() and only valid while the graph executes */
+struct RenderGraphImageDesc
+{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = {0, 0};
+    /** @brief Aspects the barriers cover, the view leaves out stencil so depth can be sampled */
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+};
+
+/** @brief Image owned outside the graph, such as a swapchain image */
+struct RenderGraphImportedImage
+{
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    /** @brief Layout at the start of execute(), UNDEFINED discards the contents */
+    VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    /** @brief Stages the last use before execute() happens in, or a semaphore wait covers */
+    VkPipelineStageFlags2 initialStages = VK_PIPELINE_STAGE_2_NONE;
+    /** @brief Layout the image is left in, UNDEFINED leaves it in the last pass's layout */
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+/**
+ * @brief Frame described as passes that declare the images they use, synchronized and allocated by the graph
+ *
+ * Passes execute in the order they were added. compile() then works out three things:
+ *  - Culling. A pass survives if it has side effects, writes an imported image, or writes an image
+ *    that a surviving later pass uses. Culled passes are never executed and their usages are ignored.
+ *  - Lifetimes. A transient image lives from the first to the last surviving pass that uses it.
+ *  - Aliasing. Transients whose lifetimes do not overlap share one memory allocation.
+ *
+ * execute() moves each pass's images through the state tracker and flushes their barriers as one batch
+ * before the pass, so only the barriers the usages actually need are recorded. The first use of a
+ * transient waits for the previous image in its memory, including the one from the previous execute(),
+ * and discards the contents.
+ *
+ * Passes that render begin their render pass themselves. Its attachments must keep the layouts of their
+ * usages for initial and final layout, the graph does the transitions. Buffers and anything a pass does
+ * internally are synchronized by the pass.
+ */
+class VulkanRenderGraph
+{
+public:
+    static const uint32_t INVALID = UINT32_MAX;
+
+    struct Statistics
+    {
+        uint32_t passCount = 0;
+        uint32_t culledPassCount = 0;
+        uint32_t transientImageCount = 0;
+        uint32_t memoryBlockCount = 0;
+        /** @brief Memory of the transients with and without aliasing */
+        VkDeviceSize transientBytes = 0;
+        VkDeviceSize unaliasedBytes = 0;
+        /** @brief Of the last execute() */
+        uint32_t barrierBatches = 0;
+        uint32_t imageBarriers = 0;
+        uint32_t overSynchronization = 0;
+    };
+
+    /** @param stateTracker Records the barriers, images are only tracked while execute() runs */
+    void create(VkDevice device, VulkanMemoryAllocator &allocator, VulkanResourceStateTracker &stateTracker);
+    /** @brief The device must be done with the transients */
+    void destroy();
+    /**
+     * @brief Drops every pass and resource, transients included
+     *
+     * The transients are handed to retire while frames in flight may still use them, without one the device
+     * must be done with them.
+     */
+    void reset(const RetireFunction &retire = nullptr);
+
+    RenderGraphResource importImage(const std::string &name, const RenderGraphImportedImage &image);
+    /** @brief Swaps the image behind an import between executions, such as the acquired swapchain image */
+    void setImportedImage(RenderGraphResource resource, VkImage image, VkImageView view);
+    RenderGraphResource createImage(const std::string &name, const RenderGraphImageDesc &desc);
+
+    RenderGraphPass addPass(const std::string &name, std::function<void(VkCommandBuffer)> execute);
+    void use(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage);
+    /** @brief Keeps the pass even if nothing in the graph uses what it writes */
+    void setSideEffects(RenderGraphPass pass);
+
+    /** @brief Culls passes and creates the transients, call once the graph is complete */
+    void compile();
+    void execute(VkCommandBuffer commandBuffer);
+
+    /** @brief Transients are created by compile() */
+    VkImage getImage(RenderGraphResource resource) const { return resources[resource].image; }
+    VkImageView getImageView(RenderGraphResource resource) const { return resources[resource].view; }
+    bool isCulled(RenderGraphPass pass) const { return passes[pass].culled; }
+    const Statistics &getStatistics() const { return statistics; }
+
+private:
+    struct Resource
+    {
+        std::string name;
+        bool imported = false;
+        RenderGraphImageDesc desc;
+        RenderGraphImportedImage import;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkImageAspectFlags aspect = 0;
+
+        // Filled in by compile() for transients
+        uint32_t firstPass = INVALID;
+        uint32_t lastPass = INVALID;
+        VkImageUsageFlags usage = 0;
+        uint32_t block = INVALID;
+        VkMemoryRequirements requirements{};
+
+        /** @brief Whether execute() has started tracking the image yet */
+        bool started = false;
+    };
+
+    struct PassUse
+    {
+        RenderGraphResource resource;
+        RenderGraphUsage usage;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        std::function<void(VkCommandBuffer)> execute;
+        std::vector<PassUse> uses;
+        bool sideEffects = false;
+        bool culled = false;
+    };
+
+    /** @brief Memory shared by transients with disjoint lifetimes */
+    struct MemoryBlock
+    {
+        VkMemoryRequirements requirements{};
+        VulkanAllocation allocation;
+        std::vector<RenderGraphResource> resources;
+        /** @brief Accesses of the last image in the block, the next one's first use waits for them */
+        VkPipelineStageFlags2 lastStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 lastWriteAccess = VK_ACCESS_2_NONE;
+    };
+
+    VkDevice device{VK_NULL_HANDLE};
+    VulkanMemoryAllocator *allocator{nullptr};
+    VulkanResourceStateTracker *stateTracker{nullptr};
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<MemoryBlock> blocks;
+    Statistics statistics;
+
+    static ResourceUsage getResourceUsage(RenderGraphUsage usage);
+    static VkImageUsageFlags getImageUsage(RenderGraphUsage usage);
+
+    void cullPasses();
+    void createTransients();
+    void destroyTransients(const RetireFunction &retire = nullptr);
+};
@@ -0,0 +1,416 @@
+#include "VulkanResourceStateTracker.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+                                        VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+    // Synchronization2 keeps the legacy bits in the low 32 bits and only adds finer ones above them
+    VkPipelineStageFlags toLegacyStages(VkPipelineStageFlags2 stages, VkPipelineStageFlags none)
+    {
+        VkPipelineStageFlags legacy = static_cast<VkPipelineStageFlags>(stages & 0xFFFFFFFFull);
+        if (stages & (VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_RESOLVE_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT))
+            legacy |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+        if (stages & (VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT))
+            legacy |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        if (stages & VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT)
+            legacy |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT |
+                      VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT;
+        return legacy != 0 ? legacy : none;
+    }
+
+    VkAccessFlags toLegacyAccess(VkAccessFlags2 access)
+    {
+        VkAccessFlags legacy = static_cast<VkAccessFlags>(access & 0xFFFFFFFFull);
+        if (access & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT))
+            legacy |= VK_ACCESS_SHADER_READ_BIT;
+        if (access & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT)
+            legacy |= VK_ACCESS_SHADER_WRITE_BIT;
+        return legacy;
+    }
+}
+
+ResourceState getResourceState(ResourceUsage usage)
+{
+    ResourceState state;
+    switch (usage)
+    {
+    case ResourceUsage::ColorAttachment:
+        state.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        state.access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+        state.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        break;
+    case ResourceUsage::DepthAttachment:
+        state.stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        state.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        state.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        break;
+    case ResourceUsage::SampledFragment:
+        state.stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        state.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        break;
+    case ResourceUsage::SampledCompute:
+        state.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        state.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        break;
+    case ResourceUsage::StorageCompute:
+        state.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        state.access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        state.layout = VK_IMAGE_LAYOUT_GENERAL;
+        break;
+    case ResourceUsage::UniformVertex:
+        state.stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+        state.access = VK_ACCESS_2_UNIFORM_READ_BIT;
+        break;
+    case ResourceUsage::VertexBuffer:
+        state.stages = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT;
+        state.access = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+        break;
+    case ResourceUsage::IndexBuffer:
+        state.stages = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
+        state.access = VK_ACCESS_2_INDEX_READ_BIT;
+        break;
+    case ResourceUsage::IndirectBuffer:
+        state.stages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+        state.access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+        break;
+    case ResourceUsage::CopySource:
+        state.stages = VK_PIPELINE_STAGE_2_COPY_BIT;
+        state.access = VK_ACCESS_2_TRANSFER_READ_BIT;
+        state.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        break;
+    case ResourceUsage::CopyDestination:
+        state.stages = VK_PIPELINE_STAGE_2_COPY_BIT;
+        state.access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        state.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        break;
+    case ResourceUsage::BlitSource:
+        state.stages = VK_PIPELINE_STAGE_2_BLIT_BIT;
+        state.access = VK_ACCESS_2_TRANSFER_READ_BIT;
+        state.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        break;
+    case ResourceUsage::BlitDestination:
+        state.stages = VK_PIPELINE_STAGE_2_BLIT_BIT;
+        state.access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        state.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        break;
+    case ResourceUsage::Present:
+        // The present waits on a semaphore, the barrier only has to transition the layout
+        state.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        break;
+    }
+    return state;
+}
+
+bool isWriteUsage(ResourceUsage usage)
+{
+    return (getResourceState(usage).access & WRITE_ACCESS) != 0;
+}
+
+void VulkanResourceStateTracker::create(VkDevice device, bool synchronization2)
+{
+    this->device = device;
+    cmdPipelineBarrier2 = nullptr;
+    if (synchronization2)
+    {
+        cmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR"));
+        if (!cmdPipelineBarrier2)
+        {
+            throw std::runtime_error("failed to load vkCmdPipelineBarrier2KHR!");
+        }
+    }
+}
+
+void VulkanResourceStateTracker::destroy()
+{
+    images.clear();
+    buffers.clear();
+    imageBarriers.clear();
+    bufferBarriers.clear();
+    device = VK_NULL_HANDLE;
+}
+
+VulkanResourceStateTracker::SubresourceState VulkanResourceStateTracker::makeState(const ResourceState &state)
+{
+    SubresourceState subresource;
+    subresource.layout = state.layout;
+    subresource.queueFamily = state.queueFamily;
+    // Whatever read there, the next write still has to wait for it, so treat all of it as the last write
+    subresource.writeStages = state.stages;
+    subresource.writeAccess = state.access & WRITE_ACCESS;
+    // Reads of the state have already seen the write before them
+    subresource.visibleStages = state.stages;
+    subresource.visibleAccess = state.access & ~WRITE_ACCESS;
+    return subresource;
+}
+
+void VulkanResourceStateTracker::trackImage(VkImage image, VkImageAspectFlags aspect, uint32_t mipLevels, uint32_t arrayLayers, const ResourceState &initial)
+{
+    ImageEntry &entry = images[image];
+    entry.aspect = aspect;
+    entry.mipLevels = mipLevels;
+    entry.arrayLayers = arrayLayers;
+    entry.subresources.assign(static_cast<size_t>(mipLevels) * arrayLayers, makeState(initial));
+}
+
+void VulkanResourceStateTracker::setImageState(VkImage image, const VkImageSubresourceRange &range, const ResourceState &state)
+{
+    ImageEntry &entry = images.at(image);
+    uint32_t levelCount = range.levelCount == VK_REMAINING_MIP_LEVELS ? entry.mipLevels - range.baseMipLevel : range.levelCount;
+    uint32_t layerCount = range.layerCount == VK_REMAINING_ARRAY_LAYERS ? entry.arrayLayers - range.baseArrayLayer : range.layerCount;
+
+    for (uint32_t layer = range.baseArrayLayer; layer < range.baseArrayLayer + layerCount; layer++)
+    {
+        for (uint32_t level = range.baseMipLevel; level < range.baseMipLevel + levelCount; level++)
+            entry.subresources[static_cast<size_t>(layer) * entry.mipLevels + level] = makeState(state);
+    }
+}
+
+void VulkanResourceStateTracker::trackBuffer(VkBuffer buffer, const ResourceState &initial)
+{
+    buffers[buffer] = makeState(initial);
+}
+
+VulkanResourceStateTracker::Transition VulkanResourceStateTracker::transition(SubresourceState &state, const ResourceState &target, bool writes)
+{
+    Transition result;
+    result.oldLayout = state.layout;
+
+    bool layoutChange = target.layout != VK_IMAGE_LAYOUT_UNDEFINED && target.layout != state.layout;
+    bool ownershipChange = target.queueFamily != VK_QUEUE_FAMILY_IGNORED && state.queueFamily != VK_QUEUE_FAMILY_IGNORED && target.queueFamily != state.queueFamily;
+    if (ownershipChange)
+    {
+        result.srcQueueFamily = state.queueFamily;
+        result.dstQueueFamily = target.queueFamily;
+    }
+
+    // A layout transition writes the image, so it orders like a write
+    bool writeLike = writes || layoutChange || ownershipChange;
+    if (writeLike)
+    {
+        // Write after read only needs the readers to be done, write after write also needs the writes available
+        result.srcStages = state.writeStages | state.readStages;
+        result.srcAccess = state.writeAccess;
+    }
+    else if ((target.stages & ~state.visibleStages) || (target.access & ~state.visibleAccess))
+    {
+        result.srcStages = state.writeStages;
+        result.srcAccess = state.writeAccess;
+    }
+    result.needed = layoutChange || ownershipChange || result.srcStages != VK_PIPELINE_STAGE_2_NONE;
+
+    if (writeLike)
+    {
+        if (layoutChange)
+            state.layout = target.layout;
+        if (target.queueFamily != VK_QUEUE_FAMILY_IGNORED)
+            state.queueFamily = target.queueFamily;
+        state.writeStages = target.stages;
+        state.writeAccess = writes ? target.access & WRITE_ACCESS : VK_ACCESS_2_NONE;
+        state.readStages = writes ? VK_PIPELINE_STAGE_2_NONE : target.stages;
+        state.visibleStages = target.stages;
+        state.visibleAccess = target.access;
+    }
+    else
+    {
+        state.readStages |= target.stages;
+        state.visibleStages |= target.stages;
+        state.visibleAccess |= target.access;
+    }
+    return result;
+}
+
+void VulkanResourceStateTracker::useImage(VkImage image, const VkImageSubresourceRange &range, ResourceUsage usage)
+{
+    useImage(image, range, getResourceState(usage), isWriteUsage(usage));
+}
+
+void VulkanResourceStateTracker::useImage(VkImage image, ResourceUsage usage)
+{
+    useImage(image, {0, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS}, usage);
+}
+
+void VulkanResourceStateTracker::useImage(VkImage image, const VkImageSubresourceRange &range, const ResourceState &target, bool writes)
+{
+    auto found = images.find(image);
+    if (found == images.end())
+    {
+        throw std::runtime_error("failed to find tracked image!");
+    }
+    ImageEntry &entry = found->second;
+
+    uint32_t levelCount = range.levelCount == VK_REMAINING_MIP_LEVELS ? entry.mipLevels - range.baseMipLevel : range.levelCount;
+    uint32_t layerCount = range.layerCount == VK_REMAINING_ARRAY_LAYERS ? entry.arrayLayers - range.baseArrayLayer : range.layerCount;
+
+    size_t firstBarrier = imageBarriers.size();
+    for (uint32_t layer = range.baseArrayLayer; layer < range.baseArrayLayer + layerCount; layer++)
+    {
+        for (uint32_t level = range.baseMipLevel; level < range.baseMipLevel + levelCount; level++)
+        {
+            SubresourceState &state = entry.subresources[static_cast<size_t>(layer) * entry.mipLevels + level];
+            Transition needed = transition(state, target, writes);
+            if (!needed.needed)
+                continue;
+
+            // The previous level of the same layer may have needed the very same barrier
+            if (imageBarriers.size() > firstBarrier)
+            {
+                VkImageMemoryBarrier2 &previous = imageBarriers.back();
+                if (previous.subresourceRange.baseArrayLayer == layer && previous.subresourceRange.baseMipLevel + previous.subresourceRange.levelCount == level &&
+                    previous.oldLayout == needed.oldLayout && previous.srcStageMask == needed.srcStages && previous.srcAccessMask == needed.srcAccess &&
+                    previous.srcQueueFamilyIndex == needed.srcQueueFamily)
+                {
+                    previous.subresourceRange.levelCount++;
+                    continue;
+                }
+            }
+
+            VkImageMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+            barrier.srcStageMask = needed.srcStages;
+            barrier.srcAccessMask = needed.srcAccess;
+            barrier.dstStageMask = target.stages;
+            barrier.dstAccessMask = target.access;
+            barrier.oldLayout = needed.oldLayout;
+            barrier.newLayout = target.layout != VK_IMAGE_LAYOUT_UNDEFINED ? target.layout : needed.oldLayout;
+            barrier.srcQueueFamilyIndex = needed.srcQueueFamily;
+            barrier.dstQueueFamilyIndex = needed.dstQueueFamily;
+            barrier.image = image;
+            barrier.subresourceRange = {entry.aspect, level, 1, layer, 1};
+            imageBarriers.push_back(barrier);
+        }
+    }
+
+    if (imageBarriers.size() == firstBarrier)
+        statistics.overSynchronization++;
+}
+
+void VulkanResourceStateTracker::useBuffer(VkBuffer buffer, ResourceUsage usage)
+{
+    useBuffer(buffer, getResourceState(usage), isWriteUsage(usage));
+}
+
+void VulkanResourceStateTracker::useBuffer(VkBuffer buffer, const ResourceState &target, bool writes)
+{
+    auto found = buffers.find(buffer);
+    if (found == buffers.end())
+    {
+        throw std::runtime_error("failed to find tracked buffer!");
+    }
+
+    ResourceState bufferTarget = target;
+    bufferTarget.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    Transition needed = transition(found->second, bufferTarget, writes);
+    if (!needed.needed)
+    {
+        statistics.overSynchronization++;
+        return;
+    }
+
+    VkBufferMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    barrier.srcStageMask = needed.srcStages;
+    barrier.srcAccessMask = needed.srcAccess;
+    barrier.dstStageMask = target.stages;
+    barrier.dstAccessMask = target.access;
+    barrier.srcQueueFamilyIndex = needed.srcQueueFamily;
+    barrier.dstQueueFamilyIndex = needed.dstQueueFamily;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    bufferBarriers.push_back(barrier);
+}
+
+void VulkanResourceStateTracker::flush(VkCommandBuffer commandBuffer)
+{
+    if (imageBarriers.empty() && bufferBarriers.empty())
+        return;
+
+    statistics.batches++;
+    statistics.imageBarriers += static_cast<uint32_t>(imageBarriers.size());
+    statistics.bufferBarriers += static_cast<uint32_t>(bufferBarriers.size());
+
+    if (!cmdPipelineBarrier2)
+    {
+        flushLegacy(commandBuffer);
+        return;
+    }
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+    dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+    dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+    dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+    cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+    imageBarriers.clear();
+    bufferBarriers.clear();
+}
+
+void VulkanResourceStateTracker::flushLegacy(VkCommandBuffer commandBuffer)
+{
+    // One call has a single pair of stage masks, so every barrier waits for the union of them
+    VkPipelineStageFlags2 srcStages = VK_PIPELINE_STAGE_2_NONE;
+    VkPipelineStageFlags2 dstStages = VK_PIPELINE_STAGE_2_NONE;
+
+    std::vector<VkImageMemoryBarrier> legacyImages(imageBarriers.size());
+    for (size_t i = 0; i < imageBarriers.size(); i++)
+    {
+        const VkImageMemoryBarrier2 &barrier = imageBarriers[i];
+        VkImageMemoryBarrier &legacy = legacyImages[i];
+        legacy.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        legacy.srcAccessMask = toLegacyAccess(barrier.srcAccessMask);
+        legacy.dstAccessMask = toLegacyAccess(barrier.dstAccessMask);
+        legacy.oldLayout = barrier.oldLayout;
+        legacy.newLayout = barrier.newLayout;
+        legacy.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+        legacy.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+        legacy.image = barrier.image;
+        legacy.subresourceRange = barrier.subresourceRange;
+        srcStages |= barrier.srcStageMask;
+        dstStages |= barrier.dstStageMask;
+    }
+
+    std::vector<VkBufferMemoryBarrier> legacyBuffers(bufferBarriers.size());
+    for (size_t i = 0; i < bufferBarriers.size(); i++)
+    {
+        const VkBufferMemoryBarrier2 &barrier = bufferBarriers[i];
+        VkBufferMemoryBarrier &legacy = legacyBuffers[i];
+        legacy.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        legacy.srcAccessMask = toLegacyAccess(barrier.srcAccessMask);
+        legacy.dstAccessMask = toLegacyAccess(barrier.dstAccessMask);
+        legacy.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+        legacy.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+        legacy.buffer = barrier.buffer;
+        legacy.offset = barrier.offset;
+        legacy.size = barrier.size;
+        srcStages |= barrier.srcStageMask;
+        dstStages |= barrier.dstStageMask;
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, toLegacyStages(srcStages, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT), toLegacyStages(dstStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT), 0, 0,
+                         nullptr, static_cast<uint32_t>(legacyBuffers.size()), legacyBuffers.data(), static_cast<uint32_t>(legacyImages.size()), legacyImages.data());
+
+    imageBarriers.clear();
+    bufferBarriers.clear();
+}
+
+ResourceState VulkanResourceStateTracker::getImageState(VkImage image, uint32_t mipLevel, uint32_t arrayLayer) const
+{
+    const ImageEntry &entry = images.at(image);
+    const SubresourceState &subresource = entry.subresources[static_cast<size_t>(arrayLayer) * entry.mipLevels + mipLevel];
+
+    ResourceState state;
+    state.stages = subresource.writeStages | subresource.readStages;
+    state.access = subresource.writeAccess;
+    state.layout = subresource.layout;
+    state.queueFamily = subresource.queueFamily;
+    return state;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+/** @brief How a command uses a resource, each maps to the narrowest stages, accesses and layout that cover it */
+enum class ResourceUsage
+{
+    ColorAttachment,
+    /** @brief Depth test and write */
+    DepthAttachment,
+    SampledFragment,
+    SampledCompute,
+    /** @brief Read and written as a storage image or buffer in a compute shader */
+    StorageCompute,
+    UniformVertex,
+    VertexBuffer,
+    IndexBuffer,
+    IndirectBuffer,
+    CopySource,
+    CopyDestination,
+    BlitSource,
+    BlitDestination,
+    Present
+};
+
+/** @brief Stages and accesses that last touched a resource, or that the next use needs */
+struct ResourceState
+{
+    VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 access = VK_ACCESS_2_NONE;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    /** @brief VK_QUEUE_FAMILY_IGNORED while ownership does not matter */
+    uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED;
+};
+
+ResourceState getResourceState(ResourceUsage usage);
+bool isWriteUsage(ResourceUsage usage);
+
+/**
+ * @brief Tracks layout, stages, accesses and queue family of every image subresource and buffer, and records the barriers between uses
+ *
+ * Each mip level and array layer of an image is tracked separately, so blitting a mip chain or
+ * sampling one level while writing another needs no barrier on the levels in between. A use only gets
+ * a barrier when it changes the layout or queue family, writes after any access, or reads something
+ * the last write has not been made visible to yet. The barrier waits for exactly the stages and makes
+ * available exactly the writes since then. Reads after reads need nothing.
+ *
+ * Barriers collect until flush(), which records all of them with one vkCmdPipelineBarrier2. Neighbouring
+ * levels that need the same barrier share one. Without synchronization2 the same barriers go through
+ * vkCmdPipelineBarrier with the masks widened to their legacy equivalents.
+ *
+ * Uses that need no barrier are counted as over-synchronization: a barrier written by hand at that
+ * point would only have stalled the GPU.
+ */
+class VulkanResourceStateTracker
+{
+public:
+    struct Statistics
+    {
+        uint32_t batches = 0;
+        uint32_t imageBarriers = 0;
+        uint32_t bufferBarriers = 0;
+        /** @brief Uses that were already synchronized */
+        uint32_t overSynchronization = 0;
+    };
+
+    /** @param synchronization2 VK_KHR_synchronization2 is enabled on device */
+    void create(VkDevice device, bool synchronization2);
+    void destroy();
+
+    /** @brief Starts tracking image, or restarts it, with every subresource in initial */
+    void trackImage(VkImage image, VkImageAspectFlags aspect, uint32_t mipLevels, uint32_t arrayLayers, const ResourceState &initial = {});
+    void trackBuffer(VkBuffer buffer, const ResourceState &initial = {});
+    void forgetImage(VkImage image) { images.erase(image); }
+    void forgetBuffer(VkBuffer buffer) { buffers.erase(buffer); }
+    /** @brief Sets range to state without a barrier, for transitions recorded elsewhere such as a queue family acquire */
+    void setImageState(VkImage image, const VkImageSubresourceRange &range, const ResourceState &state);
+
+    /** @brief Moves the levels and layers of range to usage, range.aspectMask is ignored */
+    void useImage(VkImage image, const VkImageSubresourceRange &range, ResourceUsage usage);
+    void useImage(VkImage image, const VkImageSubresourceRange &range, const ResourceState &target, bool writes);
+    /** @brief Moves every subresource to usage */
+    void useImage(VkImage image, ResourceUsage usage);
+    void useBuffer(VkBuffer buffer, ResourceUsage usage);
+    void useBuffer(VkBuffer buffer, const ResourceState &target, bool writes);
+
+    /** @brief Records the collected barriers, does nothing if there are none */
+    void flush(VkCommandBuffer commandBuffer);
+
+    /** @brief The last use of a subresource, with stages and accesses merged since its last write */
+    ResourceState getImageState(VkImage image, uint32_t mipLevel, uint32_t arrayLayer) const;
+    const Statistics &getStatistics() const { return statistics; }
+    void resetStatistics() { statistics = Statistics{}; }
+
+private:
+    struct SubresourceState
+    {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED;
+        /** @brief Stages of the last write or layout transition, and the writes that still have to be made available */
+        VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+        /** @brief Stages that read since the last write */
+        VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+        /** @brief Stages and accesses the last write has been made visible to */
+        VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
+    };
+
+    struct ImageEntry
+    {
+        VkImageAspectFlags aspect = 0;
+        uint32_t mipLevels = 0;
+        uint32_t arrayLayers = 0;
+        /** @brief Indexed [layer * mipLevels + level] */
+        std::vector<SubresourceState> subresources;
+    };
+
+    /** @brief What a use needs from the state before it, an empty srcStages and no layout or owner change means nothing */
+    struct Transition
+    {
+        bool needed = false;
+        VkPipelineStageFlags2 srcStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+        VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+    };
+
+    VkDevice device{VK_NULL_HANDLE};
+    PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2{nullptr};
+
+    std::unordered_map<VkImage, ImageEntry> images;
+    std::unordered_map<VkBuffer, SubresourceState> buffers;
+
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    Statistics statistics;
+
+    static SubresourceState makeState(const ResourceState &state);
+    /** @brief Works out the barrier target needs and moves state to target */
+    static Transition transition(SubresourceState &state, const ResourceState &target, bool writes);
+
+    void flushLegacy(VkCommandBuffer commandBuffer);
+};
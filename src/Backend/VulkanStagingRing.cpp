@@ -0,0 +1,136 @@
+#include "VulkanStagingRing.h"
+
+#include <stdexcept>
+
+void VulkanStagingRing::create(VkDevice device, VulkanMemoryAllocator &allocator, VkDeviceSize capacity)
+{
+    this->device = device;
+    this->allocator = &allocator;
+    this->capacity = capacity;
+
+    allocator.createBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, bufferAllocation);
+    if (bufferAllocation.mapped == nullptr)
+    {
+        throw std::runtime_error("failed to map staging ring!");
+    }
+
+    head = 0;
+    tail = 0;
+    hasOpenAllocations = false;
+}
+
+void VulkanStagingRing::destroy()
+{
+    if (buffer == VK_NULL_HANDLE)
+        return;
+
+    while (!inFlight.empty())
+    {
+        waitForOldest();
+        inFlight.pop_front();
+    }
+
+    allocator->destroyBuffer(buffer, bufferAllocation);
+    buffer = VK_NULL_HANDLE;
+}
+
+bool VulkanStagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation &allocation)
+{
+    if (size > capacity)
+        return false;
+
+    reclaim();
+
+    VkDeviceSize offset;
+    while (!place(size, alignment, offset))
+    {
+        // Allocations that were not submitted yet can never be reclaimed by waiting
+        if (inFlight.empty())
+            return false;
+
+        waitForOldest();
+        reclaim();
+    }
+
+    head = offset + size;
+    hasOpenAllocations = true;
+
+    allocation.buffer = buffer;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.mapped = static_cast<char *>(bufferAllocation.mapped) + offset;
+    return true;
+}
+
+void VulkanStagingRing::closeBatch(VkSemaphore timeline, uint64_t value)
+{
+    inFlight.push_back({head, timeline, value});
+    hasOpenAllocations = false;
+}
+
+void VulkanStagingRing::reclaim()
+{
+    while (!inFlight.empty())
+    {
+        uint64_t completed = 0;
+        vkGetSemaphoreCounterValue(device, inFlight.front().timeline, &completed);
+        if (completed < inFlight.front().value)
+            break;
+
+        tail = inFlight.front().end;
+        inFlight.pop_front();
+    }
+
+    if (inFlight.empty() && !hasOpenAllocations)
+    {
+        head = 0;
+        tail = 0;
+    }
+}
+
+bool VulkanStagingRing::place(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset)
+{
+    if (inFlight.empty() && !hasOpenAllocations)
+    {
+        head = 0;
+        tail = 0;
+        offset = 0;
+        return size <= capacity;
+    }
+
+    VkDeviceSize aligned = (head + alignment - 1) / alignment * alignment;
+    if (head >= tail)
+    {
+        // Used space is [tail, head), try the end of the ring first and wrap to the start otherwise.
+        // Wrapping must stop short of tail so that head == tail keeps meaning "empty"
+        if (aligned + size <= capacity)
+        {
+            offset = aligned;
+            return true;
+        }
+        if (size < tail)
+        {
+            offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // Wrapped, used space is [tail, capacity) and [0, head)
+    if (aligned + size < tail)
+    {
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+void VulkanStagingRing::waitForOldest()
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &inFlight.front().timeline;
+    waitInfo.pValues = &inFlight.front().value;
+    vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+}
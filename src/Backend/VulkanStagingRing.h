@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+
+#include "VulkanMemoryAllocator.h"
+
+/** @brief A slice of the staging ring, written through mapped and copied from buffer at offset */
+struct StagingAllocation
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;
+};
+
+/**
+ * @brief Persistently mapped host visible ring buffer shared by all uploads
+ *
+ * Allocations are handed out in submission order. Every batch of allocations is closed with the
+ * timeline semaphore value its submission signals, and its space is reclaimed once that value has
+ * been reached, so uploads only wait on the GPU when the ring is actually full.
+ */
+class VulkanStagingRing
+{
+public:
+    void create(VkDevice device, VulkanMemoryAllocator &allocator, VkDeviceSize capacity);
+    void destroy();
+
+    /**
+     * @brief Carves size bytes out of the ring, waiting on in flight batches if needed
+     * @return false if the space is only held by allocations that have not been submitted yet; submit them and retry
+     */
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation &allocation);
+    /** @brief Closes the batch of allocations made since the last call, it stays in use until timeline reaches value */
+    void closeBatch(VkSemaphore timeline, uint64_t value);
+    /** @brief Releases the space of every batch whose timeline value has been reached */
+    void reclaim();
+
+    VkBuffer getBuffer() const { return buffer; }
+    VkDeviceSize getCapacity() const { return capacity; }
+    /** @brief Largest chunk an upload should copy at once so that several chunks can be in flight */
+    VkDeviceSize getMaxChunkSize() const { return capacity / 4; }
+
+private:
+    struct InFlightBatch
+    {
+        VkDeviceSize end;
+        VkSemaphore timeline;
+        uint64_t value;
+    };
+
+    VkDevice device{VK_NULL_HANDLE};
+    VulkanMemoryAllocator *allocator{nullptr};
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VulkanAllocation bufferAllocation{};
+    VkDeviceSize capacity = 0;
+
+    VkDeviceSize head = 0;
+    VkDeviceSize tail = 0;
+    bool hasOpenAllocations = false;
+    std::deque<InFlightBatch> inFlight;
+
+    bool place(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+    void waitForOldest();
+};
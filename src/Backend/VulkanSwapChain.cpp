@@ -1,5 +1,8 @@
 #include "VulkanSwapChain.h"
 
+#include <algorithm>
+#include <limits>
+
 void VulkanSwapChain::setContext(VkInstance instance, VkDevice device, VkPhysicalDevice physicalDevice)
 {
     this->instance = instance;
@@ -40,7 +43,7 @@ void VulkanSwapChain::initSurface(GLFWwindow *window)
     colorSpace = selectedFormat.colorSpace;
 }
 
-void VulkanSwapChain::create(int width, int height)
+RetiredSwapChain VulkanSwapChain::create(int width, int height)
 {
     VkSurfaceCapabilitiesKHR surfCaps;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfCaps);
@@ -65,7 +68,7 @@ void VulkanSwapChain::create(int width, int height)
 
     uint32_t presentModecount;
     vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModecount, nullptr);
-    std::vector<VkPresentModeKHR> presentModes;
+    presentModes.resize(presentModecount);
     vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModecount, presentModes.data());
 
     VkPresentModeKHR swapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
@@ -75,7 +78,7 @@ void VulkanSwapChain::create(int width, int height)
             swapchainPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
     }
 
-    uint32_t imageCount = surfCaps.minImageCount + 1;
+    imageCount = surfCaps.minImageCount + 1;
     if(surfCaps.maxImageCount > 0 && imageCount > surfCaps.maxImageCount)
         imageCount = surfCaps.maxImageCount;
 
@@ -94,7 +97,12 @@ void VulkanSwapChain::create(int width, int height)
     swapchainCI.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     swapchainCI.presentMode = swapchainPresentMode;
     swapchainCI.clipped = VK_TRUE;
-    //swapchainCI.oldSwapchain;
+    // The presentation engine can keep showing the old images until the new swapchain presents
+    swapchainCI.oldSwapchain = swapChain;
+
+    RetiredSwapChain retired;
+    retired.swapChain = swapChain;
+    retired.imageViews.swap(imageViews);
 
     if(vkCreateSwapchainKHR(device, &swapchainCI, nullptr, &swapChain)!= VK_SUCCESS)
         throw std::runtime_error("failed to create swapchain");
@@ -124,18 +132,40 @@ void VulkanSwapChain::create(int width, int height)
         colorAttachmentView.subresourceRange.levelCount = 1;
 
         if(vkCreateImageView(device, &colorAttachmentView, nullptr, &imageViews[i]) != VK_SUCCESS)
-            std::runtime_error("Failed to create imageView");
+            throw std::runtime_error("Failed to create imageView");
     }
+
+    return retired;
 }
 
-VkResult VulkanSwapChain::aquireNextImage()
+void VulkanSwapChain::destroyRetired(const RetiredSwapChain &retired)
 {
+    for(VkImageView imageView : retired.imageViews)
+        vkDestroyImageView(device, imageView, nullptr);
 
+    if(retired.swapChain != VK_NULL_HANDLE)
+        vkDestroySwapchainKHR(device, retired.swapChain, nullptr);
 }
 
-VkResult VulkanSwapChain::queuePresent()
+VkResult VulkanSwapChain::aquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t &imageIndex)
 {
-    
+    // Out of date and suboptimal are returned to the caller, which recreates the swapchain
+    return vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, presentCompleteSemaphore, VK_NULL_HANDLE, &imageIndex);
+}
+
+VkResult VulkanSwapChain::queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore)
+{
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &swapChain;
+    presentInfo.pImageIndices = &imageIndex;
+    if(waitSemaphore != VK_NULL_HANDLE)
+    {
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &waitSemaphore;
+    }
+    return vkQueuePresentKHR(queue, &presentInfo);
 }
 
 void VulkanSwapChain::cleanup()
@@ -10,6 +10,13 @@
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 
+/** @brief A replaced swapchain and its views, frames in flight may still use them */
+struct RetiredSwapChain
+{
+    VkSwapchainKHR swapChain{VK_NULL_HANDLE};
+    std::vector<VkImageView> imageViews{};
+};
+
 class VulkanSwapChain
 {
 private:
@@ -29,8 +36,16 @@ public:
 
     void setContext(VkInstance instance, VkDevice device, VkPhysicalDevice physicalDevice);
     void initSurface(GLFWwindow *window);
-    void create(int width, int height);
-    VkResult aquireNextImage();
-    VkResult queuePresent();
+    /**
+     * @brief Creates the swapchain, or replaces the current one without waiting for the device
+     *
+     * The current swapchain is passed as oldSwapchain and returned with its views. Destroy them with
+     * destroyRetired() once the frames that used them have completed.
+     */
+    RetiredSwapChain create(int width, int height);
+    void destroyRetired(const RetiredSwapChain &retired);
+    /** @return VK_ERROR_OUT_OF_DATE_KHR or VK_SUBOPTIMAL_KHR when the swapchain has to be recreated */
+    VkResult aquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t &imageIndex);
+    VkResult queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore = VK_NULL_HANDLE);
     void cleanup();
 };
\ No newline at end of file
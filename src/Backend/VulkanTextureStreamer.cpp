@@ -0,0 +1,180 @@
+#include "VulkanTextureStreamer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void VulkanTextureStreamer::create(VkDevice device, VulkanMemoryAllocator &allocator, VulkanUploadBatch &uploadBatch, uint32_t framesInFlight,
+                                   std::function<void()> onViewChanged)
+{
+    this->device = device;
+    this->allocator = &allocator;
+    this->uploadBatch = &uploadBatch;
+    this->framesInFlight = framesInFlight;
+    this->onViewChanged = std::move(onViewChanged);
+}
+
+void VulkanTextureStreamer::destroy()
+{
+    for (RetiredView &retired : retiredViews)
+        vkDestroyImageView(device, retired.view, nullptr);
+    retiredViews.clear();
+
+    for (Texture &texture : textures)
+    {
+        if (texture.view != VK_NULL_HANDLE)
+            vkDestroyImageView(device, texture.view, nullptr);
+        allocator->destroyImage(texture.image, texture.allocation);
+    }
+    textures.clear();
+}
+
+StreamedTextureId VulkanTextureStreamer::add(const LoadedImage &image)
+{
+    Texture texture{};
+    texture.format = image.format;
+    texture.mipLevels = static_cast<uint32_t>(image.levels.size());
+    texture.storage = image.storage;
+    for (const LoadedImageLevel &level : image.levels)
+    {
+        texture.levels.push_back({level.width, level.height, image.pixels + level.offset});
+        texture.levelSizes.push_back(level.size);
+    }
+
+    // Nothing resident, uploaded or queued yet
+    texture.residentLod = texture.mipLevels;
+    texture.uploadedLod = texture.mipLevels;
+    texture.queuedLod = texture.mipLevels;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = image.width;
+    imageInfo.extent.height = image.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = texture.mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = image.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    allocator->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.image, texture.allocation);
+
+    textures.push_back(std::move(texture));
+    return static_cast<StreamedTextureId>(textures.size() - 1);
+}
+
+void VulkanTextureStreamer::setRequestedLod(StreamedTextureId id, uint32_t lod)
+{
+    Texture &texture = textures[id];
+    texture.requestedLod = std::min(lod, texture.mipLevels - 1);
+    updateView(id);
+}
+
+void VulkanTextureStreamer::update()
+{
+    frame++;
+
+    // A replaced view is rewritten out of each frame's descriptors the next time that frame is recorded, which
+    // happens after its previous submission finished, so framesInFlight frames later nothing refers to it
+    size_t kept = 0;
+    for (const RetiredView &retired : retiredViews)
+    {
+        if (frame >= retired.frame + framesInFlight)
+            vkDestroyImageView(device, retired.view, nullptr);
+        else
+            retiredViews[kept++] = retired;
+    }
+    retiredViews.resize(kept);
+
+    // Keeping the batch just above its budget leaves the choice of the next level here, where it can be made
+    // across textures
+    VkDeviceSize budget = uploadBatch->getFrameBudget();
+    while (budget == 0 || uploadBatch->getPendingBytes() < budget)
+    {
+        if (!queueNextLevel())
+            break;
+    }
+}
+
+bool VulkanTextureStreamer::queueNextLevel()
+{
+    StreamedTextureId next = INVALID_TEXTURE;
+    VkDeviceSize nextSize = 0;
+    for (StreamedTextureId id = 0; id < textures.size(); id++)
+    {
+        const Texture &texture = textures[id];
+        if (texture.queuedLod <= texture.requestedLod)
+            continue;
+
+        VkDeviceSize size = texture.levelSizes[texture.queuedLod - 1];
+        if (next == INVALID_TEXTURE || size < nextSize)
+        {
+            next = id;
+            nextSize = size;
+        }
+    }
+
+    if (next == INVALID_TEXTURE)
+        return false;
+
+    Texture &texture = textures[next];
+    uint32_t level = --texture.queuedLod;
+
+    ImageUpload upload{};
+    upload.image = texture.image;
+    upload.format = texture.format;
+    upload.levels.push_back(texture.levels[level]);
+    upload.baseMipLevel = level;
+    upload.onStaged = [this, next, level]()
+    {
+        // Level 0 is staged last, after it the source data is no longer needed
+        if (level == 0)
+            textures[next].storage.reset();
+    };
+    upload.onSubmitted = [this, next, level](uint64_t)
+    {
+        textures[next].uploadedLod = level;
+        updateView(next);
+    };
+    uploadBatch->upload(upload);
+    return true;
+}
+
+void VulkanTextureStreamer::updateView(StreamedTextureId id)
+{
+    Texture &texture = textures[id];
+    if (texture.uploadedLod >= texture.mipLevels)
+        return;
+
+    uint32_t lod = std::max(texture.uploadedLod, texture.requestedLod);
+    if (lod == texture.residentLod)
+        return;
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = texture.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = lod;
+    viewInfo.subresourceRange.levelCount = texture.mipLevels - lod;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    VkImageView view;
+    if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture image view!");
+    }
+
+    if (texture.view != VK_NULL_HANDLE)
+        retiredViews.push_back({texture.view, frame});
+    texture.view = view;
+    texture.residentLod = lod;
+
+    if (onViewChanged)
+        onViewChanged();
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanUploadBatch.h"
+
+typedef uint32_t StreamedTextureId;
+
+/**
+ * @brief Makes textures resident coarsest mip first and refines them over the following frames
+ *
+ * Levels are handed to the upload batch one at a time, smallest across all textures first, and only
+ * while less than a frame budget is waiting in the batch. A burst of new textures therefore gets a
+ * usable mip for every texture before any of them gets detail. Each texture is sampled through a view
+ * whose base level is its resident LOD. The view is replaced as finer levels land, and a replaced view
+ * is destroyed once no frame in flight can still be using it.
+ *
+ * Images are allocated for the whole chain up front. Requesting a coarser LOD stops streaming and
+ * narrows the view, but it does not give device memory back.
+ */
+class VulkanTextureStreamer
+{
+public:
+    static const StreamedTextureId INVALID_TEXTURE = UINT32_MAX;
+
+    /** @param onViewChanged Called when a view returned by getView() has been replaced, descriptors using it must be rewritten */
+    void create(VkDevice device, VulkanMemoryAllocator &allocator, VulkanUploadBatch &uploadBatch, uint32_t framesInFlight,
+                std::function<void()> onViewChanged);
+    /** @brief The device must be idle */
+    void destroy();
+
+    /** @brief Creates an image for every level of image and queues them, the level data is kept alive until all of it is staged */
+    StreamedTextureId add(const LoadedImage &image);
+    /** @brief Finest level that should become resident, 0 for full detail */
+    void setRequestedLod(StreamedTextureId texture, uint32_t lod);
+
+    /** @brief Once per frame before the upload batch is flushed: destroys views no frame can use and queues more levels */
+    void update();
+
+    /** @brief View of the resident levels, null until the coarsest level has been uploaded */
+    VkImageView getView(StreamedTextureId texture) const { return textures[texture].view; }
+    /** @brief Base level of the view, the level count while nothing is resident */
+    uint32_t getResidentLod(StreamedTextureId texture) const { return textures[texture].residentLod; }
+
+private:
+    struct Texture
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VulkanAllocation allocation;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t mipLevels = 0;
+        std::vector<ImageLevelData> levels;
+        std::vector<VkDeviceSize> levelSizes;
+        /** @brief Keeps the level data alive until every level has been staged */
+        std::shared_ptr<const unsigned char> storage;
+
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t residentLod = 0;
+        /** @brief Finest level whose upload has been submitted */
+        uint32_t uploadedLod = 0;
+        /** @brief Finest level handed to the upload batch */
+        uint32_t queuedLod = 0;
+        uint32_t requestedLod = 0;
+    };
+
+    struct RetiredView
+    {
+        VkImageView view;
+        uint64_t frame;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VulkanMemoryAllocator *allocator{nullptr};
+    VulkanUploadBatch *uploadBatch{nullptr};
+    uint32_t framesInFlight = 0;
+    std::function<void()> onViewChanged;
+
+    std::vector<Texture> textures;
+    std::vector<RetiredView> retiredViews;
+    uint64_t frame = 0;
+
+    /** @return false if every texture has all of its requested levels queued */
+    bool queueNextLevel();
+    /** @brief Points the view at max(uploaded, requested) if that changed */
+    void updateView(StreamedTextureId texture);
+};
@@ -0,0 +1,244 @@
+#include "VulkanTransferQueue.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void VulkanTransferQueue::create(VkDevice device, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily)
+{
+    this->device = device;
+    this->queue = queue;
+    this->queueFamily = queueFamily;
+    this->graphicsFamily = graphicsFamily;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create transfer command pool!");
+    }
+
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create transfer timeline semaphore!");
+    }
+
+    lastSubmitted = 0;
+}
+
+void VulkanTransferQueue::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    wait(lastSubmitted);
+    collect();
+
+    vkDestroySemaphore(device, timeline, nullptr);
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    recordedAcquires.clear();
+    pendingAcquires.clear();
+    device = VK_NULL_HANDLE;
+}
+
+VkCommandBuffer VulkanTransferQueue::begin()
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate transfer command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    return commandBuffer;
+}
+
+uint64_t VulkanTransferQueue::submit(VkCommandBuffer commandBuffer)
+{
+    vkEndCommandBuffer(commandBuffer);
+
+    uint64_t signalValue = lastSubmitted + 1;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &timeline;
+
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit transfer command buffer!");
+    }
+
+    lastSubmitted = signalValue;
+    inFlight.push_back({signalValue, commandBuffer});
+
+    // Releases recorded into this command buffer can now be acquired on the graphics queue
+    for (auto it = recordedAcquires.begin(); it != recordedAcquires.end();)
+    {
+        if (it->releasedIn == commandBuffer)
+        {
+            it->value = signalValue;
+            pendingAcquires.push_back(*it);
+            it = recordedAcquires.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    return signalValue;
+}
+
+void VulkanTransferQueue::release(VkCommandBuffer commandBuffer, std::vector<VkBufferMemoryBarrier> &bufferBarriers, std::vector<VkImageMemoryBarrier> &imageBarriers,
+                                  VkPipelineStageFlags dstStage)
+{
+    if (bufferBarriers.empty() && imageBarriers.empty())
+        return;
+
+    uint32_t srcFamily = hasOwnershipTransfer() ? queueFamily : VK_QUEUE_FAMILY_IGNORED;
+    uint32_t dstFamily = hasOwnershipTransfer() ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+
+    for (VkBufferMemoryBarrier &barrier : bufferBarriers)
+    {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+    }
+    for (VkImageMemoryBarrier &barrier : imageBarriers)
+    {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+    }
+
+    if (!hasOwnershipTransfer())
+    {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+                             0, nullptr,
+                             static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                             static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        return;
+    }
+
+    // Both halves of an image transfer must describe the same layout transition, it is executed once between them.
+    // Destination access is ignored for the release half, the acquire on the graphics queue makes the writes visible
+    for (VkBufferMemoryBarrier &barrier : bufferBarriers)
+    {
+        Acquire acquire{};
+        acquire.releasedIn = commandBuffer;
+        acquire.dstStage = dstStage;
+        acquire.isImage = false;
+        acquire.bufferBarrier = barrier;
+        acquire.bufferBarrier.srcAccessMask = 0;
+        recordedAcquires.push_back(acquire);
+
+        barrier.dstAccessMask = 0;
+    }
+    for (VkImageMemoryBarrier &barrier : imageBarriers)
+    {
+        Acquire acquire{};
+        acquire.releasedIn = commandBuffer;
+        acquire.dstStage = dstStage;
+        acquire.isImage = true;
+        acquire.imageBarrier = barrier;
+        acquire.imageBarrier.srcAccessMask = 0;
+        recordedAcquires.push_back(acquire);
+
+        barrier.dstAccessMask = 0;
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr,
+                         static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+uint64_t VulkanTransferQueue::recordAcquires(VkCommandBuffer graphicsCommandBuffer)
+{
+    if (pendingAcquires.empty())
+        return 0;
+
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    VkPipelineStageFlags dstStage = 0;
+    uint64_t waitValue = 0;
+
+    for (const Acquire &acquire : pendingAcquires)
+    {
+        if (acquire.isImage)
+            imageBarriers.push_back(acquire.imageBarrier);
+        else
+            bufferBarriers.push_back(acquire.bufferBarrier);
+
+        dstStage |= acquire.dstStage;
+        waitValue = std::max(waitValue, acquire.value);
+    }
+    pendingAcquires.clear();
+
+    vkCmdPipelineBarrier(graphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0,
+                         0, nullptr,
+                         static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+    return waitValue;
+}
+
+bool VulkanTransferQueue::isComplete(uint64_t value)
+{
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(device, timeline, &completed);
+    return completed >= value;
+}
+
+void VulkanTransferQueue::wait(uint64_t value)
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &value;
+    vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+}
+
+void VulkanTransferQueue::collect()
+{
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(device, timeline, &completed);
+
+    while (!inFlight.empty() && inFlight.front().value <= completed)
+    {
+        vkFreeCommandBuffers(device, commandPool, 1, &inFlight.front().commandBuffer);
+        inFlight.pop_front();
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <vector>
+
+/**
+ * @brief Asynchronous upload queue, completion is signalled on a timeline semaphore
+ *
+ * Runs on a transfer only queue family when the device has one, otherwise on the graphics queue.
+ * Submissions never wait; each one signals the next timeline value. Resources written here are
+ * handed to the graphics family with release barriers, the matching acquire barriers are recorded
+ * into the next frame by recordAcquires().
+ */
+class VulkanTransferQueue
+{
+public:
+    void create(VkDevice device, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily);
+    void destroy();
+
+    /** @brief Begins a one time submit command buffer on the transfer queue */
+    VkCommandBuffer begin();
+    /** @brief Submits without waiting and returns the timeline value that signals completion */
+    uint64_t submit(VkCommandBuffer commandBuffer);
+
+    /**
+     * @brief Makes buffers and images written in commandBuffer visible to dstStage on the graphics queue
+     *
+     * The barriers carry the destination access masks and, for images, the layout transition. All of
+     * them are recorded as a single pipeline barrier; queue family indices and source access are filled in here.
+     */
+    void release(VkCommandBuffer commandBuffer, std::vector<VkBufferMemoryBarrier> &bufferBarriers, std::vector<VkImageMemoryBarrier> &imageBarriers,
+                 VkPipelineStageFlags dstStage);
+    /**
+     * @brief Records the acquire half of every ownership transfer whose release has been submitted
+     * @return Timeline value the graphics submission has to wait on, 0 if nothing was acquired
+     */
+    uint64_t recordAcquires(VkCommandBuffer graphicsCommandBuffer);
+
+    bool isComplete(uint64_t value);
+    void wait(uint64_t value);
+    /** @brief Frees the command buffers of completed submissions */
+    void collect();
+
+    VkSemaphore getTimeline() const { return timeline; }
+    uint64_t getLastSubmitted() const { return lastSubmitted; }
+    uint32_t getQueueFamily() const { return queueFamily; }
+    bool hasOwnershipTransfer() const { return queueFamily != graphicsFamily; }
+
+private:
+    struct Acquire
+    {
+        VkCommandBuffer releasedIn;
+        uint64_t value;
+        VkPipelineStageFlags dstStage;
+        bool isImage;
+        VkBufferMemoryBarrier bufferBarrier;
+        VkImageMemoryBarrier imageBarrier;
+    };
+
+    struct InFlightCommandBuffer
+    {
+        uint64_t value;
+        VkCommandBuffer commandBuffer;
+    };
+
+    VkDevice device{VK_NULL_HANDLE};
+    VkQueue queue{VK_NULL_HANDLE};
+    uint32_t queueFamily = 0;
+    uint32_t graphicsFamily = 0;
+    VkCommandPool commandPool{VK_NULL_HANDLE};
+    VkSemaphore timeline{VK_NULL_HANDLE};
+    uint64_t lastSubmitted = 0;
+
+    /** @brief Released in a command buffer that has not been submitted yet */
+    std::vector<Acquire> recordedAcquires;
+    std::vector<Acquire> pendingAcquires;
+    std::deque<InFlightCommandBuffer> inFlight;
+};
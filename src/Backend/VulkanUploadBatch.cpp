@@ -0,0 +1,309 @@
+#include "VulkanUploadBatch.h"
+
+#include <vulkan/utility/vk_format_utils.h>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+    /** @brief Copy regions are grouped by destination so every destination gets a single copy command */
+    template <typename Handle, typename Region>
+    std::vector<Region> &regionsFor(std::vector<std::pair<Handle, std::vector<Region>>> &copies, Handle destination)
+    {
+        for (auto &copy : copies)
+        {
+            if (copy.first == destination)
+                return copy.second;
+        }
+        copies.push_back({destination, {}});
+        return copies.back().second;
+    }
+
+    VkImageSubresourceRange uploadRange(const ImageUpload &upload)
+    {
+        VkImageSubresourceRange range{};
+        range.aspectMask = upload.aspectMask;
+        range.baseMipLevel = upload.baseMipLevel;
+        range.levelCount = static_cast<uint32_t>(upload.levels.size());
+        range.baseArrayLayer = 0;
+        range.layerCount = 1;
+        return range;
+    }
+
+    VkDeviceSize levelSize(VkFormat format, const ImageLevelData &level)
+    {
+        VkExtent3D blockExtent = vkuFormatTexelBlockExtent(format);
+        VkDeviceSize blocksWide = (level.width + blockExtent.width - 1) / blockExtent.width;
+        VkDeviceSize blocksHigh = (level.height + blockExtent.height - 1) / blockExtent.height;
+        return blocksWide * blocksHigh * vkuFormatElementSize(format);
+    }
+}
+
+void VulkanUploadBatch::create(VulkanStagingRing &stagingRing, VulkanTransferQueue &transferQueue, VkDeviceSize frameBudget)
+{
+    this->stagingRing = &stagingRing;
+    this->transferQueue = &transferQueue;
+    this->frameBudget = frameBudget;
+    pendingBytes = 0;
+}
+
+void VulkanUploadBatch::destroy()
+{
+    // Uploads that never made it to the GPU still hand their source data back
+    for (Request &request : requests)
+    {
+        const std::function<void()> &onStaged = request.isImage ? request.image.onStaged : request.buffer.onStaged;
+        if (onStaged)
+            onStaged();
+    }
+    requests.clear();
+    pendingBytes = 0;
+}
+
+void VulkanUploadBatch::upload(const BufferUpload &upload)
+{
+    Request request{};
+    request.isImage = false;
+    request.buffer = upload;
+    requests.push_back(std::move(request));
+
+    pendingBytes += upload.size;
+}
+
+void VulkanUploadBatch::upload(const ImageUpload &upload)
+{
+    Request request{};
+    request.isImage = true;
+    request.image = upload;
+    requests.push_back(std::move(request));
+
+    for (const ImageLevelData &level : upload.levels)
+        pendingBytes += levelSize(upload.format, level);
+}
+
+uint64_t VulkanUploadBatch::flush()
+{
+    return submitBatch(frameBudget);
+}
+
+uint64_t VulkanUploadBatch::flushAll()
+{
+    uint64_t value = 0;
+    while (!requests.empty())
+        value = submitBatch(0);
+    return value;
+}
+
+uint64_t VulkanUploadBatch::submitBatch(VkDeviceSize budget)
+{
+    if (requests.empty())
+        return 0;
+
+    StagingBudget staging{budget == 0 ? VK_WHOLE_SIZE : budget, false};
+
+    std::vector<VkImageMemoryBarrier> toTransferDst;
+    std::vector<std::pair<VkBuffer, std::vector<VkBufferCopy>>> bufferCopies;
+    std::vector<std::pair<VkImage, std::vector<VkBufferImageCopy>>> imageCopies;
+    std::vector<VkBufferMemoryBarrier> bufferReleases;
+    std::vector<VkImageMemoryBarrier> imageReleases;
+    VkPipelineStageFlags releaseStage = 0;
+    std::vector<std::function<void(uint64_t)>> submitted;
+
+    while (!requests.empty() && staging.remaining > 0 && !staging.ringFull)
+    {
+        Request &request = requests.front();
+
+        if (request.isImage)
+        {
+            const ImageUpload &image = request.image;
+
+            if (!request.started)
+            {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image.image;
+                barrier.subresourceRange = uploadRange(image);
+                toTransferDst.push_back(barrier);
+                request.started = true;
+            }
+
+            if (!stageImage(request, staging, regionsFor(imageCopies, image.image)))
+                break;
+
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = image.finalLayout;
+            barrier.dstAccessMask = image.dstAccess;
+            barrier.image = image.image;
+            barrier.subresourceRange = uploadRange(image);
+            imageReleases.push_back(barrier);
+            releaseStage |= image.dstStage;
+
+            if (image.onStaged)
+                image.onStaged();
+            if (image.onSubmitted)
+                submitted.push_back(image.onSubmitted);
+        }
+        else
+        {
+            const BufferUpload &buffer = request.buffer;
+
+            if (!stageBuffer(request, staging, regionsFor(bufferCopies, buffer.buffer)))
+                break;
+
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.dstAccessMask = buffer.dstAccess;
+            barrier.buffer = buffer.buffer;
+            barrier.offset = buffer.offset;
+            barrier.size = buffer.size;
+            bufferReleases.push_back(barrier);
+            releaseStage |= buffer.dstStage;
+
+            if (buffer.onStaged)
+                buffer.onStaged();
+            if (buffer.onSubmitted)
+                submitted.push_back(buffer.onSubmitted);
+        }
+
+        requests.pop_front();
+    }
+
+    VkCommandBuffer commandBuffer = transferQueue->begin();
+
+    if (!toTransferDst.empty())
+    {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             static_cast<uint32_t>(toTransferDst.size()), toTransferDst.data());
+    }
+
+    for (const auto &copy : bufferCopies)
+    {
+        if (!copy.second.empty())
+            vkCmdCopyBuffer(commandBuffer, stagingRing->getBuffer(), copy.first, static_cast<uint32_t>(copy.second.size()), copy.second.data());
+    }
+    for (const auto &copy : imageCopies)
+    {
+        if (!copy.second.empty())
+            vkCmdCopyBufferToImage(commandBuffer, stagingRing->getBuffer(), copy.first, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copy.second.size()), copy.second.data());
+    }
+
+    transferQueue->release(commandBuffer, bufferReleases, imageReleases, releaseStage);
+
+    // No wait here, the staging space and command buffer are recycled once the timeline value is reached
+    uint64_t value = transferQueue->submit(commandBuffer);
+    stagingRing->closeBatch(transferQueue->getTimeline(), value);
+
+    for (const std::function<void(uint64_t)> &onSubmitted : submitted)
+        onSubmitted(value);
+
+    return value;
+}
+
+bool VulkanUploadBatch::stageBuffer(Request &request, StagingBudget &budget, std::vector<VkBufferCopy> &regions)
+{
+    const BufferUpload &upload = request.buffer;
+
+    while (request.bufferProgress < upload.size)
+    {
+        if (budget.remaining == 0 || budget.ringFull)
+            return false;
+
+        VkDeviceSize chunkSize = std::min({upload.size - request.bufferProgress, stagingRing->getMaxChunkSize(), budget.remaining});
+
+        StagingAllocation staging;
+        if (!stagingRing->allocate(chunkSize, 16, staging))
+        {
+            // The ring is full of chunks recorded for this batch, the rest goes into the next one
+            budget.ringFull = true;
+            return false;
+        }
+        memcpy(staging.mapped, static_cast<const char *>(upload.data) + request.bufferProgress, static_cast<size_t>(chunkSize));
+
+        VkBufferCopy region{};
+        region.srcOffset = staging.offset;
+        region.dstOffset = upload.offset + request.bufferProgress;
+        region.size = chunkSize;
+        regions.push_back(region);
+
+        request.bufferProgress += chunkSize;
+        budget.remaining -= chunkSize;
+        pendingBytes -= chunkSize;
+    }
+
+    return true;
+}
+
+bool VulkanUploadBatch::stageImage(Request &request, StagingBudget &budget, std::vector<VkBufferImageCopy> &regions)
+{
+    const ImageUpload &upload = request.image;
+
+    // Rows are counted in texel blocks so that compressed formats are only ever split on block boundaries
+    VkExtent3D blockExtent = vkuFormatTexelBlockExtent(upload.format);
+    VkDeviceSize elementSize = vkuFormatElementSize(upload.format);
+    VkDeviceSize alignment = std::lcm<VkDeviceSize>(elementSize, 16);
+
+    while (request.level < upload.levels.size())
+    {
+        const ImageLevelData &level = upload.levels[request.level];
+        uint32_t blocksWide = (level.width + blockExtent.width - 1) / blockExtent.width;
+        uint32_t blocksHigh = (level.height + blockExtent.height - 1) / blockExtent.height;
+        VkDeviceSize rowPitch = blocksWide * elementSize;
+
+        while (request.blockRow < blocksHigh)
+        {
+            if (budget.remaining == 0 || budget.ringFull)
+                return false;
+
+            // At least one row per chunk, so a budget smaller than a row still makes progress
+            VkDeviceSize chunkLimit = std::min(stagingRing->getMaxChunkSize(), budget.remaining);
+            uint32_t rows = static_cast<uint32_t>(std::min<VkDeviceSize>(blocksHigh - request.blockRow, std::max<VkDeviceSize>(1, chunkLimit / rowPitch)));
+            VkDeviceSize chunkSize = rowPitch * rows;
+
+            StagingAllocation staging;
+            if (!stagingRing->allocate(chunkSize, alignment, staging))
+            {
+                budget.ringFull = true;
+                return false;
+            }
+            memcpy(staging.mapped, static_cast<const char *>(level.data) + request.blockRow * rowPitch, static_cast<size_t>(chunkSize));
+
+            uint32_t y = request.blockRow * blockExtent.height;
+
+            VkBufferImageCopy region{};
+            region.bufferOffset = staging.offset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = upload.aspectMask;
+            region.imageSubresource.mipLevel = upload.baseMipLevel + request.level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = {0, static_cast<int32_t>(y), 0};
+            region.imageExtent = {
+                level.width,
+                std::min(rows * blockExtent.height, level.height - y),
+                1};
+            regions.push_back(region);
+
+            request.blockRow += rows;
+            budget.remaining -= std::min(chunkSize, budget.remaining);
+            pendingBytes -= chunkSize;
+        }
+
+        request.level++;
+        request.blockRow = 0;
+    }
+
+    return true;
+}
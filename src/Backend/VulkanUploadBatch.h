@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "VulkanStagingRing.h"
+#include "VulkanTransferQueue.h"
+
+/** @brief Source data of one mip level, tightly packed rows (or rows of blocks for compressed formats) */
+struct ImageLevelData
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const void *data = nullptr;
+};
+
+/** @brief Contents for a buffer range, readable by dstStage once the upload has been acquired */
+struct BufferUpload
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    const void *data = nullptr;
+    VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    VkAccessFlags dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+    /** @brief Called once all of data has been copied into staging memory, the source may be freed from here on */
+    std::function<void()> onStaged;
+    /** @brief Called with the transfer timeline value of the submission that completes the upload */
+    std::function<void(uint64_t)> onSubmitted;
+};
+
+/** @brief Contents for the mip levels of an image in UNDEFINED layout, left in finalLayout */
+struct ImageUpload
+{
+    VkImage image = VK_NULL_HANDLE;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    /** @brief levels[i] is written to mip level baseMipLevel + i */
+    std::vector<ImageLevelData> levels;
+    uint32_t baseMipLevel = 0;
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    VkAccessFlags dstAccess = VK_ACCESS_SHADER_READ_BIT;
+
+    std::function<void()> onStaged;
+    std::function<void(uint64_t)> onSubmitted;
+};
+
+/**
+ * @brief Collects uploads and records them into one transfer command buffer per flush
+ *
+ * A flush records a single barrier that moves every newly started image to TRANSFER_DST, one copy
+ * command per destination with all of its regions, and a single release barrier for everything that
+ * finished. With a byte budget set, flush() stops staging once the budget is used up and carries the
+ * remainder over to the next call; uploads are split on row boundaries so large textures stream in
+ * over several frames.
+ */
+class VulkanUploadBatch
+{
+public:
+    /** @param frameBudget Bytes staged per flush(), 0 for no limit */
+    void create(VulkanStagingRing &stagingRing, VulkanTransferQueue &transferQueue, VkDeviceSize frameBudget = 0);
+    void destroy();
+
+    void upload(const BufferUpload &upload);
+    void upload(const ImageUpload &upload);
+
+    /**
+     * @brief Records and submits queued uploads up to the frame budget
+     * @return Timeline value of the submission, 0 if nothing was queued
+     */
+    uint64_t flush();
+    /** @brief Submits everything that is queued, ignoring the budget */
+    uint64_t flushAll();
+
+    bool isEmpty() const { return requests.empty(); }
+    void setFrameBudget(VkDeviceSize budget) { frameBudget = budget; }
+    VkDeviceSize getFrameBudget() const { return frameBudget; }
+    /** @brief Bytes still waiting to be staged */
+    VkDeviceSize getPendingBytes() const { return pendingBytes; }
+
+private:
+    struct Request
+    {
+        bool isImage;
+        BufferUpload buffer;
+        ImageUpload image;
+
+        bool started = false;
+        /** @brief Bytes staged so far for buffers, current level and row of blocks for images */
+        VkDeviceSize bufferProgress = 0;
+        uint32_t level = 0;
+        uint32_t blockRow = 0;
+    };
+
+    VulkanStagingRing *stagingRing{nullptr};
+    VulkanTransferQueue *transferQueue{nullptr};
+    VkDeviceSize frameBudget = 0;
+    VkDeviceSize pendingBytes = 0;
+    std::deque<Request> requests;
+
+    struct StagingBudget
+    {
+        VkDeviceSize remaining;
+        bool ringFull;
+    };
+
+    uint64_t submitBatch(VkDeviceSize budget);
+    /** @brief Stages chunks of request until it is done, the budget is used up or the ring is full. Returns true once done */
+    bool stageBuffer(Request &request, StagingBudget &budget, std::vector<VkBufferCopy> &regions);
+    bool stageImage(Request &request, StagingBudget &budget, std::vector<VkBufferImageCopy> &regions);
+};
@@ -6,28 +6,107 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
-#include <fstream>
 #include <stdexcept>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <vector>
 #include <cstring>
 #include <cstdlib>
 #include <cstdint>
+#include <cstdio>
 #include <limits>
 #include <array>
 #include <optional>
 #include <set>
+#include <string>
+#include <mutex>
+
+#include <vulkan/utility/vk_format_utils.h>
+
+#include "Backend/AssetLoader.h"
+#include "Backend/AssetPack.h"
+#include "Backend/FramePacer.h"
+#include "Backend/JobSystem.h"
+#include "Backend/RenderQueue.h"
+#include "Backend/VulkanCommandCache.h"
+#include "Backend/VulkanCommandEncoder.h"
+#include "Backend/VulkanCommandRecorder.h"
+#include "Backend/VulkanFrameScheduler.h"
+#include "Backend/VulkanGpuCulling.h"
+#include "Backend/VulkanMemoryAllocator.h"
+#include "Backend/VulkanRenderGraph.h"
+#include "Backend/VulkanResourceStateTracker.h"
+#include "Backend/VulkanStagingRing.h"
+#include "Backend/VulkanTextureStreamer.h"
+#include "Backend/VulkanTransferQueue.h"
+#include "Backend/VulkanUploadBatch.h"
+
+// Built from res/ by the PackAssets target, the build points this at its output
+#ifndef ASSET_PACK_PATH
+#define ASSET_PACK_PATH "assets.pack"
+#endif
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// Bounds of FrameSettings::framesInFlight
+const uint32_t MIN_FRAMES_IN_FLIGHT = 1;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+// Seconds between the frame time reports in the window title
+const double FRAME_STATISTICS_INTERVAL = 1.0;
+
+/** @brief Latency versus throughput tuning, set from the command line */
+struct FrameSettings
+{
+    // Frames the CPU records ahead of the GPU, fewer cut latency and more absorb frame time spikes
+    uint32_t framesInFlight = 2;
+    // 0 asks for one more than the surface minimum, anything else is clamped to what the surface supports
+    uint32_t swapChainImageCount = 0;
+    // Falls back to FIFO, which every surface supports, when the surface lacks it
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    // Frames per second, 0 leaves pacing to the present mode
+    double frameRateLimit = 0.0;
+};
+
+enum class RecordingMode
+{
+    // Scene draws go straight into the frame's primary
+    Inline,
+    // Recorded into secondaries on several threads every frame
+    Parallel,
+    // Recorded into secondaries once and replayed until commandVersion changes. Direct draws push this
+    // frame's matrices, so they are recorded as for Parallel instead.
+    Cached
+};
+const RecordingMode RECORDING_MODE = RecordingMode::Cached;
+// Threads of the job system including the main thread, 0 uses every hardware thread. Recording for
+// RecordingMode::Parallel, transforms, CPU culling and asset decoding all run on them.
+const uint32_t JOB_THREADS = 0;
+// Objects per job when transforms are updated and culled, fewer are not worth queueing
+const uint32_t OBJECTS_PER_JOB = 256;
+// Pass ids of the command cache
+const uint32_t MAIN_PASS = 0;
+
+// Objects are laid out on a SCENE_GRID_SIZE x SCENE_GRID_SIZE grid, all sharing the one mesh
+const uint32_t SCENE_GRID_SIZE = 1;
+const float SCENE_GRID_SPACING = 1.5f;
+// Draws every object with one indirect call from a draw command buffer instead of a vkCmdDrawIndexed per object
+const bool GPU_DRIVEN_DRAWS = true;
+// Draws every object in one instanced call with transforms from a per instance vertex stream, takes precedence over GPU_DRIVEN_DRAWS
+const bool INSTANCED_DRAWS = false;
+// Culls the indirect draws in a compute pass against the frustum and the previous frame's depth, needs GPU_DRIVEN_DRAWS
+const bool GPU_CULLING = true;
+// Renders the main pass with VK_KHR_dynamic_rendering when the device has it, pipelines are created against the
+// attachment formats and no render pass or framebuffers exist
+const bool DYNAMIC_RENDERING = true;
+
+const VkDeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+// Bytes of streamed uploads staged per frame, 0 uploads everything queued at once
+const VkDeviceSize UPLOAD_FRAME_BUDGET = 4 * 1024 * 1024;
 
 const std::vector<const char *> validationLayers = {
     "VK_LAYER_KHRONOS_validation"};
@@ -67,6 +146,8 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    /** Transfer only family if the device has one, uploads go through the graphics family otherwise */
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete()
     {
@@ -120,11 +201,63 @@ struct Vertex
     }
 };
 
+// Per frame set, binding 0. The scene's rotation is folded into the view so no draw path needs a separate model matrix here.
 struct UniformBufferObject
 {
-    alignas(16) glm::mat4 model;
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
+    alignas(16) glm::mat4 viewProjection;
+};
+
+// Push constants of draws issued one by one, the only per object state such a draw changes
+struct DrawConstants
+{
+    glm::mat4 modelViewProjection;
+    uint32_t objectIndex;
+};
+
+// Per object entry of the object storage buffer, std430
+struct ObjectData
+{
+    alignas(16) glm::mat4 model;
+};
+
+// Per instance vertex attributes of instanced draws, read at binding 1
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::vec4 tint;
+
+    static VkVertexInputBindingDescription getBindingDescription()
+    {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(InstanceData);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return bindingDescription;
+    }
+
+    /** @brief The matrix takes one location per column, following the locations of Vertex */
+    static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
+
+        for (uint32_t column = 0; column < 4; column++)
+        {
+            attributeDescriptions[column].binding = 1;
+            attributeDescriptions[column].location = 3 + column;
+            attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[column].offset = offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+        }
+
+        attributeDescriptions[4].binding = 1;
+        attributeDescriptions[4].location = 7;
+        attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributeDescriptions[4].offset = offsetof(InstanceData, tint);
+
+        return attributeDescriptions;
+    }
 };
 
 const std::vector<Vertex> vertices = {
@@ -142,11 +275,101 @@ const std::vector<uint16_t> indices = {
     0, 1, 2, 2, 3, 0,
     4, 5, 6, 6, 7, 4};
 
+const char *getPresentModeName(VkPresentModeKHR presentMode)
+{
+    switch (presentMode)
+    {
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "fifo-relaxed";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "mailbox";
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "immediate";
+    default:
+        return "unknown";
+    }
+}
+
+/** @brief The whole of value as a decimal count, a typo must not silently become 0 */
+uint32_t parseCount(const std::string &option, const std::string &value)
+{
+    char *end = nullptr;
+    unsigned long count = std::strtoul(value.c_str(), &end, 10);
+    if (value.empty() || value[0] == '-' || *end != '\0' || count > UINT32_MAX)
+    {
+        throw std::runtime_error("invalid value " + value + " for " + option + ", expected a whole number!");
+    }
+    return static_cast<uint32_t>(count);
+}
+
+/** @brief The whole of value as a number that is not negative */
+double parseNonNegative(const std::string &option, const std::string &value)
+{
+    char *end = nullptr;
+    double number = std::strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0' || !(number >= 0.0) || std::isinf(number))
+    {
+        throw std::runtime_error("invalid value " + value + " for " + option + ", expected a number that is not negative!");
+    }
+    return number;
+}
+
+/** @brief Reads --frames-in-flight, --swapchain-images, --present-mode and --fps-limit */
+FrameSettings parseFrameSettings(int argc, char **argv)
+{
+    FrameSettings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            throw std::runtime_error("missing value for " + option + "!");
+        }
+        std::string value = argv[++i];
+
+        if (option == "--frames-in-flight")
+        {
+            settings.framesInFlight = parseCount(option, value);
+            if (settings.framesInFlight < MIN_FRAMES_IN_FLIGHT || settings.framesInFlight > MAX_FRAMES_IN_FLIGHT)
+            {
+                throw std::runtime_error("frames in flight must be between " + std::to_string(MIN_FRAMES_IN_FLIGHT) + " and " + std::to_string(MAX_FRAMES_IN_FLIGHT) + "!");
+            }
+        }
+        else if (option == "--swapchain-images")
+        {
+            settings.swapChainImageCount = parseCount(option, value);
+        }
+        else if (option == "--present-mode")
+        {
+            const VkPresentModeKHR presentModes[] = {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+            auto found = std::find_if(std::begin(presentModes), std::end(presentModes), [&](VkPresentModeKHR presentMode)
+                                      { return value == getPresentModeName(presentMode); });
+            if (found == std::end(presentModes))
+            {
+                throw std::runtime_error("unknown present mode " + value + ", expected fifo, fifo-relaxed, mailbox or immediate!");
+            }
+            settings.presentMode = *found;
+        }
+        else if (option == "--fps-limit")
+        {
+            settings.frameRateLimit = parseNonNegative(option, value);
+        }
+        else
+        {
+            throw std::runtime_error("unknown option " + option + "!");
+        }
+    }
+    return settings;
+}
+
 class HelloTriangleApplication
 {
 public:
-    void run()
+    void run(const FrameSettings &settings)
     {
+        this->settings = settings;
         initWindow();
         initVulkan();
         mainLoop();
@@ -165,37 +388,132 @@ private:
 
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueueHandle;
 
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
     std::vector<VkImageView> swapChainImageViews;
+    // Only without dynamic rendering, one per swapchain image
     std::vector<VkFramebuffer> swapChainFramebuffers;
 
-    VkRenderPass renderPass;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    bool dynamicRenderingEnabled = false;
+    PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
 
-    VkCommandPool commandPool;
+    // Created first and destroyed last, everything that splits work across threads runs on it
+    JobSystem jobSystem;
 
-    VkImage depthImage;
-    VkDeviceMemory depthImageMemory;
-    VkImageView depthImageView;
-
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-    VkImageView textureImageView;
+    VkCommandPool commandPool;
+    VulkanCommandRecorder commandRecorder;
+    VulkanCommandCache commandCache;
+    // Bumped whenever something recorded into cached secondaries changes: framebuffers, pipelines or descriptor set contents
+    uint64_t commandVersion = 0;
+
+    VulkanMemoryAllocator memoryAllocator;
+    VulkanStagingRing stagingRing;
+    VulkanTransferQueue transferQueue;
+    VulkanUploadBatch uploadBatch;
+    VulkanTextureStreamer textureStreamer;
+    uint64_t transferWaitValue = 0;
+
+    // Records every image barrier on the graphics queue, synchronization2 ones when the device has it
+    VulkanResourceStateTracker stateTracker;
+    bool synchronization2Enabled = false;
+
+    // Owns the depth buffer and synchronizes the passes of the frame, rebuilt with the swapchain
+    VulkanRenderGraph renderGraph;
+    RenderGraphResource swapChainTarget;
+    RenderGraphResource depthTarget;
+    // Swapchain image the graph renders to this frame
+    uint32_t frameImageIndex = 0;
+
+    AssetPack assetPack;
+    AssetLoader assetLoader;
+    AssetHandle textureAsset = 0;
+
+    // Bound until the texture has been decoded and uploaded
+    VkImage placeholderImage;
+    VulkanAllocation placeholderImageAllocation;
+    VkImageView placeholderImageView;
+
+    // Textures with a stored mip chain stream in coarsest level first
+    StreamedTextureId streamedTexture = VulkanTextureStreamer::INVALID_TEXTURE;
+
+    VkImage textureImage = VK_NULL_HANDLE;
+    VulkanAllocation textureImageAllocation;
+    VkImageView textureImageView = VK_NULL_HANDLE;
     VkSampler textureSampler;
+    struct MipmapRequest
+    {
+        VkImage image;
+        int32_t width;
+        int32_t height;
+        uint32_t mipLevels;
+    };
+    // Textures whose level 0 has been uploaded, the rest of the chain is blitted on the graphics queue
+    std::vector<MipmapRequest> pendingMipmaps;
+    // Bumped when a texture becomes usable, descriptor sets written against an older value are rewritten
+    uint32_t textureGeneration = 0;
+    std::vector<uint32_t> descriptorSetTextureGeneration;
 
     VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    VulkanAllocation vertexBufferAllocation;
     VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    VulkanAllocation indexBufferAllocation;
+
+    // Read by the vertex shader through firstInstance, one entry per object
+    std::vector<ObjectData> objects;
+    VkBuffer objectBuffer;
+    VulkanAllocation objectBufferAllocation;
+
+    // One VkDrawIndexedIndirectCommand per object and the number of valid commands
+    std::vector<VkDrawIndexedIndirectCommand> drawCommands;
+    VkBuffer drawCommandBuffer;
+    VulkanAllocation drawCommandBufferAllocation;
+    VkBuffer drawCountBuffer;
+    VulkanAllocation drawCountBufferAllocation;
+    uint32_t drawCountValue = 0;
+
+    bool indirectDrawsEnabled = false;
+    bool drawIndirectCountEnabled = false;
+    bool multiDrawIndirectEnabled = false;
+
+    // Bounding sphere of the mesh per object, read by the cull pass and by the CPU cull of the render queue
+    std::vector<glm::vec4> objectBounds;
+    VkBuffer boundsBuffer;
+    VulkanAllocation boundsBufferAllocation;
+    VulkanGpuCulling gpuCulling;
+    bool cullingEnabled = false;
+
+    // Written by the CPU every frame through a persistent mapping, one buffer per frame in flight
+    std::vector<VkBuffer> instanceBuffers;
+    std::vector<VulkanAllocation> instanceBuffersAllocation;
+    bool instancedDrawsEnabled = false;
+
+    // Orders the per object draws when they are not drawn indirectly, ids index renderQueueBindings
+    RenderQueue renderQueue;
+    RenderQueueBindings renderQueueBindings;
+    // Premultiplied per draw matrices of the draws in renderQueue, indexed by object
+    std::vector<DrawConstants> drawConstants;
+    // Written by the jobs of buildRenderQueue, bytes rather than bools so neighbouring objects can be written from separate threads
+    std::vector<uint8_t> objectVisible;
+    std::vector<float> objectDepths;
+
+    // Commands of every recorded draw range, merged by the recording threads
+    std::mutex encoderStatisticsMutex;
+    VulkanCommandEncoder::Statistics encoderStatistics;
+    // This frame's contents of the per frame set, also used to sort and cull on the CPU side
+    UniformBufferObject frameUniforms{};
 
     std::vector<VkBuffer> uniformBuffers;
-    std::vector<VkDeviceMemory> uniformBuffersMemory;
+    std::vector<VulkanAllocation> uniformBuffersAllocation;
     std::vector<void *> uniformBuffersMapped;
 
     VkDescriptorPool descriptorPool;
@@ -205,7 +523,12 @@ private:
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
+    // Frame N signals N on its timeline, which replaces a fence per frame in flight
+    VulkanFrameScheduler frameScheduler;
+    FrameSettings settings;
+    // Present mode of the current swapchain, settings.presentMode unless the surface lacks it
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    FramePacer framePacer;
     uint32_t currentFrame = 0;
 
     bool framebufferResized = false;
@@ -229,10 +552,14 @@ private:
 
     void initVulkan()
     {
+        jobSystem.create(JOB_THREADS);
+        openAssetPack();
         createInstance();
         setupDebugMessenger();
         createSurface();
         pickPhysicalDevice();
+        // Loading starts as soon as supported formats can be queried and overlaps with everything below
+        createAssetLoader();
         createLogicalDevice();
         createSwapChain();
         createImageViews();
@@ -241,20 +568,35 @@ private:
         createGraphicsPipeline();
 
         createCommandPool();
-        createDepthResources();
+        createCommandRecorder();
+        createTransferQueue();
+        createStagingRing();
+        createUploadBatch();
+        createTextureStreamer();
+        createRenderGraph();
 
-        createFramebuffers();
+        if (!dynamicRenderingEnabled)
+        {
+            createFramebuffers();
+        }
 
-        createTextureImage();
-        createTextureImageView();
+        createPlaceholderTexture();
         createTextureSampler();
 
         createVertexBuffer();
         createIndexBuffer();
+        createObjectBuffer();
+        createObjectBounds();
+        createDrawCommandBuffers();
+        createGpuCulling();
+        createInstanceBuffers();
+        // Everything needed for the first frame goes out in one submission
+        uploadBatch.flushAll();
         createUniformBuffers();
 
         createDescriptorPool();
         createDescriptorSets();
+        createRenderQueue();
 
         createCommandBuffers();
         createSyncObjects();
@@ -262,73 +604,120 @@ private:
 
     void mainLoop()
     {
+        framePacer.create(settings.frameRateLimit);
+
         while (!glfwWindowShouldClose(window))
         {
+            // Polling after the limiter's wait keeps the input as fresh as possible
+            framePacer.beginFrame();
             glfwPollEvents();
             drawFrame();
+
+            FrameTimeStatistics statistics;
+            if (framePacer.collect(FRAME_STATISTICS_INTERVAL, statistics))
+            {
+                char title[160];
+                std::snprintf(title, sizeof(title), "Vulkan - %.2f ms (%.0f fps), 99%% %.2f ms, max %.2f ms, limiter %.2f ms", statistics.averageMs, statistics.getFrameRate(),
+                              statistics.percentile99Ms, statistics.maxMs, statistics.limiterWaitMs);
+                glfwSetWindowTitle(window, title);
+            }
         }
 
         vkDeviceWaitIdle(device);
+
+        FrameTimeStatistics total = framePacer.getTotal();
+        std::printf("%u frames in flight, %zu swapchain images, %s, limit %.0f fps: %u frames, %.2f ms average (%.0f fps), min %.2f ms, max %.2f ms, limiter %.2f ms\n",
+                    settings.framesInFlight, swapChainImages.size(), getPresentModeName(presentMode), settings.frameRateLimit, total.frameCount, total.averageMs,
+                    total.getFrameRate(), total.minMs, total.maxMs, total.limiterWaitMs);
+
+        // Cached secondaries are only counted when they are recorded, not every time they are executed
+        std::printf("recorded %llu state and draw commands, %llu redundant ones elided\n",
+                    static_cast<unsigned long long>(encoderStatistics.getIssuedTotal()),
+                    static_cast<unsigned long long>(encoderStatistics.getElidedTotal()));
+
+        const VulkanResourceStateTracker::Statistics &barriers = stateTracker.getStatistics();
+        std::printf("%s barriers: %u batches, %u image and %u buffer barriers, %u uses needed none\n", synchronization2Enabled ? "synchronization2" : "legacy",
+                    barriers.batches, barriers.imageBarriers, barriers.bufferBarriers, barriers.overSynchronization);
     }
 
     void cleanupSwapChain()
     {
-        vkDestroyImageView(device, depthImageView, nullptr);
-        vkDestroyImage(device, depthImage, nullptr);
-        vkFreeMemory(device, depthImageMemory, nullptr);
+        renderGraph.reset();
+        destroySwapChain(swapChain, swapChainImageViews, swapChainFramebuffers);
+    }
 
-        for (auto framebuffer : swapChainFramebuffers)
+    void destroySwapChain(VkSwapchainKHR retiredSwapChain, const std::vector<VkImageView> &imageViews, const std::vector<VkFramebuffer> &framebuffers)
+    {
+        for (auto framebuffer : framebuffers)
         {
             vkDestroyFramebuffer(device, framebuffer, nullptr);
         }
 
-        for (auto imageView : swapChainImageViews)
+        for (auto imageView : imageViews)
         {
             vkDestroyImageView(device, imageView, nullptr);
         }
 
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        vkDestroySwapchainKHR(device, retiredSwapChain, nullptr);
     }
 
     void cleanup()
     {
         cleanupSwapChain();
+        renderGraph.destroy();
+        stateTracker.destroy();
 
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
         vkDestroyRenderPass(device, renderPass, nullptr);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        for (size_t i = 0; i < settings.framesInFlight; i++)
         {
-            vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-            vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+            memoryAllocator.destroyBuffer(uniformBuffers[i], uniformBuffersAllocation[i]);
         }
 
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
         vkDestroySampler(device, textureSampler, nullptr);
         vkDestroyImageView(device, textureImageView, nullptr);
+        vkDestroyImageView(device, placeholderImageView, nullptr);
 
-        vkDestroyImage(device, textureImage, nullptr);
-        vkFreeMemory(device, textureImageMemory, nullptr);
+        memoryAllocator.destroyImage(textureImage, textureImageAllocation);
+        memoryAllocator.destroyImage(placeholderImage, placeholderImageAllocation);
 
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
-        vkDestroyBuffer(device, indexBuffer, nullptr);
-        vkFreeMemory(device, indexBufferMemory, nullptr);
-
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
+        for (size_t i = 0; i < instanceBuffers.size(); i++)
+        {
+            memoryAllocator.destroyBuffer(instanceBuffers[i], instanceBuffersAllocation[i]);
+        }
+        gpuCulling.destroy();
+        memoryAllocator.destroyBuffer(boundsBuffer, boundsBufferAllocation);
+        memoryAllocator.destroyBuffer(drawCountBuffer, drawCountBufferAllocation);
+        memoryAllocator.destroyBuffer(drawCommandBuffer, drawCommandBufferAllocation);
+        memoryAllocator.destroyBuffer(objectBuffer, objectBufferAllocation);
+        memoryAllocator.destroyBuffer(indexBuffer, indexBufferAllocation);
+        memoryAllocator.destroyBuffer(vertexBuffer, vertexBufferAllocation);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        for (size_t i = 0; i < settings.framesInFlight; i++)
         {
             vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
             vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(device, inFlightFences[i], nullptr);
         }
+        frameScheduler.destroy();
 
+        commandCache.destroy();
+        commandRecorder.destroy();
         vkDestroyCommandPool(device, commandPool, nullptr);
 
+        uploadBatch.destroy();
+        textureStreamer.destroy();
+        assetLoader.destroy();
+        jobSystem.destroy();
+        assetPack.close();
+        stagingRing.destroy();
+        transferQueue.destroy();
+        memoryAllocator.destroy();
         vkDestroyDevice(device, nullptr);
 
         if (enableValidationLayers)
@@ -354,14 +743,34 @@ private:
             glfwWaitEvents();
         }
 
-        vkDeviceWaitIdle(device);
+        // Frames in flight may still render to the old images and depth buffer, so they are retired instead of
+        // waiting for the device and destroyed once the next frame has completed
+        RetireFunction retire = [this](std::function<void()> destroy)
+        { frameScheduler.defer(std::move(destroy)); };
 
-        cleanupSwapChain();
+        VkSwapchainKHR oldSwapChain = swapChain;
+        std::vector<VkImageView> oldImageViews;
+        std::vector<VkFramebuffer> oldFramebuffers;
+        oldImageViews.swap(swapChainImageViews);
+        oldFramebuffers.swap(swapChainFramebuffers);
+        renderGraph.reset(retire);
 
         createSwapChain();
+        retire([this, oldSwapChain, oldImageViews, oldFramebuffers]()
+               { destroySwapChain(oldSwapChain, oldImageViews, oldFramebuffers); });
+
         createImageViews();
-        createDepthResources();
-        createFramebuffers();
+        buildRenderGraph();
+        if (!dynamicRenderingEnabled)
+        {
+            createFramebuffers();
+        }
+        if (cullingEnabled)
+        {
+            setCullingDepthImage(retire);
+        }
+
+        commandVersion++;
     }
 
     void createInstance()
@@ -377,7 +786,7 @@ private:
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -473,7 +882,8 @@ private:
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+        uint32_t transferFamily = indices.transferFamily.value_or(indices.graphicsFamily.value());
+        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value(), transferFamily};
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -486,19 +896,69 @@ private:
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+        supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 supportedFeatures{};
+        supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures.pNext = &supportedFeatures12;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+        // Indirect draws select their object through firstInstance, without it every object is drawn directly
+        instancedDrawsEnabled = INSTANCED_DRAWS;
+        indirectDrawsEnabled = GPU_DRIVEN_DRAWS && !instancedDrawsEnabled && supportedFeatures.features.drawIndirectFirstInstance;
+        multiDrawIndirectEnabled = indirectDrawsEnabled && supportedFeatures.features.multiDrawIndirect;
+        drawIndirectCountEnabled = multiDrawIndirectEnabled && supportedFeatures12.drawIndirectCount;
+        cullingEnabled = GPU_CULLING && indirectDrawsEnabled;
+
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.textureCompressionBC = supportsTextureCompressionBC();
+        deviceFeatures.drawIndirectFirstInstance = indirectDrawsEnabled;
+        deviceFeatures.multiDrawIndirect = multiDrawIndirectEnabled;
+
+        // Core in 1.3 only, on 1.2 it is the extension
+        synchronization2Enabled = supportsDeviceExtension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        std::vector<const char *> enabledExtensions = deviceExtensions;
+
+        VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+        synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+        synchronization2Features.synchronization2 = VK_TRUE;
+
+        // Both features are required of devices that expose their extension
+        dynamicRenderingEnabled = DYNAMIC_RENDERING && supportsDeviceExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        features12.timelineSemaphore = VK_TRUE;
+        features12.drawIndirectCount = drawIndirectCountEnabled;
+        if (synchronization2Enabled)
+        {
+            synchronization2Features.pNext = features12.pNext;
+            features12.pNext = &synchronization2Features;
+            enabledExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        }
+        if (dynamicRenderingEnabled)
+        {
+            dynamicRenderingFeatures.pNext = features12.pNext;
+            features12.pNext = &dynamicRenderingFeatures;
+            enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        }
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &features12;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         if (enableValidationLayers)
         {
@@ -517,6 +977,16 @@ private:
 
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        vkGetDeviceQueue(device, transferFamily, 0, &transferQueueHandle);
+
+        memoryAllocator.init(physicalDevice, device);
+        stateTracker.create(device, synchronization2Enabled);
+
+        if (dynamicRenderingEnabled)
+        {
+            cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR"));
+            cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR"));
+        }
     }
 
     void createSwapChain()
@@ -524,10 +994,11 @@ private:
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-        VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+        presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
         VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-        uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+        uint32_t imageCount = settings.swapChainImageCount > 0 ? settings.swapChainImageCount : swapChainSupport.capabilities.minImageCount + 1;
+        imageCount = std::max(imageCount, swapChainSupport.capabilities.minImageCount);
         if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
         {
             imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -562,6 +1033,8 @@ private:
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         createInfo.presentMode = presentMode;
         createInfo.clipped = VK_TRUE;
+        // Lets the presentation engine hand over from the swapchain being replaced, if there is one
+        createInfo.oldSwapchain = swapChain;
 
         if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
         {
@@ -582,12 +1055,19 @@ private:
 
         for (uint32_t i = 0; i < swapChainImages.size(); i++)
         {
-            swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+            swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
         }
     }
 
     void createRenderPass()
     {
+        depthFormat = findDepthFormat();
+        if (dynamicRenderingEnabled)
+        {
+            // The pipelines and the main pass name the attachments themselves
+            return;
+        }
+
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format = swapChainImageFormat;
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -595,17 +1075,19 @@ private:
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // The render graph does the layout transitions and synchronization around the pass
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
         VkAttachmentDescription depthAttachment{};
-        depthAttachment.format = findDepthFormat();
+        depthAttachment.format = depthFormat;
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        // The depth pyramid for the next frame's cull is built from it after the pass
+        depthAttachment.storeOp = cullingEnabled ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference colorAttachmentRef{};
@@ -622,14 +1104,6 @@ private:
         subpass.pColorAttachments = &colorAttachmentRef;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-        VkSubpassDependency dependency{};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
         std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -637,8 +1111,6 @@ private:
         renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
 
         if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
         {
@@ -662,7 +1134,14 @@ private:
         samplerLayoutBinding.pImmutableSamplers = nullptr;
         samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+        VkDescriptorSetLayoutBinding objectLayoutBinding{};
+        objectLayoutBinding.binding = 2;
+        objectLayoutBinding.descriptorCount = 1;
+        objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        objectLayoutBinding.pImmutableSamplers = nullptr;
+        objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+        std::array<VkDescriptorSetLayoutBinding, 3> bindings = {uboLayoutBinding, samplerLayoutBinding, objectLayoutBinding};
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -676,11 +1155,18 @@ private:
 
     void createGraphicsPipeline()
     {
-        auto vertShaderCode = readFile("D:/Dev/Graphics Proj/Engine/res/shaders/vert.spv");
-        auto fragShaderCode = readFile("D:/Dev/Graphics Proj/Engine/res/shaders/frag.spv");
-
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+        // Each draw path has its own vertex shader variant for where the per object transform comes from
+        const char *vertShaderName = "shaders/direct.vert.spv";
+        if (instancedDrawsEnabled)
+        {
+            vertShaderName = "shaders/instanced.vert.spv";
+        }
+        else if (indirectDrawsEnabled)
+        {
+            vertShaderName = "shaders/object.vert.spv";
+        }
+        VkShaderModule vertShaderModule = createShaderModule(vertShaderName);
+        VkShaderModule fragShaderModule = createShaderModule("shaders/frag.spv");
 
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -699,12 +1185,21 @@ private:
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions = {Vertex::getBindingDescription()};
+        auto vertexAttributeDescriptions = Vertex::getAttributeDescriptions();
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(vertexAttributeDescriptions.begin(), vertexAttributeDescriptions.end());
 
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        // Instanced draws add the per instance stream
+        if (instancedDrawsEnabled)
+        {
+            bindingDescriptions.push_back(InstanceData::getBindingDescription());
+            auto instanceAttributeDescriptions = InstanceData::getAttributeDescriptions();
+            attributeDescriptions.insert(attributeDescriptions.end(), instanceAttributeDescriptions.begin(), instanceAttributeDescriptions.end());
+        }
+
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -763,18 +1258,33 @@ private:
         dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
         dynamicState.pDynamicStates = dynamicStates.data();
 
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DrawConstants);
+
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = 1;
         pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
         if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create pipeline layout!");
         }
 
+        // The depth view leaves out stencil, so only depth is rendered to
+        VkPipelineRenderingCreateInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachmentFormats = &swapChainImageFormat;
+        renderingInfo.depthAttachmentFormat = depthFormat;
+
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.pNext = dynamicRenderingEnabled ? &renderingInfo : nullptr;
         pipelineInfo.stageCount = 2;
         pipelineInfo.pStages = shaderStages;
         pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -795,6 +1305,7 @@ private:
             throw std::runtime_error("failed to create graphics pipeline!");
         }
 
+
         vkDestroyShaderModule(device, fragShaderModule, nullptr);
         vkDestroyShaderModule(device, vertShaderModule, nullptr);
     }
@@ -807,7 +1318,7 @@ private:
         {
             std::array<VkImageView, 2> attachments = {
                 swapChainImageViews[i],
-                depthImageView};
+                renderGraph.getImageView(depthTarget)};
 
             VkFramebufferCreateInfo framebufferInfo{};
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -840,12 +1351,85 @@ private:
         }
     }
 
-    void createDepthResources()
+    void createCommandRecorder()
+    {
+        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+        commandRecorder.create(device, queueFamilyIndices.graphicsFamily.value(), settings.framesInFlight, jobSystem);
+        commandCache.create(device, queueFamilyIndices.graphicsFamily.value(), settings.framesInFlight);
+    }
+
+    void createTransferQueue()
     {
+        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+        uint32_t graphicsFamily = queueFamilyIndices.graphicsFamily.value();
+
+        transferQueue.create(device, transferQueueHandle, queueFamilyIndices.transferFamily.value_or(graphicsFamily), graphicsFamily);
+    }
+
+    void createStagingRing()
+    {
+        stagingRing.create(device, memoryAllocator, STAGING_RING_SIZE);
+    }
+
+    void createUploadBatch()
+    {
+        uploadBatch.create(stagingRing, transferQueue, UPLOAD_FRAME_BUDGET);
+    }
+
+    void createTextureStreamer()
+    {
+        textureStreamer.create(device, memoryAllocator, uploadBatch, settings.framesInFlight, [this]()
+                               { textureGeneration++; });
+    }
+
+    void createRenderGraph()
+    {
+        renderGraph.create(device, memoryAllocator, stateTracker);
+        buildRenderGraph();
+    }
+
+    /** @brief Describes the frame for the current swapchain, the graph creates the depth buffer and synchronizes the passes */
+    void buildRenderGraph()
+    {
+        RenderGraphImportedImage target{};
+        target.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        target.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // The acquire semaphore is waited on at this stage
+        target.initialStages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        target.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        swapChainTarget = renderGraph.importImage("swapchain", target);
+
         VkFormat depthFormat = findDepthFormat();
+        RenderGraphImageDesc depthDesc{};
+        depthDesc.format = depthFormat;
+        depthDesc.extent = swapChainExtent;
+        depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(depthFormat) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+        depthTarget = renderGraph.createImage("depth", depthDesc);
+
+        if (cullingEnabled)
+        {
+            // Writes the indirect commands of the main pass, buffers the cull synchronizes itself
+            RenderGraphPass cull = renderGraph.addPass("cull", [this](VkCommandBuffer commandBuffer)
+                                                       { gpuCulling.recordCull(commandBuffer, currentFrame); });
+            renderGraph.setSideEffects(cull);
+        }
 
-        createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
-        depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+        RenderGraphPass main = renderGraph.addPass("main", [this](VkCommandBuffer commandBuffer)
+                                                   { recordMainPass(commandBuffer, frameImageIndex); });
+        renderGraph.use(main, swapChainTarget, RenderGraphUsage::ColorAttachment);
+        renderGraph.use(main, depthTarget, RenderGraphUsage::DepthAttachment);
+
+        if (cullingEnabled)
+        {
+            // Only read by the next frame's cull, so nothing in this graph depends on it
+            RenderGraphPass pyramid = renderGraph.addPass("depth pyramid", [this](VkCommandBuffer commandBuffer)
+                                                          { gpuCulling.recordDepthPyramid(commandBuffer); });
+            renderGraph.use(pyramid, depthTarget, RenderGraphUsage::SampledCompute);
+            renderGraph.setSideEffects(pyramid);
+        }
+
+        renderGraph.compile();
     }
 
     VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
@@ -873,7 +1457,7 @@ private:
         return findSupportedFormat(
             {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
             VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | (cullingEnabled ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0));
     }
 
     bool hasStencilComponent(VkFormat format)
@@ -881,41 +1465,189 @@ private:
         return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
     }
 
-    void createTextureImage()
+    void openAssetPack()
+    {
+        if (!assetPack.open(ASSET_PACK_PATH))
+        {
+            throw std::runtime_error("failed to open asset pack!");
+        }
+    }
+
+    void createAssetLoader()
     {
-        int texWidth, texHeight, texChannels;
-        stbi_uc *pixels = stbi_load("D:/Dev/Graphics Proj/Engine/res/textures/textures.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-        VkDeviceSize imageSize = texWidth * texHeight * 4;
+        assetLoader.create([this](VkFormat format)
+                           { return isTextureFormatSupported(format); },
+                           jobSystem, &assetPack);
 
-        if (!pixels)
+        // Cooked by the CookTextures target
+        textureAsset = assetLoader.loadImage("textures/textures.ktx2");
+    }
+
+    bool supportsDeviceExtension(const char *name)
+    {
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+        return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties &extension)
+                           { return strcmp(extension.extensionName, name) == 0; });
+    }
+
+    VkBool32 supportsTextureCompressionBC()
+    {
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        return supportedFeatures.textureCompressionBC;
+    }
+
+    bool isTextureFormatSupported(VkFormat format)
+    {
+        if (vkuFormatIsCompressed_BC(format) && !supportsTextureCompressionBC())
+        {
+            return false;
+        }
+
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+
+        VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+        return (props.optimalTilingFeatures & features) == features;
+    }
+
+    void createPlaceholderTexture()
+    {
+        // 2x2 magenta and black checker, RGBA
+        static const uint32_t pixels[] = {0xffff00ff, 0xff000000, 0xff000000, 0xffff00ff};
+
+        createImage(2, 2, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, placeholderImage, placeholderImageAllocation);
+        placeholderImageView = createImageView(placeholderImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+        ImageUpload upload{};
+        upload.image = placeholderImage;
+        upload.format = VK_FORMAT_R8G8B8A8_SRGB;
+        upload.levels.push_back({2, 2, pixels});
+        uploadBatch.upload(upload);
+    }
+
+    void processLoadedAssets()
+    {
+        std::vector<LoadedImage> loaded;
+        assetLoader.collectLoaded(loaded);
+
+        for (LoadedImage &image : loaded)
+        {
+            if (image.handle == textureAsset)
+            {
+                createTextureImage(image);
+            }
+        }
+    }
+
+    void createTextureImage(const LoadedImage &image)
+    {
+        if (!image.pixels)
         {
             throw std::runtime_error("failed to load texture image!");
         }
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        // Cooked textures carry their mip chain and become visible as soon as the smallest level is uploaded
+        if (image.levels.size() > 1 || vkuFormatIsCompressed(image.format))
+        {
+            streamedTexture = textureStreamer.add(image);
+            return;
+        }
 
-        void *data;
-        vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(device, stagingBufferMemory);
+        // A single uncompressed level gets the rest of the chain blitted
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, image.format, &formatProperties);
 
-        stbi_image_free(pixels);
+        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+        {
+            throw std::runtime_error("texture image format does not support linear blitting!");
+        }
 
-        createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+        uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(image.width, image.height)))) + 1;
 
-        transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-        transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        createImage(image.width, image.height, mipLevels, image.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
+        textureImageView = createImageView(textureImage, image.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        // Streams in under the frame budget. Level 0 arrives on the graphics queue as a blit source and the rest is
+        // generated in the frame that switches the descriptors over
+        ImageUpload upload{};
+        upload.image = textureImage;
+        upload.format = image.format;
+        upload.levels.push_back({image.levels[0].width, image.levels[0].height, image.pixels + image.levels[0].offset});
+        upload.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        upload.dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        upload.dstAccess = VK_ACCESS_TRANSFER_READ_BIT;
+        // Pixels inside the asset pack are copied from the mapping into staging and need no release
+        std::shared_ptr<const unsigned char> storage = image.storage;
+        upload.onStaged = [storage]() mutable
+        {
+            storage.reset();
+        };
+        VkImage mipmappedImage = textureImage;
+        int32_t texWidth = static_cast<int32_t>(image.width);
+        int32_t texHeight = static_cast<int32_t>(image.height);
+        upload.onSubmitted = [this, mipmappedImage, texWidth, texHeight, mipLevels](uint64_t)
+        {
+            pendingMipmaps.push_back({mipmappedImage, texWidth, texHeight, mipLevels});
+            textureGeneration++;
+        };
+        uploadBatch.upload(upload);
     }
 
-    void createTextureImageView()
+    void generateMipmaps(VkCommandBuffer commandBuffer, const MipmapRequest &request)
     {
-        textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+        VkImageSubresourceRange level0 = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        VkImageSubresourceRange chain = {VK_IMAGE_ASPECT_COLOR_BIT, 1, VK_REMAINING_MIP_LEVELS, 0, 1};
+
+        // Level 0 arrives through the acquire barrier ready to be blitted from, the other levels are still undefined
+        stateTracker.trackImage(request.image, VK_IMAGE_ASPECT_COLOR_BIT, request.mipLevels, 1);
+        stateTracker.setImageState(request.image, level0, getResourceState(ResourceUsage::BlitSource));
+        if (request.mipLevels > 1)
+            stateTracker.useImage(request.image, chain, ResourceUsage::BlitDestination);
+
+        int32_t mipWidth = request.width;
+        int32_t mipHeight = request.height;
+
+        for (uint32_t i = 1; i < request.mipLevels; i++)
+        {
+            // The level written by the previous blit becomes the source of this one
+            stateTracker.useImage(request.image, {VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1, 0, 1}, ResourceUsage::BlitSource);
+            stateTracker.flush(commandBuffer);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = i - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = i;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(commandBuffer,
+                           request.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           request.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &blit,
+                           VK_FILTER_LINEAR);
+
+            if (mipWidth > 1)
+                mipWidth /= 2;
+            if (mipHeight > 1)
+                mipHeight /= 2;
+        }
+
+        // The levels that were read share one barrier, the last level written gets its own
+        stateTracker.useImage(request.image, ResourceUsage::SampledFragment);
+        stateTracker.flush(commandBuffer);
+        stateTracker.forgetImage(request.image);
     }
 
     void createTextureSampler()
@@ -937,6 +1669,10 @@ private:
         samplerInfo.compareEnable = VK_FALSE;
         samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        // Shared by every texture, streamed ones clamp to their resident levels through the base level of their view
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        samplerInfo.mipLodBias = 0.0f;
 
         if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
         {
@@ -944,7 +1680,7 @@ private:
         }
     }
 
-    VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+    VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
     {
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -953,7 +1689,7 @@ private:
         viewInfo.format = format;
         viewInfo.subresourceRange.aspectMask = aspectFlags;
         viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.levelCount = mipLevels;
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount = 1;
 
@@ -966,7 +1702,7 @@ private:
         return imageView;
     }
 
-    void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory)
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VulkanAllocation &imageAllocation)
     {
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -974,7 +1710,7 @@ private:
         imageInfo.extent.width = width;
         imageInfo.extent.height = height;
         imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
+        imageInfo.mipLevels = mipLevels;
         imageInfo.arrayLayers = 1;
         imageInfo.format = format;
         imageInfo.tiling = tiling;
@@ -983,173 +1719,225 @@ private:
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create image!");
-        }
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device, image, &memRequirements);
+        memoryAllocator.createImage(imageInfo, properties, image, imageAllocation);
+    }
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    void createVertexBuffer()
+    {
+        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferAllocation);
 
-        vkBindImageMemory(device, image, imageMemory, 0);
+        BufferUpload upload{};
+        upload.buffer = vertexBuffer;
+        upload.size = bufferSize;
+        upload.data = vertices.data();
+        upload.dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        upload.dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        uploadBatch.upload(upload);
     }
 
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+    void createIndexBuffer()
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = oldLayout;
-        barrier.newLayout = newLayout;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = image;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferAllocation);
 
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
+        BufferUpload upload{};
+        upload.buffer = indexBuffer;
+        upload.size = bufferSize;
+        upload.data = indices.data();
+        upload.dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        upload.dstAccess = VK_ACCESS_INDEX_READ_BIT;
+        uploadBatch.upload(upload);
+    }
 
-        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+    void createObjectBuffer()
+    {
+        // Centred on the origin so a single object stays where the mesh always was
+        float gridOffset = (SCENE_GRID_SIZE - 1) * SCENE_GRID_SPACING * 0.5f;
+        for (uint32_t y = 0; y < SCENE_GRID_SIZE; y++)
         {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            for (uint32_t x = 0; x < SCENE_GRID_SIZE; x++)
+            {
+                ObjectData object{};
+                object.model = glm::translate(glm::mat4(1.0f), glm::vec3(x * SCENE_GRID_SPACING - gridOffset, y * SCENE_GRID_SPACING - gridOffset, 0.0f));
+                objects.push_back(object);
+            }
         }
-        else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-        {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        }
-        else
-        {
-            throw std::invalid_argument("unsupported layout transition!");
-        }
+        VkDeviceSize bufferSize = sizeof(objects[0]) * objects.size();
 
-        vkCmdPipelineBarrier(
-            commandBuffer,
-            sourceStage, destinationStage,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier);
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, objectBuffer, objectBufferAllocation);
 
-        endSingleTimeCommands(commandBuffer);
+        BufferUpload upload{};
+        upload.buffer = objectBuffer;
+        upload.size = bufferSize;
+        upload.data = objects.data();
+        upload.dstStage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        upload.dstAccess = VK_ACCESS_SHADER_READ_BIT;
+        uploadBatch.upload(upload);
     }
 
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+    void createDrawCommandBuffers()
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        for (uint32_t object = 0; object < objects.size(); object++)
+        {
+            VkDrawIndexedIndirectCommand command{};
+            command.indexCount = static_cast<uint32_t>(indices.size());
+            command.instanceCount = 1;
+            command.firstIndex = 0;
+            command.vertexOffset = 0;
+            command.firstInstance = object;
+            drawCommands.push_back(command);
+        }
+        drawCountValue = static_cast<uint32_t>(drawCommands.size());
 
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {
-            width,
-            height,
-            1};
+        // Storage usage so the commands and count can later be produced on the GPU
+        VkDeviceSize bufferSize = sizeof(drawCommands[0]) * drawCommands.size();
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     drawCommandBuffer, drawCommandBufferAllocation);
+        createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     drawCountBuffer, drawCountBufferAllocation);
 
-        vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        BufferUpload commandUpload{};
+        commandUpload.buffer = drawCommandBuffer;
+        commandUpload.size = bufferSize;
+        commandUpload.data = drawCommands.data();
+        commandUpload.dstStage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        commandUpload.dstAccess = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        uploadBatch.upload(commandUpload);
 
-        endSingleTimeCommands(commandBuffer);
+        BufferUpload countUpload{};
+        countUpload.buffer = drawCountBuffer;
+        countUpload.size = sizeof(uint32_t);
+        countUpload.data = &drawCountValue;
+        countUpload.dstStage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+        countUpload.dstAccess = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        uploadBatch.upload(countUpload);
     }
 
-    void createVertexBuffer()
+    void createInstanceBuffers()
     {
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+        if (!instancedDrawsEnabled)
+        {
+            return;
+        }
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        VkDeviceSize bufferSize = sizeof(InstanceData) * objects.size();
 
-        void *data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
+        instanceBuffers.resize(settings.framesInFlight);
+        instanceBuffersAllocation.resize(settings.framesInFlight);
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+        for (size_t i = 0; i < settings.framesInFlight; i++)
+        {
+            createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[i], instanceBuffersAllocation[i]);
+        }
+    }
 
-        copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    /** @brief Refreshes this frame's instance stream, the GPU is done with it once the frame's slot has been handed out again */
+    void updateInstanceBuffer(uint32_t currentImage)
+    {
+        InstanceData *instances = static_cast<InstanceData *>(instanceBuffersAllocation[currentImage].mapped);
+        jobSystem.parallelFor(static_cast<uint32_t>(objects.size()), OBJECTS_PER_JOB, [this, instances](uint32_t begin, uint32_t end)
+                              {
+            for (uint32_t object = begin; object < end; object++)
+            {
+                instances[object].model = objects[object].model;
+                instances[object].tint = glm::vec4(1.0f);
+            } });
+    }
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+    void createObjectBounds()
+    {
+        // One sphere around the mesh's bounding box, shared by every object
+        glm::vec3 minimum = vertices[0].pos;
+        glm::vec3 maximum = vertices[0].pos;
+        for (const Vertex &vertex : vertices)
+        {
+            minimum = glm::min(minimum, vertex.pos);
+            maximum = glm::max(maximum, vertex.pos);
+        }
+        glm::vec3 center = (minimum + maximum) * 0.5f;
+        float radius = 0.0f;
+        for (const Vertex &vertex : vertices)
+        {
+            radius = std::max(radius, glm::length(vertex.pos - center));
+        }
+
+        objectBounds.assign(objects.size(), glm::vec4(center, radius));
     }
 
-    void createIndexBuffer()
+    void createGpuCulling()
     {
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+        if (!cullingEnabled)
+        {
+            return;
+        }
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        VkDeviceSize bufferSize = sizeof(objectBounds[0]) * objectBounds.size();
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, boundsBuffer, boundsBufferAllocation);
 
-        void *data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
+        BufferUpload upload{};
+        upload.buffer = boundsBuffer;
+        upload.size = bufferSize;
+        upload.data = objectBounds.data();
+        upload.dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        upload.dstAccess = VK_ACCESS_SHADER_READ_BIT;
+        uploadBatch.upload(upload);
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+        CullingInputs inputs{};
+        inputs.objectBuffer = objectBuffer;
+        inputs.boundsBuffer = boundsBuffer;
+        inputs.drawCommandBuffer = drawCommandBuffer;
+        inputs.objectCount = static_cast<uint32_t>(objects.size());
 
-        copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+        // Without drawIndirectCount culled commands stay in place with no instances
+        VkShaderModule cullShaderModule = createShaderModule("shaders/cull.comp.spv");
+        VkShaderModule pyramidShaderModule = createShaderModule("shaders/depthpyramid.comp.spv");
+        gpuCulling.create(device, memoryAllocator, settings.framesInFlight, inputs, cullShaderModule, pyramidShaderModule, drawIndirectCountEnabled);
+        vkDestroyShaderModule(device, pyramidShaderModule, nullptr);
+        vkDestroyShaderModule(device, cullShaderModule, nullptr);
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        setCullingDepthImage();
+    }
+
+    void setCullingDepthImage(const RetireFunction &retire = nullptr)
+    {
+        gpuCulling.setDepthImage(renderGraph.getImageView(depthTarget), swapChainExtent.width, swapChainExtent.height, retire);
     }
 
     void createUniformBuffers()
     {
         VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-        uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-        uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+        uniformBuffers.resize(settings.framesInFlight);
+        uniformBuffersAllocation.resize(settings.framesInFlight);
+        uniformBuffersMapped.resize(settings.framesInFlight);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        for (size_t i = 0; i < settings.framesInFlight; i++)
         {
-            createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+            createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersAllocation[i]);
 
-            vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+            uniformBuffersMapped[i] = uniformBuffersAllocation[i].mapped;
         }
     }
 
     void createDescriptorPool()
     {
-        std::array<VkDescriptorPoolSize, 2> poolSizes{};
+        std::array<VkDescriptorPoolSize, 3> poolSizes{};
         poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[0].descriptorCount = settings.framesInFlight;
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[1].descriptorCount = settings.framesInFlight;
+        poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSizes[2].descriptorCount = settings.framesInFlight;
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
         poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolInfo.maxSets = settings.framesInFlight;
 
         if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
         {
@@ -1159,187 +1947,346 @@ private:
 
     void createDescriptorSets()
     {
-        std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+        std::vector<VkDescriptorSetLayout> layouts(settings.framesInFlight, descriptorSetLayout);
         VkDescriptorSetAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocInfo.descriptorPool = descriptorPool;
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        allocInfo.descriptorSetCount = settings.framesInFlight;
         allocInfo.pSetLayouts = layouts.data();
 
-        descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+        descriptorSets.resize(settings.framesInFlight);
         if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to allocate descriptor sets!");
         }
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        descriptorSetTextureGeneration.resize(settings.framesInFlight);
+        for (size_t i = 0; i < settings.framesInFlight; i++)
         {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = uniformBuffers[i];
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(UniformBufferObject);
+            updateDescriptorSet(i);
+        }
+    }
 
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = textureImageView;
-            imageInfo.sampler = textureSampler;
+    VkImageView getTextureView()
+    {
+        // A streamed texture's view grows with every level that arrives, a blitted one is complete once it is uploaded
+        if (streamedTexture != VulkanTextureStreamer::INVALID_TEXTURE)
+        {
+            VkImageView view = textureStreamer.getView(streamedTexture);
+            return view != VK_NULL_HANDLE ? view : placeholderImageView;
+        }
+        return textureGeneration > 0 ? textureImageView : placeholderImageView;
+    }
 
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    void updateDescriptorSet(size_t i)
+    {
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = uniformBuffers[i];
+        bufferInfo.offset = 0;
+        bufferInfo.range = sizeof(UniformBufferObject);
 
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet = descriptorSets[i];
-            descriptorWrites[0].dstBinding = 0;
-            descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1;
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = getTextureView();
+        imageInfo.sampler = textureSampler;
 
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = descriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo = &imageInfo;
+        VkDescriptorBufferInfo objectBufferInfo{};
+        objectBufferInfo.buffer = objectBuffer;
+        objectBufferInfo.offset = 0;
+        objectBufferInfo.range = VK_WHOLE_SIZE;
 
-            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-        }
+        std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = descriptorSets[i];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = descriptorSets[i];
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstArrayElement = 0;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pImageInfo = &imageInfo;
+
+        descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[2].dstSet = descriptorSets[i];
+        descriptorWrites[2].dstBinding = 2;
+        descriptorWrites[2].dstArrayElement = 0;
+        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[2].descriptorCount = 1;
+        descriptorWrites[2].pBufferInfo = &objectBufferInfo;
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+        descriptorSetTextureGeneration[i] = textureGeneration;
+
+        // Writing a set invalidates every command buffer that binds it
+        commandVersion++;
     }
 
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory)
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VulkanAllocation &bufferAllocation)
     {
-        VkBufferCreateInfo bufferInfo{};
-        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size = size;
-        bufferInfo.usage = usage;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        memoryAllocator.createBuffer(size, usage, properties, buffer, bufferAllocation);
+    }
+
+    void createCommandBuffers()
+    {
+        commandBuffers.resize(settings.framesInFlight);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
 
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
         {
-            throw std::runtime_error("failed to create buffer!");
+            throw std::runtime_error("failed to allocate command buffers!");
         }
+    }
 
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+    {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+        transferWaitValue = transferQueue.recordAcquires(commandBuffer);
+
+        for (const MipmapRequest &request : pendingMipmaps)
         {
-            throw std::runtime_error("failed to allocate buffer memory!");
+            generateMipmaps(commandBuffer, request);
         }
+        pendingMipmaps.clear();
+
+        renderGraph.setImportedImage(swapChainTarget, swapChainImages[imageIndex], swapChainImageViews[imageIndex]);
+        frameImageIndex = imageIndex;
+        renderGraph.execute(commandBuffer);
 
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record command buffer!");
+        }
     }
 
-    VkCommandBuffer beginSingleTimeCommands()
+    /** @brief The scene in the main pass, a render pass or dynamic rendering, its attachments are already in attachment layouts */
+    void recordMainPass(VkCommandBuffer commandBuffer, uint32_t imageIndex)
     {
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
-        allocInfo.commandBufferCount = 1;
+        if (!indirectDrawsEnabled && !instancedDrawsEnabled)
+        {
+            buildRenderQueue();
+        }
+
+        // A cached secondary would replay the matrices direct draws pushed when it was recorded
+        RecordingMode recordingMode = RECORDING_MODE;
+        if (recordingMode == RecordingMode::Cached && !indirectDrawsEnabled && !instancedDrawsEnabled)
+        {
+            recordingMode = RecordingMode::Parallel;
+        }
 
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+        bool useSecondaries = recordingMode != RecordingMode::Inline;
 
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        // Secondaries inside dynamic rendering inherit the attachment formats instead of a render pass and framebuffer
+        VkCommandBufferInheritanceRenderingInfoKHR inheritanceRenderingInfo{};
+        inheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+        inheritanceRenderingInfo.colorAttachmentCount = 1;
+        inheritanceRenderingInfo.pColorAttachmentFormats = &swapChainImageFormat;
+        inheritanceRenderingInfo.depthAttachmentFormat = depthFormat;
+        inheritanceRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        if (dynamicRenderingEnabled)
+        {
+            inheritanceInfo.pNext = &inheritanceRenderingInfo;
+            beginMainRendering(commandBuffer, imageIndex, useSecondaries ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0);
+        }
+        else
+        {
+            inheritanceInfo.renderPass = renderPass;
+            inheritanceInfo.subpass = 0;
+            inheritanceInfo.framebuffer = swapChainFramebuffers[imageIndex];
+
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = renderPass;
+            renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+            renderPassInfo.renderArea.offset = {0, 0};
+            renderPassInfo.renderArea.extent = swapChainExtent;
+
+            std::array<VkClearValue, 2> clearValues{};
+            clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+            clearValues[1].depthStencil = {1.0f, 0};
+
+            renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+            renderPassInfo.pClearValues = clearValues.data();
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, useSecondaries ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        }
+
+        if (recordingMode == RecordingMode::Parallel)
+        {
+            const std::vector<VkCommandBuffer> &secondaries = commandRecorder.record(inheritanceInfo, getDrawCount(), [this](VkCommandBuffer secondary, uint32_t firstDraw, uint32_t drawCount)
+                                                                                     { recordDraws(secondary, firstDraw, drawCount); });
+            vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+        }
+        else if (recordingMode == RecordingMode::Cached)
+        {
+            // Only the primary around it is recorded every frame, the uniforms it reads are updated through their mapping
+            VkCommandBuffer secondary = commandCache.get(currentFrame, imageIndex, MAIN_PASS, commandVersion, inheritanceInfo, [this](VkCommandBuffer cached)
+                                                         { recordDraws(cached, 0, getDrawCount()); });
+            vkCmdExecuteCommands(commandBuffer, 1, &secondary);
+        }
+        else
+        {
+            recordDraws(commandBuffer, 0, getDrawCount());
+        }
 
-        return commandBuffer;
+        if (dynamicRenderingEnabled)
+        {
+            cmdEndRendering(commandBuffer);
+        }
+        else
+        {
+            vkCmdEndRenderPass(commandBuffer);
+        }
     }
 
-    void endSingleTimeCommands(VkCommandBuffer commandBuffer)
+    /** @brief Begins the main pass on the swapchain image and the graph's depth buffer, without render pass or framebuffer */
+    void beginMainRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkRenderingFlagsKHR flags)
     {
-        vkEndCommandBuffer(commandBuffer);
+        VkRenderingAttachmentInfoKHR colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        colorAttachment.imageView = swapChainImageViews[imageIndex];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
 
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
+        VkRenderingAttachmentInfoKHR depthAttachment{};
+        depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        depthAttachment.imageView = renderGraph.getImageView(depthTarget);
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        // The depth pyramid for the next frame's cull is built from it after the pass
+        depthAttachment.storeOp = cullingEnabled ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.clearValue.depthStencil = {1.0f, 0};
+
+        VkRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        renderingInfo.flags = flags;
+        renderingInfo.renderArea.offset = {0, 0};
+        renderingInfo.renderArea.extent = swapChainExtent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+        renderingInfo.pDepthAttachment = &depthAttachment;
 
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue);
+        cmdBeginRendering(commandBuffer, &renderingInfo);
+    }
 
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    /** @brief Draw calls recordDraws() issues, one per object unless the objects are drawn indirectly */
+    uint32_t getDrawCount() const
+    {
+        return indirectDrawsEnabled || instancedDrawsEnabled ? 1 : renderQueue.size();
     }
 
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+    void createRenderQueue()
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        renderQueueBindings.pipelines.push_back({graphicsPipeline, pipelineLayout});
+        // Descriptor set ids are frame indices
+        renderQueueBindings.descriptorSets = descriptorSets;
+
+        RenderQueueMesh mesh{};
+        mesh.vertexBuffer = vertexBuffer;
+        mesh.indexBuffer = indexBuffer;
+        mesh.indexType = VK_INDEX_TYPE_UINT16;
+        mesh.indexCount = static_cast<uint32_t>(indices.size());
+        renderQueueBindings.meshes.push_back(mesh);
 
-        VkBufferCopy copyRegion{};
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        renderQueue.reserve(static_cast<uint32_t>(objects.size()));
 
-        endSingleTimeCommands(commandBuffer);
+        drawConstants.resize(objects.size());
+        objectVisible.resize(objects.size());
+        objectDepths.resize(objects.size());
+        renderQueueBindings.pushConstants = drawConstants.data();
+        renderQueueBindings.pushConstantSize = sizeof(DrawConstants);
+        renderQueueBindings.pushConstantStages = VK_SHADER_STAGE_VERTEX_BIT;
     }
 
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    /**
+     * @brief Culls this frame's draws against the view frustum, sorts the visible ones and premultiplies their matrices,
+     * the vertex shader then does one transform per vertex
+     */
+    void buildRenderQueue()
     {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+        std::array<glm::vec4, 6> frustum = getFrustumPlanes(frameUniforms.viewProjection);
+
+        // Objects are independent of each other, only the pushes into the queue have to be serial
+        jobSystem.parallelFor(static_cast<uint32_t>(objects.size()), OBJECTS_PER_JOB, [this, &frustum](uint32_t begin, uint32_t end)
+                              {
+            for (uint32_t object = begin; object < end; object++)
+            {
+                const glm::mat4 &model = objects[object].model;
+                drawConstants[object].modelViewProjection = frameUniforms.viewProjection * model;
+                drawConstants[object].objectIndex = object;
 
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+                float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+                glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(objectBounds[object]), 1.0f));
+                objectVisible[object] = isSphereInFrustum(frustum, center, objectBounds[object].w * scale);
+
+                glm::vec4 viewPosition = frameUniforms.view * model[3];
+                objectDepths[object] = -viewPosition.z;
+            } });
+
+        renderQueue.clear();
+        for (uint32_t object = 0; object < objects.size(); object++)
         {
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            if (objectVisible[object])
             {
-                return i;
+                renderQueue.push(0, 0, currentFrame, 0, objectDepths[object], object);
             }
         }
-
-        throw std::runtime_error("failed to find suitable memory type!");
+        renderQueue.sort();
     }
 
-    void createCommandBuffers()
+    /** @brief Planes of the frustum of viewProjection in world space, normals point inside and depth is in [0, 1] */
+    static std::array<glm::vec4, 6> getFrustumPlanes(const glm::mat4 &viewProjection)
     {
-        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
-
-        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+        glm::mat4 rows = glm::transpose(viewProjection);
+        std::array<glm::vec4, 6> planes = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2]};
+        for (glm::vec4 &plane : planes)
         {
-            throw std::runtime_error("failed to allocate command buffers!");
+            plane /= glm::length(glm::vec3(plane));
         }
+        return planes;
     }
 
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+    static bool isSphereInFrustum(const std::array<glm::vec4, 6> &planes, glm::vec3 center, float radius)
     {
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        for (const glm::vec4 &plane : planes)
         {
-            throw std::runtime_error("failed to begin recording command buffer!");
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            {
+                return false;
+            }
         }
+        return true;
+    }
 
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
-        renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = swapChainExtent;
-
-        std::array<VkClearValue, 2> clearValues{};
-        clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
-        clearValues[1].depthStencil = {1.0f, 0};
-
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
-
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    /** @brief Binds everything the draws need, secondaries inherit no state from the primary. Runs on recording threads. */
+    void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)
+    {
+        VulkanCommandEncoder encoder(commandBuffer);
 
         VkViewport viewport{};
         viewport.x = 0.0f;
@@ -1348,53 +2295,101 @@ private:
         viewport.height = (float)swapChainExtent.height;
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        encoder.setViewport(viewport);
 
         VkRect2D scissor{};
         scissor.offset = {0, 0};
         scissor.extent = swapChainExtent;
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        encoder.setScissor(scissor);
 
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        if (instancedDrawsEnabled)
+        {
+            recordInstancedDraws(encoder);
+        }
+        else if (!indirectDrawsEnabled)
+        {
+            renderQueue.record(encoder, renderQueueBindings, firstDraw, drawCount);
+        }
+        else
+        {
+            encoder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+            VkBuffer vertexBuffers[] = {vertexBuffer};
+            VkDeviceSize offsets[] = {0};
+            encoder.bindVertexBuffers(0, 1, vertexBuffers, offsets);
 
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+            encoder.bindIndexBuffer(indexBuffer, 0, VK_INDEX_TYPE_UINT16);
 
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+            encoder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame]);
 
-        vkCmdEndRenderPass(commandBuffer);
+            recordIndirectDraws(encoder);
+        }
 
-        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        std::lock_guard<std::mutex> lock(encoderStatisticsMutex);
+        encoderStatistics += encoder.getStatistics();
+    }
+
+    /** @brief Every object shares the one mesh, so all of them go out as a single draw with one instance each */
+    void recordInstancedDraws(VulkanCommandEncoder &encoder)
+    {
+        encoder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
+        VkBuffer vertexBuffers[] = {vertexBuffer, instanceBuffers[currentFrame]};
+        VkDeviceSize offsets[] = {0, 0};
+        encoder.bindVertexBuffers(0, 2, vertexBuffers, offsets);
+
+        encoder.bindIndexBuffer(indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+        encoder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame]);
+
+        encoder.drawIndexed(static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(objects.size()), 0, 0, 0);
+    }
+
+    /** @brief Every object in a constant number of calls, the count is read from drawCountBuffer where supported */
+    void recordIndirectDraws(VulkanCommandEncoder &encoder)
+    {
+        uint32_t maxDrawCount = static_cast<uint32_t>(drawCommands.size());
+        uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        // The buffers stay the same, so cached secondaries remain valid while the cull rewrites their contents
+        VkBuffer drawCommandBuffer = cullingEnabled ? gpuCulling.getDrawCommandBuffer() : this->drawCommandBuffer;
+        VkBuffer drawCountBuffer = cullingEnabled ? gpuCulling.getDrawCountBuffer() : this->drawCountBuffer;
+
+        if (drawIndirectCountEnabled)
         {
-            throw std::runtime_error("failed to record command buffer!");
+            encoder.drawIndexedIndirectCount(drawCommandBuffer, 0, drawCountBuffer, 0, maxDrawCount, stride);
+        }
+        else if (multiDrawIndirectEnabled)
+        {
+            encoder.drawIndexedIndirect(drawCommandBuffer, 0, maxDrawCount, stride);
+        }
+        else
+        {
+            for (uint32_t draw = 0; draw < maxDrawCount; draw++)
+            {
+                encoder.drawIndexedIndirect(drawCommandBuffer, draw * stride, 1, stride);
+            }
         }
     }
 
     void createSyncObjects()
     {
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+        imageAvailableSemaphores.resize(settings.framesInFlight);
+        renderFinishedSemaphores.resize(settings.framesInFlight);
 
+        // Acquire and present only take binary semaphores, everything else waits on the frame timeline
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        for (size_t i = 0; i < settings.framesInFlight; i++)
         {
             if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+                vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
             {
                 throw std::runtime_error("failed to create synchronization objects for a frame!");
             }
         }
+
+        frameScheduler.create(device, settings.framesInFlight);
     }
 
     void updateUniformBuffer(uint32_t currentImage)
@@ -1404,18 +2399,28 @@ private:
         auto currentTime = std::chrono::high_resolution_clock::now();
         float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
+        // Rotating the scene is the same as rotating the camera the other way around it
+        glm::mat4 sceneRotation = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
         UniformBufferObject ubo{};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * sceneRotation;
         ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
         ubo.proj[1][1] *= -1;
+        ubo.viewProjection = ubo.proj * ubo.view;
 
         memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+        frameUniforms = ubo;
+
+        if (cullingEnabled)
+        {
+            gpuCulling.setView(currentImage, glm::value_ptr(ubo.viewProjection));
+        }
     }
 
     void drawFrame()
     {
-        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        // Only waits for the frame that last used this slot, the previous frame can still be running
+        currentFrame = frameScheduler.beginFrame();
 
         uint32_t imageIndex;
         VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
@@ -1431,32 +2436,59 @@ private:
         }
 
         updateUniformBuffer(currentFrame);
+        if (instancedDrawsEnabled)
+        {
+            updateInstanceBuffer(currentFrame);
+        }
 
-        vkResetFences(device, 1, &inFlightFences[currentFrame]);
+        transferQueue.collect();
+        stagingRing.reclaim();
+        processLoadedAssets();
+        textureStreamer.update();
+        uploadBatch.flush();
+
+        // The set of this slot is no longer in use by the GPU once beginFrame() has returned it
+        if (descriptorSetTextureGeneration[currentFrame] != textureGeneration)
+        {
+            updateDescriptorSet(currentFrame);
+        }
 
         vkResetCommandBuffer(commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
+        commandRecorder.beginFrame(currentFrame);
         recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
+        // Only frames that acquire freshly uploaded resources wait on the transfer timeline
+        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame], transferQueue.getTimeline()};
+        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+        uint64_t waitValues[] = {0, transferWaitValue};
+        submitInfo.waitSemaphoreCount = transferWaitValue > 0 ? 2 : 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+        timelineInfo.pWaitSemaphoreValues = waitValues;
+        submitInfo.pNext = &timelineInfo;
+
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
-        VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-        submitInfo.signalSemaphoreCount = 1;
+        VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame], frameScheduler.getTimeline()};
+        uint64_t signalValues[] = {0, frameScheduler.getFrameValue()};
+        submitInfo.signalSemaphoreCount = 2;
         submitInfo.pSignalSemaphores = signalSemaphores;
+        timelineInfo.signalSemaphoreValueCount = 2;
+        timelineInfo.pSignalSemaphoreValues = signalValues;
 
-        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
+        frameScheduler.endFrame();
 
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1481,16 +2513,34 @@ private:
         {
             throw std::runtime_error("failed to present swap chain image!");
         }
-
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
-    VkShaderModule createShaderModule(const std::vector<char> &code)
+    VkShaderModule createShaderModule(const std::string &name)
     {
+        uint32_t entry = assetPack.find(name);
+        if (entry == AssetPack::INVALID_ENTRY)
+        {
+            throw std::runtime_error("failed to find shader in asset pack!");
+        }
+
+        // Stored SPIR-V is passed straight from the mapping, compressed entries are expanded first
+        size_t codeSize = static_cast<size_t>(assetPack.getSize(entry));
+        const uint32_t *code = reinterpret_cast<const uint32_t *>(assetPack.getData(entry));
+        std::vector<uint32_t> expanded;
+        if (!code)
+        {
+            expanded.resize((codeSize + 3) / 4);
+            if (!assetPack.read(entry, expanded.data()))
+            {
+                throw std::runtime_error("failed to read shader from asset pack!");
+            }
+            code = expanded.data();
+        }
+
         VkShaderModuleCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+        createInfo.codeSize = codeSize;
+        createInfo.pCode = code;
 
         VkShaderModule shaderModule;
         if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
@@ -1518,7 +2568,7 @@ private:
     {
         for (const auto &availablePresentMode : availablePresentModes)
         {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+            if (availablePresentMode == settings.presentMode)
             {
                 return availablePresentMode;
             }
@@ -1565,7 +2615,14 @@ private:
         VkPhysicalDeviceFeatures supportedFeatures;
         vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-        return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &timelineFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+
+        return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy && timelineFeatures.timelineSemaphore;
     }
 
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device)
@@ -1581,7 +2638,8 @@ private:
         int i = 0;
         for (const auto &queueFamily : queueFamilies)
         {
-            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+            // Compute as well for the cull pass, which is recorded alongside the draws
+            if (!indices.graphicsFamily.has_value() && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
             {
                 indices.graphicsFamily = i;
             }
@@ -1589,12 +2647,19 @@ private:
             VkBool32 presentSupport = false;
             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
-            if (presentSupport)
+            if (!indices.presentFamily.has_value() && presentSupport)
             {
                 indices.presentFamily = i;
             }
 
-            if (indices.isComplete())
+            // A family with transfer but neither graphics nor compute is usually a dedicated DMA engine
+            if (!indices.transferFamily.has_value() && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+                !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+            {
+                indices.transferFamily = i;
+            }
+
+            if (indices.isComplete() && indices.transferFamily.has_value())
             {
                 break;
             }
@@ -1651,26 +2716,6 @@ private:
         return true;
     }
 
-    static std::vector<char> readFile(const std::string &filename)
-    {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-        if (!file.is_open())
-        {
-            throw std::runtime_error("failed to open file!");
-        }
-
-        size_t fileSize = (size_t)file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-
-        file.close();
-
-        return buffer;
-    }
-
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData)
     {
         std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
@@ -1679,13 +2724,13 @@ private:
     }
 };
 
-int main()
+int main(int argc, char **argv)
 {
     HelloTriangleApplication app;
 
     try
     {
-        app.run();
+        app.run(parseFrameSettings(argc, argv));
     }
     catch (const std::exception &e)
     {
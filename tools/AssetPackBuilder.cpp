@@ -0,0 +1,243 @@
+// Offline asset packer: files under a root directory -> one memory mappable pack.
+//
+//   AssetPackBuilder <output.pack> <root> [--compress] [files...]
+//
+// Entries are named by their path relative to root with forward slashes. Without a file list every
+// regular file under root is packed. With --compress each entry is split into chunks that are LZ4
+// compressed on their own; chunks that do not shrink by at least an eighth are kept raw, and entries
+// where no chunk shrank stay plain so the engine can use them in place.
+
+#include "Backend/AssetPack.h"
+#include "Backend/Lz4.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using namespace AssetPackFormat;
+
+namespace
+{
+    struct Options
+    {
+        std::string output;
+        fs::path root;
+        bool compress = false;
+        std::vector<fs::path> files;
+    };
+
+    struct Input
+    {
+        std::string name;
+        std::vector<uint8_t> data;
+        PackEntry entry{};
+        std::vector<std::vector<uint8_t>> chunks;
+        std::vector<PackChunk> chunkInfo;
+    };
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool readFile(const fs::path &path, std::vector<uint8_t> &data)
+    {
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        data.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        return file.good();
+    }
+
+    /** @return true if at least one chunk was worth compressing */
+    bool compressChunks(Input &input)
+    {
+        bool anyCompressed = false;
+        for (size_t offset = 0; offset < input.data.size(); offset += CHUNK_SIZE)
+        {
+            uint32_t size = static_cast<uint32_t>(std::min<size_t>(CHUNK_SIZE, input.data.size() - offset));
+            const uint8_t *source = input.data.data() + offset;
+
+            std::vector<uint8_t> stored(Lz4::getCompressBound(size));
+            size_t storedSize = Lz4::compress(source, size, stored.data(), stored.size());
+            if (storedSize == 0 || storedSize > size - size / 8)
+            {
+                stored.assign(source, source + size);
+                storedSize = size;
+            }
+            else
+            {
+                stored.resize(storedSize);
+                anyCompressed = true;
+            }
+
+            input.chunks.push_back(std::move(stored));
+            input.chunkInfo.push_back({0, static_cast<uint32_t>(storedSize), size});
+        }
+        return anyCompressed;
+    }
+
+    bool parseArguments(int argc, char **argv, Options &options)
+    {
+        std::vector<std::string> positional;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+            if (argument == "--compress")
+                options.compress = true;
+            else
+                positional.push_back(argument);
+        }
+
+        if (positional.size() < 2)
+            return false;
+        options.output = positional[0];
+        options.root = positional[1];
+        for (size_t i = 2; i < positional.size(); i++)
+            options.files.push_back(positional[i]);
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseArguments(argc, argv, options))
+    {
+        std::fprintf(stderr, "usage: AssetPackBuilder <output.pack> <root> [--compress] [files...]\n");
+        return 1;
+    }
+
+    std::error_code error;
+    if (options.files.empty())
+    {
+        for (const fs::directory_entry &file : fs::recursive_directory_iterator(options.root, error))
+        {
+            if (file.is_regular_file())
+                options.files.push_back(file.path());
+        }
+    }
+
+    std::vector<Input> inputs;
+    for (const fs::path &file : options.files)
+    {
+        Input input;
+        const fs::path &path = file;
+        input.name = fs::relative(path, options.root, error).generic_string();
+        if (error || input.name.empty() || input.name.compare(0, 2, "..") == 0)
+        {
+            std::fprintf(stderr, "%s is not under %s\n", path.string().c_str(), options.root.string().c_str());
+            return 1;
+        }
+        if (!readFile(path, input.data))
+        {
+            std::fprintf(stderr, "failed to read %s\n", path.string().c_str());
+            return 1;
+        }
+        inputs.push_back(std::move(input));
+    }
+
+    std::sort(inputs.begin(), inputs.end(), [](const Input &a, const Input &b)
+              { return hashName(a.name) < hashName(b.name); });
+
+    // Lay out blobs, then the tables after them
+    std::string names;
+    uint32_t chunkCount = 0;
+    uint64_t offset = sizeof(PackHeader);
+    for (Input &input : inputs)
+    {
+        PackEntry &entry = input.entry;
+        entry.nameHash = hashName(input.name);
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        entry.nameLength = static_cast<uint32_t>(input.name.size());
+        entry.size = input.data.size();
+        names += input.name;
+
+        offset = alignUp(offset, BLOB_ALIGNMENT);
+        entry.offset = offset;
+
+        if (options.compress && compressChunks(input))
+        {
+            entry.flags = ENTRY_COMPRESSED;
+            entry.firstChunk = chunkCount;
+            entry.chunkCount = static_cast<uint32_t>(input.chunks.size());
+            chunkCount += entry.chunkCount;
+            for (PackChunk &chunk : input.chunkInfo)
+            {
+                chunk.offset = offset;
+                offset += chunk.storedSize;
+            }
+        }
+        else
+        {
+            input.chunks.clear();
+            input.chunkInfo.clear();
+            offset += input.data.size();
+        }
+    }
+
+    PackHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entryCount = static_cast<uint32_t>(inputs.size());
+    header.chunkCount = chunkCount;
+    header.namesSize = static_cast<uint32_t>(names.size());
+    header.tocOffset = alignUp(offset, alignof(PackEntry));
+
+    std::vector<uint8_t> pack(header.tocOffset + inputs.size() * sizeof(PackEntry) + chunkCount * sizeof(PackChunk) + names.size(), 0);
+    memcpy(pack.data(), &header, sizeof(PackHeader));
+
+    uint8_t *entryTable = pack.data() + header.tocOffset;
+    uint8_t *chunkTable = entryTable + inputs.size() * sizeof(PackEntry);
+    uint64_t storedBytes = 0;
+    uint64_t totalBytes = 0;
+    for (const Input &input : inputs)
+    {
+        memcpy(entryTable, &input.entry, sizeof(PackEntry));
+        entryTable += sizeof(PackEntry);
+        totalBytes += input.data.size();
+
+        if (input.chunks.empty())
+        {
+            if (!input.data.empty())
+                memcpy(pack.data() + input.entry.offset, input.data.data(), input.data.size());
+            storedBytes += input.data.size();
+            continue;
+        }
+
+        for (size_t c = 0; c < input.chunks.size(); c++)
+        {
+            memcpy(pack.data() + input.chunkInfo[c].offset, input.chunks[c].data(), input.chunks[c].size());
+            memcpy(chunkTable, &input.chunkInfo[c], sizeof(PackChunk));
+            chunkTable += sizeof(PackChunk);
+            storedBytes += input.chunks[c].size();
+        }
+    }
+    memcpy(chunkTable, names.data(), names.size());
+
+    std::ofstream out(options.output, std::ios::binary);
+    if (!out.is_open())
+    {
+        std::fprintf(stderr, "failed to write %s\n", options.output.c_str());
+        return 1;
+    }
+    out.write(reinterpret_cast<const char *>(pack.data()), static_cast<std::streamsize>(pack.size()));
+    if (!out.good())
+    {
+        std::fprintf(stderr, "failed to write %s\n", options.output.c_str());
+        return 1;
+    }
+
+    std::printf("%s: %zu entries, %llu of %llu bytes stored\n", options.output.c_str(), inputs.size(),
+                static_cast<unsigned long long>(storedBytes), static_cast<unsigned long long>(totalBytes));
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Offline texture cooker: image -> KTX2 with a full mip chain in a BCn format.
+//
+//   TextureCooker <input> <output.ktx2> [--format bc1|bc3|bc5|bc7|rgba8] [--linear] [--threads N]
+//
+// Mips are box filtered in linear space unless --linear says the data is not colour. Every level is
+// split into bands of block rows that are encoded in parallel.
+
+#include "Backend/Ktx2.h"
+#include "Backend/PixelKernels.h"
+#include "Backend/TextureCompression.h"
+#include "Backend/ThreadPool.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const uint32_t BLOCK_ROWS_PER_TASK = 8;
+
+    struct Options
+    {
+        std::string input;
+        std::string output;
+        std::string format = "bc7";
+        bool linear = false;
+        uint32_t threads = 0;
+    };
+
+    struct Level
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> rgba;
+    };
+
+    VkFormat selectFormat(const std::string &name, bool linear)
+    {
+        if (name == "bc1")
+            return linear ? VK_FORMAT_BC1_RGB_UNORM_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+        if (name == "bc3")
+            return linear ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC3_SRGB_BLOCK;
+        if (name == "bc5")
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        if (name == "bc7")
+            return linear ? VK_FORMAT_BC7_UNORM_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+        if (name == "rgba8")
+            return linear ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB;
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    /** @brief Halves a level with a 2x2 box filter, a dimension of 1 reuses its single row or column */
+    Level downsample(const Level &source, bool srgb)
+    {
+        Level level;
+        level.width = std::max(1u, source.width / 2);
+        level.height = std::max(1u, source.height / 2);
+        level.rgba.resize(static_cast<size_t>(level.width) * level.height * 4);
+
+        PixelKernels::getKernels().downsample2x(source.rgba.data(), source.width, source.height, level.rgba.data(), srgb);
+        return level;
+    }
+
+    std::vector<uint8_t> encodeLevel(ThreadPool &pool, VkFormat format, const Level &level)
+    {
+        if (!TextureCompression::canEncode(format))
+            return level.rgba;
+
+        std::vector<uint8_t> blocks(TextureCompression::getEncodedSize(format, level.width, level.height));
+        uint32_t blockRows = (level.height + 3) / 4;
+
+        std::vector<std::future<void>> tasks;
+        for (uint32_t row = 0; row < blockRows; row += BLOCK_ROWS_PER_TASK)
+        {
+            tasks.push_back(pool.submit([&, row]()
+                                        { TextureCompression::encodeImage(format, level.rgba.data(), level.width, level.height, blocks.data(), row, BLOCK_ROWS_PER_TASK); }));
+        }
+        for (std::future<void> &task : tasks)
+            task.get();
+
+        return blocks;
+    }
+
+    bool parseArguments(int argc, char **argv, Options &options)
+    {
+        std::vector<std::string> positional;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+            if (argument == "--format" && i + 1 < argc)
+                options.format = argv[++i];
+            else if (argument == "--threads" && i + 1 < argc)
+                options.threads = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (argument == "--linear")
+                options.linear = true;
+            else
+                positional.push_back(argument);
+        }
+
+        if (positional.size() != 2)
+            return false;
+        options.input = positional[0];
+        options.output = positional[1];
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseArguments(argc, argv, options))
+    {
+        std::fprintf(stderr, "usage: TextureCooker <input> <output.ktx2> [--format bc1|bc3|bc5|bc7|rgba8] [--linear] [--threads N]\n");
+        return 1;
+    }
+
+    VkFormat format = selectFormat(options.format, options.linear);
+    if (format == VK_FORMAT_UNDEFINED)
+    {
+        std::fprintf(stderr, "unknown format %s\n", options.format.c_str());
+        return 1;
+    }
+
+    std::ifstream input(options.input, std::ios::ate | std::ios::binary);
+    std::vector<uint8_t> file(input.is_open() ? static_cast<size_t>(input.tellg()) : 0);
+    input.seekg(0);
+    input.read(reinterpret_cast<char *>(file.data()), static_cast<std::streamsize>(file.size()));
+
+    // Non-JPEG RGB sources are decoded as RGB and expanded by the pixel kernels instead of stb's per pixel loop
+    int texWidth, texHeight, texChannels;
+    bool isJpeg = file.size() >= 2 && file[0] == 0xff && file[1] == 0xd8;
+    bool expandRgb = stbi_info_from_memory(file.data(), static_cast<int>(file.size()), &texWidth, &texHeight, &texChannels) && texChannels == 3 && !isJpeg;
+    int requestedChannels = expandRgb ? STBI_rgb : STBI_rgb_alpha;
+    stbi_uc *pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &texWidth, &texHeight, &texChannels, requestedChannels);
+    if (!pixels)
+    {
+        std::fprintf(stderr, "failed to load %s\n", options.input.c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Level> levels(1);
+    levels[0].width = static_cast<uint32_t>(texWidth);
+    levels[0].height = static_cast<uint32_t>(texHeight);
+    size_t pixelCount = static_cast<size_t>(texWidth) * texHeight;
+    if (expandRgb)
+    {
+        levels[0].rgba.resize(pixelCount * 4);
+        PixelKernels::getKernels().rgbToRgba(pixels, levels[0].rgba.data(), pixelCount);
+    }
+    else
+    {
+        levels[0].rgba.assign(pixels, pixels + pixelCount * 4);
+    }
+    stbi_image_free(pixels);
+
+    bool srgb = !options.linear;
+    while (levels.back().width > 1 || levels.back().height > 1)
+        levels.push_back(downsample(levels.back(), srgb));
+
+    ThreadPool pool;
+    pool.create(options.threads);
+
+    std::vector<std::vector<uint8_t>> encoded;
+    for (const Level &level : levels)
+        encoded.push_back(encodeLevel(pool, format, level));
+
+    pool.destroy();
+
+    if (!Ktx2::write(options.output, format, levels[0].width, levels[0].height, encoded))
+    {
+        std::fprintf(stderr, "failed to write %s\n", options.output.c_str());
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%s: %ux%u, %zu levels, %s, %s kernels, %.2f s\n", options.output.c_str(), levels[0].width, levels[0].height, levels.size(), options.format.c_str(),
+                PixelKernels::getIsaName(PixelKernels::getSupportedIsa()), seconds);
+    return 0;
+}